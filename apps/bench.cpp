@@ -152,6 +152,10 @@ int main_bench(int argc, const char* argv[]) {
             quotient += quo;
         }
         if (chatty_mode) {
+            std::string stats = bench->stats();
+            if (!stats.empty()) {
+                printf(" (%s)", stats.c_str());
+            }
             printf("\n");
         }
         durs.push_back(dur);
@@ -6,6 +6,7 @@
 #define _bench_h_DEFINED
 
 #include "../include/GPoint.h"
+#include <string>
 
 class GCanvas;
 
@@ -17,6 +18,11 @@ public:
     virtual GISize size() const = 0;
     virtual void draw(GCanvas*) = 0;
 
+    /**
+     *  Optional extra measurements (e.g. bytes produced), printed after the timing.
+     */
+    virtual std::string stats() const { return std::string(); }
+
     typedef GBenchmark* (*Factory)();
 };
 
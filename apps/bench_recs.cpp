@@ -16,6 +16,8 @@
 #include "bench_pa4.inc"
 #include "bench_pa5.inc"
 #include "bench_pa6.inc"
+#include "bench_io.inc"
+#include "bench_raster.inc"
 
 const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* { return new ClearBench(); },
@@ -102,5 +104,351 @@ const GBenchmark::Factory gBenchFactories[] {
         return new QuadBench(colors, texs, "quad_mesh");
     },
 
+    // image i/o
+    []() -> GBenchmark* {
+        return new PNGEncodeBench("apps/spock.png", GPNGWriter::kStore_Level, "png_encode_store");
+    },
+    []() -> GBenchmark* {
+        return new PNGEncodeBench("apps/spock.png", GPNGWriter::kFast_Level, "png_encode_fast");
+    },
+    []() -> GBenchmark* {
+        return new PNGEncodeBench("apps/spock.png", GPNGWriter::kDefault_Level,
+                                  "png_encode_default");
+    },
+    []() -> GBenchmark* {
+        return new PNGEncodeBench("apps/spock.png", GPNGWriter::kBest_Level, "png_encode_best");
+    },
+    []() -> GBenchmark* { return new PixelConvertBench(391, 353, 20, false, "premul_spock"); },
+    []() -> GBenchmark* { return new PixelConvertBench(391, 353, 20, true, "unpremul_spock"); },
+    []() -> GBenchmark* { return new PixelConvertBench(3840, 2160, 1, false, "premul_4k"); },
+    []() -> GBenchmark* { return new PixelConvertBench(3840, 2160, 1, true, "unpremul_4k"); },
+    []() -> GBenchmark* { return new LoadBitmapsBench(14, 1, "load_textures_serial"); },
+    []() -> GBenchmark* { return new LoadBitmapsBench(14, 0, "load_textures_parallel"); },
+    []() -> GBenchmark* {
+        return new ImageCacheBench("apps/spock.png", ImageCacheBench::kDecode_Mode,
+                                   "image_cache_decode");
+    },
+    []() -> GBenchmark* {
+        return new ImageCacheBench("apps/spock.png", ImageCacheBench::kMemory_Mode,
+                                   "image_cache_memory");
+    },
+    []() -> GBenchmark* {
+        return new ImageCacheBench("apps/spock.png", ImageCacheBench::kDisk_Mode,
+                                   "image_cache_disk");
+    },
+    []() -> GBenchmark* { return new LoadRawBench(2048, 2048, false, "load_png_2k"); },
+    []() -> GBenchmark* { return new LoadRawBench(2048, 2048, true, "load_raw_2k"); },
+
+    // other pixel formats
+    []() -> GBenchmark* { return new MaskRenderBench(true,  "mask_render_a8");  },
+    []() -> GBenchmark* { return new MaskRenderBench(false, "mask_render_n32"); },
+    []() -> GBenchmark* { return new MaskDrawBench(true,  "mask_draw_a8");  },
+    []() -> GBenchmark* { return new MaskDrawBench(false, "mask_draw_n32"); },
+    []() -> GBenchmark* { return new Format565Bench(kRects_FormatScene, true, "rects_565"); },
+    []() -> GBenchmark* {
+        return new Format565Bench(kRects_FormatScene, false, "rects_n32_to_565");
+    },
+    []() -> GBenchmark* {
+        return new Format565Bench(kGradient_FormatScene, true, "gradient_565");
+    },
+    []() -> GBenchmark* {
+        return new Format565Bench(kGradient_FormatScene, false, "gradient_n32_to_565");
+    },
+    []() -> GBenchmark* { return new Format565Bench(kBitmap_FormatScene, true, "bitmap_565"); },
+    []() -> GBenchmark* {
+        return new Format565Bench(kBitmap_FormatScene, false, "bitmap_n32_to_565");
+    },
+    []() -> GBenchmark* { return new FormatF16Bench(kRects_FormatScene, true, "rects_f16"); },
+    []() -> GBenchmark* { return new FormatF16Bench(kRects_FormatScene, false, "rects_n32"); },
+    []() -> GBenchmark* {
+        return new FormatF16Bench(kGradient_FormatScene, true, "gradient_f16");
+    },
+    []() -> GBenchmark* {
+        return new FormatF16Bench(kGradient_FormatScene, false, "gradient_n32");
+    },
+    []() -> GBenchmark* { return new FormatF16Bench(kModes_FormatScene, true, "modes_f16"); },
+    []() -> GBenchmark* { return new FormatF16Bench(kModes_FormatScene, false, "modes_n32"); },
+
+    // linear-light blending
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new LinearBlendBench(new GradientBench(colors, 2, "gradient_2"), false,
+                                    "gradient_2_srgb");
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new LinearBlendBench(new GradientBench(colors, 2, "gradient_2"), true,
+                                    "gradient_2_linear");
+    },
+    []() -> GBenchmark* {
+        return new LinearBlendBench(new ModesBench({1, 0.5, 0.25, 0.5}, "modes_x"), false,
+                                    "modes_x_srgb");
+    },
+    []() -> GBenchmark* {
+        return new LinearBlendBench(new ModesBench({1, 0.5, 0.25, 0.5}, "modes_x"), true,
+                                    "modes_x_linear");
+    },
+
+    // layers
+    []() -> GBenchmark* { return new LayerBench(64,  "layers_64");  },
+    []() -> GBenchmark* { return new LayerBench(256, "layers_256"); },
+    []() -> GBenchmark* { return new LayerBench(512, "layers_512"); },
+
+    // blur
+    []() -> GBenchmark* { return new BlurBench(2,  "blur_2");  },
+    []() -> GBenchmark* { return new BlurBench(16, "blur_16"); },
+    []() -> GBenchmark* { return new BlurBench(64, "blur_64"); },
+
+    // color filters
+    []() -> GBenchmark* {
+        return new ColorFilterBench("apps/spock.png", ColorFilterBench::Matrix(),
+                                    "bitmap_opaque_matrix");
+    },
+    []() -> GBenchmark* {
+        return new ColorFilterBench("apps/spock.png", ColorFilterBench::Table(),
+                                    "bitmap_opaque_table");
+    },
+    []() -> GBenchmark* {
+        return new ColorFilterBench("apps/wheel.png", ColorFilterBench::Matrix(),
+                                    "bitmap_alpha_matrix");
+    },
+
+    // blend modes, one at a time (srcover for comparison), in an 8888 layer
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kSrcOver),
+                                "modes_srcover");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kMultiply),
+                                "modes_multiply");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kScreen),
+                                "modes_screen");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kOverlay),
+                                "modes_overlay");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kDarken),
+                                "modes_darken");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kLighten),
+                                "modes_lighten");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kColorDodge),
+                                "modes_colordodge");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kColorBurn),
+                                "modes_colorburn");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kHardLight),
+                                "modes_hardlight");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kSoftLight),
+                                "modes_softlight");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kDifference),
+                                "modes_difference");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kExclusion),
+                                "modes_exclusion");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ModesBench({1, 0.5, 0.25, 0.5}, "", GBlendMode::kMultiply,
+                                               11), "modes_advanced_x");
+    },
+
+    // sprites, drawn in an 8888 layer (the canvas's own drawBitmapRect, then via a shader)
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/spock.png", 1, false, ""),
+                                "sprite_spock");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/spock.png", 1, true, ""),
+                                "sprite_spock_shader");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/spock.png", 1.5f, false, ""),
+                                "sprite_spock_scaled");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/spock.png", 1.5f, true, ""),
+                                "sprite_spock_scaled_shader");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/wheel.png", 1, false, ""),
+                                "sprite_wheel");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/wheel.png", 1, true, ""),
+                                "sprite_wheel_shader");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/wheel.png", 1.5f, false, ""),
+                                "sprite_wheel_scaled");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new SpriteBench("apps/wheel.png", 1.5f, true, ""),
+                                "sprite_wheel_scaled_shader");
+    },
+
+    // 10,000 icons from an atlas, in an 8888 layer
+    []() -> GBenchmark* {
+        return new InLayerBench(new AtlasBench(AtlasBench::kAtlas_Method, ""), "atlas_10k");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new AtlasBench(AtlasBench::kBitmapRect_Method, ""),
+                                "atlas_10k_bitmaprect");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new AtlasBench(AtlasBench::kShader_Method, ""),
+                                "atlas_10k_shader");
+    },
+
+    // nine-patch buttons, in an 8888 layer
+    []() -> GBenchmark* {
+        return new InLayerBench(new NineBench(false, ""), "nine_patch");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new NineBench(true, ""), "nine_patch_rects");
+    },
+
+    // circles, in an 8888 layer: as 100-point polygons, then as analytic ovals, and as convex
+    // paths
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(true), "circles_tiny_layer");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(true, CirclesBench::kOval_Method),
+                                "circles_tiny_oval");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(true, CirclesBench::kPath_Method),
+                                "circles_tiny_path");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(false), "circles_large_layer");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(false, CirclesBench::kOval_Method),
+                                "circles_large_oval");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new CirclesBench(false, CirclesBench::kPath_Method),
+                                "circles_large_path");
+    },
+
+    // a 100x100 mesh's wireframe, in an 8888 layer: 1.5 wide, as paths then as lines, and as
+    // hairlines
+    []() -> GBenchmark* {
+        return new InLayerBench(new WireframeBench(WireframeBench::kPaths_Method, ""),
+                                "wireframe_paths");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new WireframeBench(WireframeBench::kLines_Method, ""),
+                                "wireframe_lines");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new WireframeBench(WireframeBench::kHairlines_Method, ""),
+                                "wireframe_hairlines");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new WireframeBench(WireframeBench::kHairlinesAA_Method, ""),
+                                "wireframe_hairlines_aa");
+    },
+
+    // PathBench2's path, stroked at several widths in an 8888 layer: with the stroker, then as a
+    // rect per flattened segment
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(1, false, ""), "stroke_1");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(1, true, ""), "stroke_1_rects");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(4, false, ""), "stroke_4");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(4, true, ""), "stroke_4_rects");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(16, false, ""), "stroke_16");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new StrokeBench(16, true, ""), "stroke_16_rects");
+    },
+
+    // The lion redrawn at shifting offsets: blitting cached masks, and scan converting each time
+    []() -> GBenchmark* {
+        return new LionCacheBench(true, "lion_mask_cache");
+    },
+    []() -> GBenchmark* {
+        return new LionCacheBench(false, "lion_no_cache");
+    },
+
+    // Simple paths drawn repeatedly: the same path each time, and a new one for each draw
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kRect_Shape, true, ""),
+                                "shape_rect_shared");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kRect_Shape, false, ""),
+                                "shape_rect_rebuilt");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kOval_Shape, true, ""),
+                                "shape_oval_shared");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kOval_Shape, false, ""),
+                                "shape_oval_rebuilt");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kHexagon_Shape, true, ""),
+                                "shape_hexagon_shared");
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new ShapeBench(ShapeBench::kHexagon_Shape, false, ""),
+                                "shape_hexagon_rebuilt");
+    },
+
+    // Curves filled as curve edges (see GFillPath)
+    []() -> GBenchmark* { return new InLayerBench(new CartmanBench, "cartman_layer"); },
+
+    // PathBench2 in an 8888 layer, filled by each engine (and by the automatic choice)
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 256, ""), "path_unclipped_edges",
+                                GFillEngine::kEdgeList);
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 256, ""), "path_unclipped_accum",
+                                GFillEngine::kAccumulate);
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 256, ""), "path_unclipped_auto",
+                                GFillEngine::kAuto);
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 1024, ""), "path_clipped_edges",
+                                GFillEngine::kEdgeList);
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 1024, ""), "path_clipped_accum",
+                                GFillEngine::kAccumulate);
+    },
+    []() -> GBenchmark* {
+        return new InLayerBench(new PathBench2({256, 256}, 1024, ""), "path_clipped_auto",
+                                GFillEngine::kAuto);
+    },
+
     nullptr,
 };
@@ -6,6 +6,7 @@
 #include "../include/GCanvas.h"
 #include "../include/GBitmap.h"
 #include "../include/GColor.h"
+#include "../include/GImageCache.h"
 #include "../include/GMatrix.h"
 #include "../include/GPath.h"
 #include "../include/GPoint.h"
@@ -31,8 +32,8 @@ static void draw_tri(GCanvas* canvas) {
 }
 
 static void draw_tri2(GCanvas* canvas) {
-    GBitmap bm;
-    bm.readFromFile("apps/spock.png");
+    auto image = GImageCache::Shared()->get("apps/spock.png");
+    const GBitmap& bm = *image;
     float w = bm.width();
     float h = bm.height();
 
@@ -109,8 +110,8 @@ static void draw_quad(GCanvas* canvas, const GColor colors[], const GPoint texs[
 }
 
 static void spock_quad(GCanvas* canvas) {
-    GBitmap bitmap;
-    bitmap.readFromFile("apps/spock.png");
+    auto image = GImageCache::Shared()->get("apps/spock.png");
+    const GBitmap& bitmap = *image;
     const float w = bitmap.width();
     const float h = bitmap.height();
     auto shader = GCreateBitmapShader(bitmap, GMatrix(), GTileMode::kMirror);
@@ -0,0 +1,57 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GMappedBitmap.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ *  Converts images between PNG and the raw (premultiplied, uncompressed) format:
+ *
+ *      png2raw input.png output.graw
+ *      png2raw input.graw output.png
+ *
+ *  The direction is chosen by looking at the input file's extension.
+ */
+
+static bool has_suffix(const char str[], const char suffix[]) {
+    size_t n = strlen(str), m = strlen(suffix);
+    return n >= m && !strcmp(str + n - m, suffix);
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        printf("usage: %s input.png output.graw\n", argv[0]);
+        printf("       %s input.graw output.png\n", argv[0]);
+        return -1;
+    }
+    const char* src = argv[1];
+    const char* dst = argv[2];
+
+    if (has_suffix(src, ".graw")) {
+        auto mapped = GMappedBitmap::Open(src);
+        if (!mapped) {
+            printf("failed to read raw bitmap %s\n", src);
+            return -1;
+        }
+        if (!mapped->bitmap().writeToFile(dst)) {
+            printf("failed to write %s\n", dst);
+            return -1;
+        }
+    } else {
+        GBitmap bm;
+        if (!bm.readFromFile(src)) {
+            printf("failed to decode %s\n", src);
+            return -1;
+        }
+        bool success = bm.writeToRawFile(dst);
+        free(bm.pixels());
+        if (!success) {
+            printf("failed to write %s\n", dst);
+            return -1;
+        }
+    }
+    return 0;
+}
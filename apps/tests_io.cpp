@@ -0,0 +1,351 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GBitmapLoader.h"
+#include "../include/GCanvas.h"
+#include "../include/GImageCache.h"
+#include "../include/GMappedBitmap.h"
+#include "../include/GPNGWriter.h"
+#include "../include/GPixelConvert.h"
+#include "../include/GRandom.h"
+#include "tests.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <thread>
+
+static void fill_random(const GBitmap& bm, bool opaque) {
+    GRandom rand;
+    for (int y = 0; y < bm.height(); ++y) {
+        for (int x = 0; x < bm.width(); ++x) {
+            unsigned a = opaque ? 0xFF : rand.nextU() & 0xFF;
+            // mix in some runs, so the compressor finds matches as well as literals
+            unsigned c = (x / 8) & 0xFF;
+            *bm.getAddr(x, y) = GPixel_PackARGB(a, c * a / 255, (rand.nextU() & 0xFF) * a / 255, a);
+        }
+    }
+}
+
+static bool bitmaps_equal(const GBitmap& a, const GBitmap& b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        return false;
+    }
+    for (int y = 0; y < a.height(); ++y) {
+        if (memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * sizeof(GPixel))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_png_levels(GTestStats* stats) {
+    const char path[] = "test_png_levels.png";
+
+    for (bool opaque : { false, true }) {
+        GBitmap src, ref;
+        src.alloc(97, 61);
+        fill_random(src, opaque);
+
+        // the reference is what the default encoder produces (premul -> unpremul is lossy)
+        EXPECT_TRUE(stats, src.writeToFile(path));
+        EXPECT_TRUE(stats, ref.readFromFile(path));
+
+        for (int level = GPNGWriter::kStore_Level; level <= GPNGWriter::kBest_Level; ++level) {
+            GBitmap dst;
+            EXPECT_TRUE(stats, GPNGWriter::Write(src, path, level));
+            EXPECT_TRUE(stats, dst.readFromFile(path));
+            EXPECT_TRUE(stats, bitmaps_equal(ref, dst));
+            EXPECT_EQ(stats, dst.isOpaque(), opaque);
+            free(dst.pixels());
+        }
+        free(src.pixels());
+        free(ref.pixels());
+    }
+    remove(path);
+}
+
+static void test_png_writer_rows(GTestStats* stats) {
+    const char path[] = "test_png_writer_rows.png";
+    GBitmap src;
+    src.alloc(40, 30);
+    fill_random(src, false);
+
+    auto writer = GPNGWriter::Create(path, src.width(), src.height());
+    EXPECT_PTR(stats, writer.get());
+    EXPECT_FALSE(stats, writer->finish());     // too early: no rows written yet
+    for (int y = 0; y < src.height(); ++y) {
+        EXPECT_TRUE(stats, writer->writeRow(src.getAddr(0, y)));
+    }
+    EXPECT_FALSE(stats, writer->writeRow(src.getAddr(0, 0)));   // too many rows
+    EXPECT_TRUE(stats, writer->finish());
+
+    GBitmap dst;
+    EXPECT_TRUE(stats, dst.readFromFile(path));
+    EXPECT_EQ(stats, dst.width(), src.width());
+    EXPECT_EQ(stats, dst.height(), src.height());
+
+    free(src.pixels());
+    free(dst.pixels());
+    remove(path);
+}
+
+static void test_pixel_convert(GTestStats* stats) {
+    // every (color, alpha) pair, plus a few extra so the count isn't a multiple of the SIMD width
+    const int N = 256 * 256 + 3;
+    std::vector<uint8_t> rgba(N * 4);
+    for (int i = 0; i < N; ++i) {
+        const unsigned c = i & 0xFF, a = (i >> 8) & 0xFF;
+        rgba[i*4 + 0] = c;
+        rgba[i*4 + 1] = 255 - c;
+        rgba[i*4 + 2] = c >> 1;
+        rgba[i*4 + 3] = a;
+    }
+
+    std::vector<GPixel> pixels(N);
+    GConvertRGBAToPixels(rgba.data(), N, pixels.data());
+    int premulErrors = 0;
+    for (int i = 0; i < N; ++i) {
+        const uint8_t* s = &rgba[i*4];
+        auto mul = [](unsigned c, unsigned a) { return (c * a + 127) / 255; };
+        premulErrors += pixels[i] != GPixel_PackARGB(s[3], mul(s[0], s[3]), mul(s[1], s[3]),
+                                                     mul(s[2], s[3]));
+    }
+    EXPECT_EQ(stats, premulErrors, 0);
+
+    // every legal premul (color, alpha) pair, i.e. color <= alpha
+    pixels.clear();
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned c = 0; c <= a; ++c) {
+            pixels.push_back(GPixel_PackARGB(a, c, a - c, c >> 1));
+        }
+    }
+    rgba.resize(pixels.size() * 4);
+    GConvertPixelsToRGBA(pixels.data(), (int)pixels.size(), rgba.data());
+    int unpremulErrors = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        const unsigned a = GPixel_GetA(pixels[i]);
+        auto div = [a](unsigned c) { return (a != 0 && a != 255) ? (c * 255 + a/2) / a : c; };
+        const uint8_t* d = &rgba[i*4];
+        unpremulErrors += d[0] != div(GPixel_GetR(pixels[i])) ||
+                          d[1] != div(GPixel_GetG(pixels[i])) ||
+                          d[2] != div(GPixel_GetB(pixels[i])) ||
+                          d[3] != a;
+    }
+    EXPECT_EQ(stats, unpremulErrors, 0);
+}
+
+static void test_load_bitmaps(GTestStats* stats) {
+    const std::vector<std::string> paths = {
+        "apps/wheel.png", "apps/no_such_file.png", "apps/spock.png", "apps/wheel.png",
+    };
+    auto results = GLoadBitmaps(paths, 3);
+    EXPECT_EQ(stats, results.size(), paths.size());
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        GBitmap expected;
+        bool success = expected.readFromFile(paths[i].c_str());
+        EXPECT_EQ(stats, results[i].fSuccess, success);
+        if (success) {
+            EXPECT_TRUE(stats, bitmaps_equal(results[i].fBitmap, expected));
+            EXPECT_TRUE(stats, results[i].fDecodeMS >= 0);
+        }
+        free(expected.pixels());
+        free(results[i].fBitmap.pixels());
+    }
+}
+
+static void remove_dir(const char path[]) {
+    if (DIR* dir = opendir(path)) {
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                remove((std::string(path) + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+static void test_image_cache(GTestStats* stats) {
+    GBitmap spock, wheel;
+    spock.readFromFile("apps/spock.png");
+    wheel.readFromFile("apps/wheel.png");
+    const size_t spockBytes = spock.height() * spock.rowBytes();
+
+    // room for spock, but not for spock and wheel together
+    GImageCache cache(spockBytes);
+    EXPECT_TRUE(stats, cache.get("apps/no_such_file.png") == nullptr);
+
+    auto a = cache.get("apps/spock.png");
+    auto b = cache.get("apps/spock.png");
+    EXPECT_TRUE(stats, a && a == b);
+    EXPECT_TRUE(stats, bitmaps_equal(*a, spock));
+    EXPECT_EQ(stats, cache.stats().fHits, 1);
+    EXPECT_EQ(stats, cache.stats().fMisses, 1);
+    EXPECT_EQ(stats, cache.stats().fBytesUsed, spockBytes);
+
+    auto c = cache.get("apps/wheel.png");      // evicts spock
+    EXPECT_TRUE(stats, bitmaps_equal(*c, wheel));
+    EXPECT_EQ(stats, cache.stats().fEvictions, 1);
+    EXPECT_EQ(stats, cache.stats().fCount, 1);
+    EXPECT_TRUE(stats, bitmaps_equal(*a, spock));      // still valid while we hold it
+
+    auto d = cache.get("apps/spock.png");      // decoded again, evicting wheel
+    EXPECT_TRUE(stats, d != a);
+    EXPECT_EQ(stats, cache.stats().fMisses, 3);
+    EXPECT_EQ(stats, cache.stats().fEvictions, 2);
+
+    cache.purge();
+    EXPECT_EQ(stats, cache.stats().fCount, 0);
+    EXPECT_EQ(stats, cache.stats().fBytesUsed, (size_t)0);
+
+    // A second cache sharing the disk directory reads the raw pixels instead of decoding
+    const char dir[] = "test_image_cache.tmp";
+    mkdir(dir, 0755);
+    {
+        GImageCache first(spockBytes, dir);
+        first.get("apps/spock.png");
+        EXPECT_EQ(stats, first.stats().fDiskHits, 0);
+
+        GImageCache second(spockBytes, dir);
+        auto e = second.get("apps/spock.png");
+        EXPECT_EQ(stats, second.stats().fDiskHits, 1);
+        EXPECT_TRUE(stats, e && bitmaps_equal(*e, spock));
+        EXPECT_EQ(stats, e->isOpaque(), spock.isOpaque());
+    }
+    remove_dir(dir);
+
+    // Caches writing the same image at once each write their own temporary file, so the one that
+    // is renamed into place is whole, and none are left behind
+    mkdir(dir, 0755);
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&]() { GImageCache(spockBytes, dir).get("apps/spock.png"); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        int files = 0;
+        if (DIR* d = opendir(dir)) {
+            while (dirent* entry = readdir(d)) {
+                files += entry->d_name[0] != '.';
+            }
+            closedir(d);
+        }
+        EXPECT_EQ(stats, files, 1);
+
+        GImageCache cache(spockBytes, dir);
+        auto e = cache.get("apps/spock.png");
+        EXPECT_EQ(stats, cache.stats().fDiskHits, 1);
+        EXPECT_TRUE(stats, e && bitmaps_equal(*e, spock));
+    }
+    remove_dir(dir);
+
+    free(spock.pixels());
+    free(wheel.pixels());
+}
+
+static void test_raw_bitmap(GTestStats* stats) {
+    const char path[] = "test_raw_bitmap.graw";
+
+    for (bool opaque : { false, true }) {
+        GBitmap src;
+        src.alloc(37, 19);
+        fill_random(src, opaque);
+        src.setIsOpaque(GBitmap::kCompute_IsOpaque);
+        EXPECT_TRUE(stats, src.writeToRawFile(path));
+
+        auto mapped = GMappedBitmap::Open(path);
+        EXPECT_TRUE(stats, mapped != nullptr);
+        if (mapped) {
+            const GBitmap& dst = mapped->bitmap();
+            EXPECT_TRUE(stats, bitmaps_equal(src, dst));
+            EXPECT_EQ(stats, dst.isOpaque(), opaque);
+            // the pixels are mapped directly, so they start on a page boundary
+            EXPECT_EQ(stats, (uintptr_t)dst.pixels() % 4096, (uintptr_t)0);
+
+            // drawing into the (copy-on-write) mapping does not change the file
+            *dst.getAddr(0, 0) = ~*src.getAddr(0, 0);
+            auto again = GMappedBitmap::Open(path);
+            EXPECT_TRUE(stats, again && bitmaps_equal(src, again->bitmap()));
+        }
+        free(src.pixels());
+    }
+
+    // a header whose pixels' size overflows 64 bits (2 rows of 2^63 bytes)
+    {
+        GBitmap src;
+        src.alloc(4, 2);
+        fill_random(src, true);
+        EXPECT_TRUE(stats, src.writeToRawFile(path));
+        free(src.pixels());
+
+        GRawBitmapHeader header;
+        FILE* file = fopen(path, "r+b");
+        EXPECT_TRUE(stats, file && fread(&header, sizeof(header), 1, file) == 1);
+        if (file) {
+            header.fRowBytes = (uint64_t)1 << 63;
+            fseek(file, 0, SEEK_SET);
+            fwrite(&header, sizeof(header), 1, file);
+            fclose(file);
+        }
+        EXPECT_TRUE(stats, GMappedBitmap::Open(path) == nullptr);
+    }
+
+    // not a raw bitmap
+    EXPECT_TRUE(stats, GMappedBitmap::Open("apps/spock.png") == nullptr);
+    EXPECT_TRUE(stats, GMappedBitmap::Open("no_such_file.graw") == nullptr);
+    remove(path);
+}
+
+static void test_mapped_bitmap(GTestStats* stats) {
+    const char path[] = "test_mapped_bitmap.graw";
+
+    // render straight into a new file's pixels, which start out as zeros
+    auto created = GMappedBitmap::Create(path, 37, 19);
+    EXPECT_TRUE(stats, created != nullptr);
+    if (!created) {
+        return;
+    }
+    const GBitmap& bm = created->bitmap();
+    EXPECT_EQ(stats, *bm.getAddr(36, 18), (GPixel)0);
+    GCanvasOptions options;
+    options.fLinearBlending = true;
+    if (auto canvas = GCreateCanvas(bm, options)) {
+        canvas->clear({0, 0, 1, 1});
+        canvas->drawRect(GRect::LTRB(5, 3, 20, 15), GPaint({1, 1, 0, 0.5f}));
+    }
+    EXPECT_TRUE(stats, *bm.getAddr(0, 0) != 0);
+    EXPECT_TRUE(stats, *bm.getAddr(10, 10) != *bm.getAddr(0, 0));
+    EXPECT_TRUE(stats, created->flush());
+
+    // once flushed, the file holds what was drawn
+    auto opened = GMappedBitmap::Open(path);
+    EXPECT_TRUE(stats, opened && bitmaps_equal(bm, opened->bitmap()));
+    created.reset();
+    opened.reset();
+    remove(path);
+}
+
+static void test_huge_pages(GTestStats* stats) {
+    const uintptr_t hugePage = 2 * 1024 * 1024;
+
+    for (size_t rowBytes : { (size_t)0, (size_t)(1000 * sizeof(GPixel)) }) {
+        GBitmap bm;
+        EXPECT_TRUE(stats, bm.allocHugePages(700, 900, rowBytes));
+        EXPECT_EQ(stats, bm.rowBytes(), rowBytes ? rowBytes : 700 * sizeof(GPixel));
+        EXPECT_EQ(stats, (uintptr_t)bm.pixels() % hugePage, (uintptr_t)0);
+        bool zero = true;
+        for (int y = 0; y < bm.height(); ++y) {
+            for (int x = 0; x < bm.width(); ++x) {
+                zero &= *bm.getAddr(x, y) == 0;
+            }
+        }
+        EXPECT_TRUE(stats, zero);
+        free(bm.pixels());
+    }
+}
@@ -0,0 +1,1331 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GCanvas.h"
+#include "../include/GPathBuilder.h"
+#include "../include/GPixmap.h"
+#include "../include/GShader.h"
+#include "tests.h"
+
+#include <functional>
+
+template <typename T> static bool pixmaps_equal(const GPixmap<T>& a, const GPixmap<T>& b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        return false;
+    }
+    for (int y = 0; y < a.height(); ++y) {
+        if (memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * sizeof(T))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the number of pixels whose value is not v
+template <typename T> static int count_not(const GPixmap<T>& bm, unsigned v) {
+    int n = 0;
+    for (int y = 0; y < bm.height(); ++y) {
+        for (int x = 0; x < bm.width(); ++x) {
+            n += *bm.getAddr(x, y) != v;
+        }
+    }
+    return n;
+}
+
+/**
+ *  A 565 bitmap, and a library canvas that draws into it, for tests that look at the pixels that
+ *  draws touch.
+ */
+class TestFrame {
+public:
+    TestFrame(int w, int h) {
+        fBitmap.alloc(w, h);
+        fCanvas = GCreateCanvas(fBitmap);
+    }
+    ~TestFrame() { free(fBitmap.pixels()); }
+    TestFrame(const TestFrame&) = delete;
+    TestFrame& operator=(const TestFrame&) = delete;
+
+    GCanvas* canvas() const { return fCanvas.get(); }
+    const G565Bitmap& bitmap() const { return fBitmap; }
+
+    int at(int x, int y) const { return (int)*fBitmap.getAddr(x, y); }
+
+    // Returns the number of pixels that are not black
+    int count() const { return count_not(fBitmap, 0); }
+
+private:
+    G565Bitmap               fBitmap;
+    std::unique_ptr<GCanvas> fCanvas;
+};
+
+/**
+ *  Clears both frames to black, draws into each (with drawA and drawB), and returns whether they
+ *  hold the same pixels. Tests use it to check that two ways of drawing something agree.
+ */
+static bool draws_equal(TestFrame& a, TestFrame& b, const std::function<void(GCanvas*)>& drawA,
+                        const std::function<void(GCanvas*)>& drawB) {
+    a.canvas()->clear({0, 0, 0, 1});
+    drawA(a.canvas());
+    b.canvas()->clear({0, 0, 0, 1});
+    drawB(b.canvas());
+    return pixmaps_equal(a.bitmap(), b.bitmap());
+}
+
+// As above, but drawing the same thing into both (e.g. when the canvases are set up differently)
+static bool draws_equal(TestFrame& a, TestFrame& b, const std::function<void(GCanvas*)>& draw) {
+    return draws_equal(a, b, draw, draw);
+}
+
+// A path of one polygon (see GPathBuilder::addPolygon)
+static std::shared_ptr<GPath> make_polygon(const std::vector<GPoint>& pts) {
+    GPathBuilder bu;
+    bu.addPolygon(pts.data(), (int)pts.size());
+    return bu.detach();
+}
+
+static void test_alpha_canvas(GTestStats* stats) {
+    GAlphaBitmap bm;
+    bm.alloc(20, 20);
+    auto canvas = GCreateCanvas(bm);
+    EXPECT_PTR(stats, canvas.get());
+    EXPECT_NULL(stats, GCreateCanvas(GAlphaBitmap()).get());
+
+    canvas->clear({0, 0, 0, 1});
+    EXPECT_EQ(stats, count_not(bm, 0xFF), 0);
+    canvas->clear({1, 1, 1, 0});
+    EXPECT_EQ(stats, count_not(bm, 0), 0);
+
+    // only pixel centers inside the rect are drawn, and only the paint's alpha matters
+    canvas->drawRect(GRect::LTRB(2.4f, 3.6f, 7.4f, 8.4f), GPaint({1, 0, 0, 0.5f}));
+    EXPECT_EQ(stats, count_not(bm, 0), 5 * 4);
+    EXPECT_EQ(stats, *bm.getAddr(2, 4), (GAlpha)128);
+    EXPECT_EQ(stats, *bm.getAddr(7, 4), (GAlpha)0);
+    EXPECT_EQ(stats, *bm.getAddr(2, 3), (GAlpha)0);
+
+    // srcover: 128 + (1 - 128/255) * 128
+    canvas->drawRect(GRect::LTRB(2.4f, 3.6f, 7.4f, 8.4f), GPaint({1, 0, 0, 0.5f}));
+    EXPECT_EQ(stats, *bm.getAddr(2, 4), (GAlpha)192);
+
+    GPaint clear;
+    clear.setBlendMode(GBlendMode::kClear);
+    canvas->drawRect(GRect::WH(20, 20), clear);
+    EXPECT_EQ(stats, count_not(bm, 0), 0);
+
+    // the same polygon drawn as a path draws the same pixels
+    const GPoint pts[] = { {1, 1}, {18, 4}, {15, 17}, {3, 12} };
+    GAlphaBitmap bm2;
+    bm2.alloc(20, 20);
+    canvas->drawConvexPolygon(pts, 4, GPaint());
+    GPathBuilder bu;
+    bu.addPolygon(pts, 4);
+    GCreateCanvas(bm2)->drawPath(*bu.detach(), GPaint());
+    EXPECT_TRUE(stats, count_not(bm, 0) > 100);
+    EXPECT_TRUE(stats, pixmaps_equal(bm, bm2));
+
+    free(bm.pixels());
+    free(bm2.pixels());
+}
+
+static void test_alpha_shaders(GTestStats* stats) {
+    GAlphaBitmap mask;
+    mask.alloc(4, 2);
+    for (int x = 0; x < 4; ++x) {
+        *mask.getAddr(x, 0) = x * 85;
+        *mask.getAddr(x, 1) = 255;
+    }
+
+    GPixel row[8];
+    auto tint = GCreateAlphaShader(mask, {1, 0, 0, 1}, GMatrix::Translate(2, 0));
+    EXPECT_TRUE(stats, tint->setContext(GMatrix()));
+    tint->shadeRow(0, 0, 8, row);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(0, 0, 0, 0));       // clamped to mask[0]
+    EXPECT_EQ(stats, row[3], GPixel_PackARGB(85, 85, 0, 0));
+    EXPECT_EQ(stats, row[7], GPixel_PackARGB(255, 255, 0, 0));   // clamped to mask[3]
+
+    // the mask shader draws its source only where the mask is
+    GAlphaBitmap solid;
+    solid.alloc(1, 1);
+    *solid.pixels() = 255;
+    auto blue = GCreateAlphaShader(solid, {0, 0, 1, 1}, GMatrix());
+    auto masked = GCreateMaskShader(blue, mask, GMatrix::Translate(2, 0));
+    EXPECT_TRUE(stats, masked->setContext(GMatrix()));
+    masked->shadeRow(0, 1, 8, row);
+    EXPECT_EQ(stats, row[1], GPixel_PackARGB(0, 0, 0, 0));
+    EXPECT_EQ(stats, row[2], GPixel_PackARGB(255, 0, 0, 255));
+    EXPECT_EQ(stats, row[6], GPixel_PackARGB(0, 0, 0, 0));
+
+    // drawMask puts the mask's values into an (empty) alpha canvas
+    GAlphaBitmap dst;
+    dst.alloc(8, 4);
+    GCreateCanvas(dst)->drawMask(mask, 3, 1, GPaint());
+    EXPECT_EQ(stats, *dst.getAddr(2, 1), (GAlpha)0);
+    EXPECT_EQ(stats, *dst.getAddr(4, 1), (GAlpha)85);
+    EXPECT_EQ(stats, *dst.getAddr(6, 2), (GAlpha)255);
+    EXPECT_EQ(stats, *dst.getAddr(6, 3), (GAlpha)0);
+
+    free(mask.pixels());
+    free(solid.pixels());
+    free(dst.pixels());
+}
+
+#include "../include/GPixelConvert.h"
+
+static void test_565_convert(GTestStats* stats) {
+    // every 565 value expands to an opaque pixel, and packs back to itself
+    std::vector<GPixel565> all(65536), back(65536);
+    std::vector<GPixel> expanded(65536);
+    for (int i = 0; i < 65536; ++i) {
+        all[i] = i;
+    }
+    GConvert565ToPixels(all.data(), 65536, expanded.data());
+    GConvertPixelsTo565(expanded.data(), 65536, back.data());
+    int errors = 0;
+    for (int i = 0; i < 65536; ++i) {
+        errors += GPixel_GetA(expanded[i]) != 0xFF || back[i] != all[i] ||
+                  GPixel_GetR(expanded[i]) != GPixel565_GetR(all[i]) ||
+                  GPixel_GetB(expanded[i]) != GPixel565_GetB(all[i]);
+    }
+    EXPECT_EQ(stats, errors, 0);
+
+    // the (SIMD) row packer rounds exactly like GPixel565_PackRGB
+    std::vector<GPixel> pixels;
+    for (unsigned c = 0; c < 256; ++c) {
+        pixels.push_back(GPixel_PackARGB(255, c, 255 - c, c / 2));
+    }
+    std::vector<GPixel565> packed(pixels.size());
+    GConvertPixelsTo565(pixels.data(), (int)pixels.size(), packed.data());
+    errors = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        errors += packed[i] != GPixel565_PackRGB(GPixel_GetR(pixels[i]), GPixel_GetG(pixels[i]),
+                                                 GPixel_GetB(pixels[i]));
+    }
+    EXPECT_EQ(stats, errors, 0);
+}
+
+static void test_565_canvas(GTestStats* stats) {
+    G565Bitmap bm;
+    bm.alloc(16, 16);
+    auto canvas = GCreateCanvas(bm);
+    EXPECT_PTR(stats, canvas.get());
+
+    canvas->clear({1, 0, 0, 1});
+    EXPECT_EQ(stats, *bm.getAddr(5, 5), (GPixel565)0xF800);
+
+    // opaque src fills, translucent src blends with the (opaque) dst
+    canvas->drawRect(GRect::WH(8, 16), GPaint({0, 0, 1, 1}));
+    EXPECT_EQ(stats, *bm.getAddr(7, 5), (GPixel565)0x001F);
+    EXPECT_EQ(stats, *bm.getAddr(8, 5), (GPixel565)0xF800);
+
+    canvas->drawRect(GRect::WH(16, 8), GPaint({0, 1, 0, 0.5f}));
+    // green: 128 + 0, blue: (1 - 128/255) * 255 = 127
+    EXPECT_EQ(stats, *bm.getAddr(7, 5), GPixel565_PackRGB(0, 128, 127));
+    EXPECT_EQ(stats, *bm.getAddr(7, 8), (GPixel565)0x001F);
+
+    // kClear leaves black, and kDstIn scales by the src's alpha
+    GPaint paint;
+    paint.setBlendMode(GBlendMode::kClear);
+    canvas->drawRect(GRect::LTRB(0, 0, 1, 1), paint);
+    EXPECT_EQ(stats, *bm.getAddr(0, 0), (GPixel565)0);
+    paint.setBlendMode(GBlendMode::kDstIn).setAlpha(0.5f);
+    canvas->drawRect(GRect::LTRB(8, 8, 16, 16), paint);
+    EXPECT_EQ(stats, *bm.getAddr(8, 8), GPixel565_PackRGB(GPixel565_GetR(0xF800) * 128 / 255,
+                                                           0, 0));
+    free(bm.pixels());
+}
+
+static void test_f16_convert(GTestStats* stats) {
+    // every (non-NaN) half converts to a float that converts back to it, row or scalar
+    std::vector<GHalf> halfs, back;
+    for (int i = 0; i < 65536; ++i) {
+        if ((i & 0x7C00) != 0x7C00 || (i & 0x3FF) == 0) {
+            halfs.push_back(i);
+        }
+    }
+    const int n = (int)halfs.size();
+    std::vector<float> floats(n);
+    back.resize(n);
+    GConvertHalfToFloat(halfs.data(), n, floats.data());
+    GConvertFloatToHalf(floats.data(), n, back.data());
+    int errors = 0;
+    for (int i = 0; i < n; ++i) {
+        errors += back[i] != halfs[i] || floats[i] != GHalfToFloat(halfs[i]) ||
+                  GFloatToHalf(floats[i]) != halfs[i];
+    }
+    EXPECT_EQ(stats, errors, 0);
+
+    EXPECT_EQ(stats, GFloatToHalf(1), (GHalf)0x3C00);
+    EXPECT_EQ(stats, GFloatToHalf(-2), (GHalf)0xC000);
+    EXPECT_EQ(stats, GFloatToHalf(1e6f), (GHalf)0x7C00);
+    EXPECT_EQ(stats, GFloatToHalf(1 + 1.5f / 2048), (GHalf)0x3C01);     // rounds to nearest
+    EXPECT_EQ(stats, GFloatToHalf(1 + 1.0f / 2048), (GHalf)0x3C00);     // ties to even
+    EXPECT_EQ(stats, GFloatToHalf(0x1p-24f), (GHalf)0x0001);            // smallest denormal
+
+    // GPixels survive a round trip through F16, and out of range values are pinned
+    std::vector<GPixel> pixels, pixels2;
+    for (unsigned a = 0; a < 256; ++a) {
+        pixels.push_back(GPixel_PackARGB(a, a / 2, a, a / 3));
+    }
+    std::vector<GPixelF16> wide(pixels.size());
+    pixels2.resize(pixels.size());
+    GConvertPixelsToF16(pixels.data(), (int)pixels.size(), wide.data());
+    GConvertF16ToPixels(wide.data(), (int)wide.size(), pixels2.data());
+    EXPECT_TRUE(stats, pixels == pixels2);
+
+    GPixelF16 odd = { GFloatToHalf(0.75f), GFloatToHalf(-1), GFloatToHalf(0.25f),
+                      GFloatToHalf(0.5f) };
+    GPixel p;
+    GConvertF16ToPixels(&odd, 1, &p);
+    EXPECT_EQ(stats, p, GPixel_PackARGB(128, 128, 0, 64));
+
+    // NaNs are pinned to 0, wherever the pixel is in the row (the first 4 are converted together)
+    const GHalf nan = 0x7E00, one = GFloatToHalf(1), half = GFloatToHalf(0.5f);
+    const GPixelF16 nanAlpha = { one, one, one, nan };
+    const GPixelF16 nanColor = { nan, GFloatToHalf(0.25f), GFloatToHalf(0.25f), half };
+    const GPixelF16 row[] = { nanAlpha, nanColor, odd, odd, nanAlpha, nanColor };
+    GPixel converted[6];
+    GConvertF16ToPixels(row, 6, converted);
+    for (int i : { 0, 4 }) {
+        EXPECT_EQ(stats, converted[i], (GPixel)0);
+        EXPECT_EQ(stats, converted[i + 1], GPixel_PackARGB(128, 0, 64, 64));
+    }
+}
+
+static void test_f16_canvas(GTestStats* stats) {
+    GF16Bitmap bm;
+    bm.alloc(16, 16);
+    auto canvas = GCreateCanvas(bm);
+    EXPECT_PTR(stats, canvas.get());
+    EXPECT_NULL(stats, GCreateCanvas(GF16Bitmap()).get());
+
+    canvas->clear({0, 0, 1, 1});
+    EXPECT_EQ(stats, bm.getAddr(3, 3)->b, GFloatToHalf(1));
+    EXPECT_EQ(stats, bm.getAddr(3, 3)->r, GFloatToHalf(0));
+
+    // 0.5 over blue
+    canvas->drawRect(GRect::WH(8, 16), GPaint({1, 0, 0, 0.5f}));
+    const GPixelF16* p = bm.getAddr(7, 0);
+    EXPECT_EQ(stats, p->r, GFloatToHalf(0.5f));
+    EXPECT_EQ(stats, p->b, GFloatToHalf(0.5f));
+    EXPECT_EQ(stats, p->a, GFloatToHalf(1));
+
+    // many faint draws keep accumulating: 8-bit srcover of alpha 1/255 stalls at ~0.5
+    canvas->clear({0, 0, 0, 0});
+    for (int i = 0; i < 400; ++i) {
+        canvas->drawRect(GRect::WH(16, 16), GPaint({1, 1, 1, 1 / 255.0f}));
+    }
+    const float expected = 1 - powf(1 - 1 / 255.0f, 400);      // ~0.79
+    EXPECT_TRUE(stats, fabsf(GHalfToFloat(bm.getAddr(5, 5)->a) - expected) < 0.01f);
+
+    GPixel row[16];
+    GConvertF16ToPixels(bm.getAddr(0, 5), 16, row);
+    EXPECT_EQ(stats, GPixel_GetA(row[0]), GRoundToInt(expected * 255));
+    free(bm.pixels());
+}
+
+static void test_linear_canvas(GTestStats* stats) {
+    GBitmap bm;
+    bm.alloc(4, 4);
+    GCanvasOptions options;
+    options.fLinearBlending = true;
+    auto canvas = GCreateCanvas(bm, options);
+    EXPECT_PTR(stats, canvas.get());
+
+    // opaque colors are unchanged by the trip through linear
+    int errors = 0;
+    for (int i = 0; i < 256; ++i) {
+        canvas->clear({i / 255.0f, 0, 1 - i / 255.0f, 1});
+        const GPixel p = *bm.getAddr(1, 1);
+        errors += GPixel_GetR(p) != i || GPixel_GetB(p) != 255 - i || GPixel_GetA(p) != 255;
+    }
+    EXPECT_EQ(stats, errors, 0);
+
+    // half white over black is half the light, i.e. sRGB 0.735 (not 0.5)
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawRect(GRect::WH(2, 4), GPaint({1, 1, 1, 0.5f}));
+    EXPECT_EQ(stats, *bm.getAddr(1, 1), GPixel_PackARGB(255, 188, 188, 188));
+    EXPECT_EQ(stats, *bm.getAddr(2, 1), GPixel_PackARGB(255, 0, 0, 0));
+
+    // translucent results stay premultiplied
+    canvas->clear({0, 0, 0, 0});
+    canvas->drawRect(GRect::WH(4, 4), GPaint({1, 0.5f, 0, 0.25f}));
+    const GPixel p = *bm.getAddr(1, 1);
+    EXPECT_EQ(stats, GPixel_GetA(p), 64);
+    EXPECT_TRUE(stats, GPixel_GetR(p) <= 64 && GPixel_GetG(p) > 0);
+    free(bm.pixels());
+}
+
+static void test_save_layer(GTestStats* stats) {
+    G565Bitmap bm;
+    bm.alloc(16, 16);
+    auto canvas = GCreateCanvas(bm);
+    canvas->clear({1, 1, 1, 1});
+
+    // group opacity: the overlap of the two rects is no darker than the rest of the group
+    canvas->saveLayer(nullptr, GPaint({0, 0, 0, 0.5f}));
+    canvas->drawRect(GRect::LTRB(0, 0, 8, 8), GPaint({1, 0, 0, 1}));
+    canvas->drawRect(GRect::LTRB(4, 4, 12, 12), GPaint({1, 0, 0, 1}));
+    canvas->restore();
+    const GPixel565 half = GPixel565_PackRGB(255, 127, 127);
+    EXPECT_EQ(stats, *bm.getAddr(1, 1), half);
+    EXPECT_EQ(stats, *bm.getAddr(5, 5), half);
+    EXPECT_EQ(stats, *bm.getAddr(10, 10), half);
+    EXPECT_EQ(stats, *bm.getAddr(14, 14), (GPixel565)0xFFFF);
+
+    // the layer's bounds (mapped by the CTM) clip what is drawn, and the CTM is restored
+    canvas->clear({1, 1, 1, 1});
+    canvas->translate(2, 2);
+    const GRect bounds = GRect::LTRB(0, 0, 4, 4);
+    canvas->saveLayer(&bounds, GPaint());
+    canvas->translate(100, 100);
+    canvas->restore();
+    canvas->saveLayer(&bounds, GPaint());
+    canvas->drawRect(GRect::LTRB(-2, -2, 14, 14), GPaint({0, 0, 1, 1}));
+    canvas->restore();
+    EXPECT_EQ(stats, *bm.getAddr(1, 1), (GPixel565)0xFFFF);
+    EXPECT_EQ(stats, *bm.getAddr(2, 2), (GPixel565)0x001F);
+    EXPECT_EQ(stats, *bm.getAddr(5, 5), (GPixel565)0x001F);
+    EXPECT_EQ(stats, *bm.getAddr(6, 6), (GPixel565)0xFFFF);
+
+    // nested layers multiply their alphas, and the layer's blendmode is used to composite it
+    GAlphaBitmap mask;
+    mask.alloc(8, 8);
+    auto alpha = GCreateCanvas(mask);
+    alpha->clear({0, 0, 0, 1});
+    GPaint dstOut({0, 0, 0, 0.5f});
+    dstOut.setBlendMode(GBlendMode::kDstOut);
+    alpha->saveLayer(nullptr, dstOut);
+    alpha->saveLayer(nullptr, GPaint({0, 0, 0, 0.5f}));
+    alpha->drawRect(GRect::WH(4, 8), GPaint());
+    alpha->restore();
+    alpha->restore();
+    EXPECT_EQ(stats, *mask.getAddr(1, 1), (GAlpha)(255 - 64));
+    EXPECT_EQ(stats, *mask.getAddr(5, 1), (GAlpha)255);
+
+    free(bm.pixels());
+    free(mask.pixels());
+}
+
+#include "../include/GBlur.h"
+
+static void test_blur(GTestStats* stats) {
+    GBitmap bm, bm2;
+    bm.alloc(5, 5);
+    bm2.alloc(5, 5);
+    *bm.getAddr(2, 2) = GPixel_PackARGB(255, 255, 90, 0);
+    EXPECT_FALSE(stats, GBoxBlur(bm, GBitmap(), 1));
+
+    // a single pixel spreads evenly over its 3x3 neighborhood
+    EXPECT_TRUE(stats, GBoxBlur(bm, bm2, 1));
+    EXPECT_EQ(stats, *bm2.getAddr(1, 3), GPixel_PackARGB(28, 28, 10, 0));
+    EXPECT_EQ(stats, *bm2.getAddr(2, 2), GPixel_PackARGB(28, 28, 10, 0));
+    EXPECT_EQ(stats, *bm2.getAddr(0, 2), (GPixel)0);
+
+    // blurring in place gives the same result
+    EXPECT_TRUE(stats, GBoxBlur(bm, bm, 1));
+    EXPECT_EQ(stats, memcmp(bm.pixels(), bm2.pixels(), 25 * sizeof(GPixel)), 0);
+    free(bm.pixels());
+    free(bm2.pixels());
+
+    // a constant image is unchanged (away from the edges, which fade to transparent)
+    const GPixel c = GPixel_PackARGB(200, 100, 50, 25);
+    bm.alloc(64, 40);
+    for (int y = 0; y < 40; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            *bm.getAddr(x, y) = c;
+        }
+    }
+    GGaussianBlur(bm, bm, 3);
+    EXPECT_EQ(stats, *bm.getAddr(32, 20), c);
+    EXPECT_EQ(stats, *bm.getAddr(20, 12), c);
+    EXPECT_TRUE(stats, GPixel_GetA(*bm.getAddr(0, 0)) < 100);
+    free(bm.pixels());
+
+    // a blurred layer spreads past the rect that was drawn into it
+    G565Bitmap frame;
+    frame.alloc(32, 32);
+    auto canvas = GCreateCanvas(frame);
+    canvas->clear({1, 1, 1, 1});
+    const GRect r = GRect::LTRB(12, 12, 22, 22);
+    canvas->saveLayer(&r, GPaint(), 2);
+    canvas->drawRect(r, GPaint({0, 0, 0, 1}));
+    canvas->restore();
+    EXPECT_TRUE(stats, *frame.getAddr(10, 16) != 0xFFFF);
+    EXPECT_TRUE(stats, *frame.getAddr(16, 16) == 0);
+    EXPECT_TRUE(stats, *frame.getAddr(2, 16) == 0xFFFF);
+    free(frame.pixels());
+}
+
+#include "../include/GColorFilter.h"
+
+static void test_color_filter(GTestStats* stats) {
+    // swaps red and blue, and halves alpha
+    const float swap[20] = {
+        0, 0, 1, 0,   0,
+        0, 1, 0, 0,   0,
+        1, 0, 0, 0,   0,
+        0, 0, 0, 0.5f, 0,
+    };
+    auto matrix = GCreateColorMatrixFilter(swap);
+    EXPECT_FALSE(stats, matrix->preservesAlpha());
+
+    GPixel row[3] = {
+        GPixel_PackARGB(255, 255, 0, 0), GPixel_PackARGB(128, 64, 32, 0), 0,
+    };
+    matrix->filterRow(row, 3);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(128, 0, 0, 128));
+    EXPECT_EQ(stats, row[1], GPixel_PackARGB(64, 0, 16, 32));
+    EXPECT_EQ(stats, row[2], (GPixel)0);
+
+    const GColor c = matrix->filterColor({1, 0.5f, 0.25f, 1});
+    EXPECT_TRUE(stats, c.r == 0.25f && c.g == 0.5f && c.b == 1 && c.a == 0.5f);
+
+    // inverts each color, leaving alpha alone
+    uint8_t invert[256];
+    for (int i = 0; i < 256; ++i) {
+        invert[i] = 255 - i;
+    }
+    auto table = GCreateTableColorFilter(invert, invert, invert, nullptr);
+    EXPECT_TRUE(stats, table->preservesAlpha());
+    row[0] = GPixel_PackARGB(255, 255, 200, 0);
+    row[1] = GPixel_PackARGB(0x80, 0x80, 0, 0x40);
+    table->filterRow(row, 2);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(255, 0, 55, 255));
+    EXPECT_EQ(stats, row[1], GPixel_PackARGB(0x80, 0, 0x80, 0x40));
+
+    // a shader-less wrapper is just null
+    EXPECT_NULL(stats, GCreateColorFilterShader(nullptr, matrix).get());
+
+    // the canvas filters a paint's color before drawing it: yellow becomes blue
+    G565Bitmap frame;
+    frame.alloc(4, 4);
+    auto canvas = GCreateCanvas(frame);
+    canvas->clear({0, 0, 0, 1});
+    GPaint paint({1, 1, 0, 1});
+    paint.setColorFilter(table);
+    canvas->drawRect(GRect::WH(2, 4), paint);
+    EXPECT_EQ(stats, (int)*frame.getAddr(0, 0), 0x001F);
+    EXPECT_EQ(stats, (int)*frame.getAddr(3, 0), 0);
+    free(frame.pixels());
+}
+
+#include "../include/GRandom.h"
+#include "../src/GBlend.h"
+
+static void test_advanced_modes(GTestStats* stats) {
+    GRandom rand;
+    auto rand_pixel = [&]() {
+        const unsigned a = rand.nextU() & 0xFF;
+        auto c = [&]() { return GMul255(rand.nextU() & 0xFF, a); };
+        return GPixel_PackARGB(a, c(), c(), c());
+    };
+    GPixel src[67], dst[67];
+    for (int i = 0; i < 67; ++i) {
+        src[i] = rand_pixel();
+        dst[i] = rand_pixel();
+    }
+    src[0] = dst[1] = 0;
+    src[2] = dst[3] = GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF);
+
+    for (int m = (int)GBlendMode::kMultiply; m <= (int)GBlendMode::kExclusion; ++m) {
+        GVisitBlendMode(static_cast<GBlendMode>(m), [&](auto tag) {
+            constexpr GBlendMode Mode = decltype(tag)::value;
+            // the vectorized rows match the scalar pixels exactly, and stay premultiplied
+            GPixel row[67], color[67];
+            memcpy(row, dst, sizeof(dst));
+            memcpy(color, dst, sizeof(dst));
+            GBlendRow<Mode>(row, src, 67);
+            GBlendColorRow<Mode>(color, src[5], 67);
+            bool matches = true, premul = true;
+            for (int i = 0; i < 67; ++i) {
+                matches &= row[i] == GBlendPixel<Mode>(src[i], dst[i]);
+                matches &= color[i] == GBlendPixel<Mode>(src[5], dst[i]);
+                const unsigned a = GPixel_GetA(row[i]);
+                premul &= GPixel_GetR(row[i]) <= a && GPixel_GetG(row[i]) <= a &&
+                          GPixel_GetB(row[i]) <= a;
+                premul &= a == GBlendAlpha<GBlendMode::kSrcOver>(GPixel_GetA(src[i]),
+                                                                  GPixel_GetA(dst[i]));
+            }
+            EXPECT_TRUE(stats, matches);
+            EXPECT_TRUE(stats, premul);
+
+            // the 8-bit results agree with the float formulas
+            const GPixel s = src[7], d = dst[7];
+            const float k = 1 / 255.0f;
+            const float f = GBlendAdvanced<Mode>(GPixel_GetR(s) * k, GPixel_GetR(d) * k,
+                                                 GPixel_GetA(s) * k, GPixel_GetA(d) * k);
+            EXPECT_TRUE(stats, std::abs(f * 255 - GPixel_GetR(GBlendPixel<Mode>(s, d))) <= 1);
+        });
+    }
+
+    // a few well known values, for opaque colors
+    const GPixel gray = GPixel_PackARGB(0xFF, 0x80, 0x80, 0x80);
+    const GPixel red  = GPixel_PackARGB(0xFF, 0xFF, 0x40, 0);
+    EXPECT_EQ(stats, GBlendPixel<GBlendMode::kMultiply>(gray, red),
+              GPixel_PackARGB(0xFF, 0x80, 0x20, 0));
+    EXPECT_EQ(stats, GBlendPixel<GBlendMode::kScreen>(gray, red),
+              GPixel_PackARGB(0xFF, 0xFF, 0xA0, 0x80));
+    EXPECT_EQ(stats, GBlendPixel<GBlendMode::kDarken>(gray, red),
+              GPixel_PackARGB(0xFF, 0x80, 0x40, 0));
+    EXPECT_EQ(stats, GBlendPixel<GBlendMode::kDifference>(gray, red),
+              GPixel_PackARGB(0xFF, 0x7F, 0x40, 0x80));
+}
+
+static void test_bitmap_rect(GTestStats* stats) {
+    // a 2x2 bitmap: red, green / blue, white
+    GPixel pixels[4] = {
+        GPixel_PackARGB(0xFF, 0xFF, 0, 0), GPixel_PackARGB(0xFF, 0, 0xFF, 0),
+        GPixel_PackARGB(0xFF, 0, 0, 0xFF), GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF),
+    };
+    const GBitmap bm(2, 2, 2 * sizeof(GPixel), pixels, true);
+    const GPixel565 red = 0xF800, green = 0x07E0, blue = 0x001F, white = 0xFFFF;
+
+    TestFrame frame(8, 8);
+    GCanvas* canvas = frame.canvas();
+
+    // a sprite, at an integer position
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawBitmap(bm, 3, 1, GPaint());
+    EXPECT_EQ(stats, frame.at(3, 1), (int)red);
+    EXPECT_EQ(stats, frame.at(4, 1), (int)green);
+    EXPECT_EQ(stats, frame.at(3, 2), (int)blue);
+    EXPECT_EQ(stats, frame.at(4, 2), (int)white);
+    EXPECT_EQ(stats, frame.at(2, 1), 0);
+    EXPECT_EQ(stats, frame.at(5, 2), 0);
+
+    // scaled up 3x (with the CTM), so each pixel covers 3x3
+    canvas->clear({0, 0, 0, 1});
+    canvas->save();
+    canvas->scale(3, 3);
+    canvas->drawBitmap(bm, 0, 0, GPaint());
+    canvas->restore();
+    EXPECT_EQ(stats, frame.at(2, 2), (int)red);
+    EXPECT_EQ(stats, frame.at(3, 2), (int)green);
+    EXPECT_EQ(stats, frame.at(5, 5), (int)white);
+    EXPECT_EQ(stats, frame.at(6, 6), 0);
+
+    // only src is sampled, however large dst is
+    canvas->drawBitmapRect(bm, GIRect::LTRB(0, 1, 1, 2), GRect::WH(8, 8), GPaint());
+    EXPECT_EQ(stats, frame.at(0, 0), (int)blue);
+    EXPECT_EQ(stats, frame.at(7, 7), (int)blue);
+
+    // however small the scale, or far off dst is
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawBitmapRect(bm, GIRect::LTRB(1, 0, 2, 1), GRect::LTRB(-1e9f, 0, 1e9f, 8),
+                           GPaint());
+    EXPECT_EQ(stats, frame.at(0, 0), (int)green);
+    EXPECT_EQ(stats, frame.at(7, 7), (int)green);
+
+    // or large the src coordinates are
+    std::vector<GPixel> wide(40000, pixels[0]);
+    wide.back() = pixels[3];
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawBitmapRect(GBitmap(40000, 1, 40000 * sizeof(GPixel), wide.data(), true),
+                           GIRect::LTRB(39998, 0, 40000, 1), GRect::WH(8, 8), GPaint());
+    EXPECT_EQ(stats, frame.at(3, 0), (int)red);
+    EXPECT_EQ(stats, frame.at(4, 0), (int)white);
+
+    // the paint's alpha scales the bitmap
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawBitmapRect(bm, GIRect::LTRB(1, 1, 2, 2), GRect::WH(2, 2),
+                           GPaint({0, 0, 0, 0.5f}));
+    EXPECT_EQ(stats, frame.at(1, 1), (int)GPixel565_PackRGB(0x80, 0x80, 0x80));
+}
+
+static void test_bitmap_nine(GTestStats* stats) {
+    // a 3x3 bitmap, with a different color for each region
+    const unsigned rgb[9][3] = {
+        { 0xFF, 0, 0 }, { 0, 0xFF, 0 }, { 0, 0, 0xFF },
+        { 0xFF, 0xFF, 0 }, { 0xFF, 0xFF, 0xFF }, { 0, 0xFF, 0xFF },
+        { 0xFF, 0, 0xFF }, { 0x80, 0x80, 0x80 }, { 0, 0, 0 },
+    };
+    GPixel pixels[9];
+    for (int i = 0; i < 9; ++i) {
+        pixels[i] = GPixel_PackARGB(0xFF, rgb[i][0], rgb[i][1], rgb[i][2]);
+    }
+    const GBitmap bm(3, 3, 3 * sizeof(GPixel), pixels, true);
+    auto color = [&](int i) { return (int)GPixel565_PackRGB(rgb[i][0], rgb[i][1], rgb[i][2]); };
+    const GIRect center = GIRect::LTRB(1, 1, 2, 2);
+
+    G565Bitmap frame, expected;
+    frame.alloc(8, 6);
+    expected.alloc(8, 6);
+    auto canvas = GCreateCanvas(frame);
+    auto other = GCreateCanvas(expected);
+    auto at = [&](int x, int y) { return (int)*frame.getAddr(x, y); };
+
+    // the corners keep their size, and the edges and center stretch
+    canvas->clear({0, 0, 1, 1});
+    canvas->drawBitmapNine(bm, center, GRect::WH(8, 6), GPaint());
+    EXPECT_EQ(stats, at(0, 0), color(0));
+    EXPECT_EQ(stats, at(7, 0), color(2));
+    EXPECT_EQ(stats, at(0, 5), color(6));
+    EXPECT_EQ(stats, at(7, 5), color(8));
+    EXPECT_EQ(stats, at(1, 0), color(1));
+    EXPECT_EQ(stats, at(6, 0), color(1));
+    EXPECT_EQ(stats, at(0, 4), color(3));
+    EXPECT_EQ(stats, at(7, 1), color(5));
+    EXPECT_EQ(stats, at(3, 5), color(7));
+    EXPECT_EQ(stats, at(1, 1), color(4));
+    EXPECT_EQ(stats, at(6, 4), color(4));
+
+    // the same pixels as drawing each region on its own, however dst is positioned or scaled
+    auto same_as_nine_rects = [&](const GRect& dst, float scale, const GPaint& paint) {
+        for (GCanvas* c : { canvas.get(), other.get() }) {
+            c->clear({0, 0, 1, 1});
+            c->save();
+            c->scale(scale, scale);
+        }
+        canvas->drawBitmapNine(bm, center, dst, paint);
+        other->GCanvas::drawBitmapNine(bm, center, dst, paint);
+        canvas->restore();
+        other->restore();
+        return pixmaps_equal(frame, expected);
+    };
+    EXPECT_TRUE(stats, same_as_nine_rects(GRect::LTRB(0.3f, 0.6f, 7.4f, 5.2f), 1, GPaint()));
+    EXPECT_TRUE(stats, same_as_nine_rects(GRect::LTRB(1, 1, 3.5f, 2.5f), 2, GPaint()));
+    EXPECT_TRUE(stats, same_as_nine_rects(GRect::WH(8, 6), 1, GPaint({0, 0, 0, 0.5f})));
+
+    // too small for the corners, which are scaled down to share it
+    canvas->clear({0, 0, 1, 1});
+    canvas->drawBitmapNine(bm, center, GRect::WH(1, 6), GPaint());
+    EXPECT_EQ(stats, at(0, 0), color(0));
+    EXPECT_EQ(stats, at(0, 3), color(3));
+    EXPECT_EQ(stats, at(1, 3), (int)GPixel565_PackRGB(0, 0, 0xFF));
+    EXPECT_TRUE(stats, same_as_nine_rects(GRect::WH(1.5f, 1.5f), 1, GPaint()));
+    free(frame.pixels());
+    free(expected.pixels());
+}
+
+static void test_atlas(GTestStats* stats) {
+    // a 4x1 atlas of 2x1 sprites: red|red, blue|blue
+    GPixel pixels[4] = {
+        GPixel_PackARGB(0xFF, 0xFF, 0, 0), GPixel_PackARGB(0xFF, 0xFF, 0, 0),
+        GPixel_PackARGB(0xFF, 0, 0, 0xFF), GPixel_PackARGB(0xFF, 0, 0, 0xFF),
+    };
+    const GBitmap atlas(4, 1, 4 * sizeof(GPixel), pixels, true);
+    const GIRect src[] = { GIRect::LTRB(2, 0, 4, 1), GIRect::LTRB(0, 0, 2, 1),
+                           GIRect::LTRB(0, 0, 2, 1) };
+    const GMatrix xforms[] = { GMatrix::Translate(0, 0), GMatrix::Translate(4, 2),
+                               GMatrix::Translate(3, 2) };
+
+    TestFrame frame(8, 4);
+    GCanvas* canvas = frame.canvas();
+
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawAtlas(atlas, src, xforms, nullptr, 2, GPaint());
+    EXPECT_EQ(stats, frame.at(0, 0), 0x001F);
+    EXPECT_EQ(stats, frame.at(1, 0), 0x001F);
+    EXPECT_EQ(stats, frame.at(4, 2), 0xF800);
+    EXPECT_EQ(stats, frame.at(6, 2), 0);
+
+    // the last sprite (red, tinted with blue, so black) overlaps the one before it, so they
+    // must be drawn in order, even though it is further left
+    const GColor colors[] = { {1, 1, 1, 1}, {1, 1, 1, 1}, {0, 0, 1, 1} };
+    canvas->drawAtlas(atlas, src, xforms, colors, 3, GPaint());
+    EXPECT_EQ(stats, frame.at(3, 2), 0);
+    EXPECT_EQ(stats, frame.at(4, 2), 0);
+    EXPECT_EQ(stats, frame.at(5, 2), 0xF800);
+
+    // the CTM applies to every sprite
+    canvas->clear({0, 0, 0, 1});
+    canvas->scale(2, 2);
+    canvas->drawAtlas(atlas, src, xforms, nullptr, 1, GPaint({0, 0, 0, 0.5f}));
+    EXPECT_EQ(stats, frame.at(3, 1), (int)GPixel565_PackRGB(0, 0, 0x80));
+    EXPECT_EQ(stats, frame.at(4, 1), 0);
+}
+
+static void test_rrect(GTestStats* stats) {
+    TestFrame frame(10, 10);
+    GCanvas* canvas = frame.canvas();
+    const GPaint paint({1, 1, 1, 1});
+
+    // each row's span is where its center crosses the ellipse
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawOval(GRect::WH(10, 10), paint);
+    EXPECT_EQ(stats, frame.at(2, 0), 0);
+    EXPECT_EQ(stats, frame.at(3, 0), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(6, 0), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(7, 0), 0);
+    EXPECT_EQ(stats, frame.at(0, 4), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(9, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(0, 0), 0);
+    EXPECT_EQ(stats, frame.at(9, 9), 0);
+    const int oval = frame.count();
+    EXPECT_TRUE(stats, oval > 74 && oval < 84);    // pi * 5 * 5
+
+    // the same (but for a few pixels) as the path drawn by GCanvas's default
+    canvas->clear({0, 0, 0, 1});
+    canvas->GCanvas::drawRRect(GRect::WH(10, 10), 5, 5, paint);
+    EXPECT_TRUE(stats, std::abs(frame.count() - oval) <= 4);
+
+    // no radii is just the rect, and radii are limited to half of the rect
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawRRect(GRect::LTRB(1, 2, 5, 8), 0, 3, paint);
+    EXPECT_EQ(stats, frame.count(), 24);
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawRRect(GRect::WH(10, 10), 50, 50, paint);
+    EXPECT_EQ(stats, frame.count(), oval);
+
+    // the CTM scales the radii too
+    canvas->clear({0, 0, 0, 1});
+    canvas->save();
+    canvas->scale(2, 2);
+    canvas->drawRRect(GRect::LTRB(0, 1, 5, 4), 1, 1, paint);
+    canvas->restore();
+    EXPECT_EQ(stats, frame.at(0, 2), 0);
+    EXPECT_EQ(stats, frame.at(1, 3), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(0, 4), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(9, 7), 0);
+    EXPECT_EQ(stats, frame.at(5, 2), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 8), 0);
+}
+
+static void test_lines(GTestStats* stats) {
+    TestFrame frame(10, 10);
+    GCanvas* canvas = frame.canvas();
+    auto draw = [&](GPoint a, GPoint b, const GPaint& paint) {
+        canvas->clear({0, 0, 0, 1});
+        canvas->drawLine(a, b, paint);
+        return frame.count();
+    };
+    const GPaint paint({1, 1, 1, 1});
+
+    // hairlines touch one pixel per column (or row) between their ends, clipped
+    EXPECT_EQ(stats, draw({1, 2.5f}, {8, 2.5f}, paint), 7);
+    EXPECT_EQ(stats, frame.at(1, 2), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(8, 2), 0);
+    EXPECT_EQ(stats, draw({0, 0}, {10, 10}, paint), 10);
+    EXPECT_EQ(stats, frame.at(3, 3), 0xFFFF);
+    EXPECT_EQ(stats, draw({2, 0}, {3, 10}, paint), 10);
+    EXPECT_EQ(stats, draw({-5, 5.5f}, {20, 5.5f}, paint), 10);
+    EXPECT_EQ(stats, draw({3, 3}, {3, 3}, paint), 0);
+
+    // and stay one pixel wide when scaled
+    canvas->save();
+    canvas->scale(2, 2);
+    EXPECT_EQ(stats, draw({0, 1.25f}, {5, 1.25f}, paint), 10);
+    canvas->restore();
+    EXPECT_EQ(stats, frame.at(0, 2), 0xFFFF);
+
+    // antialiased: a line between two rows' centers covers each of them half way
+    GPaint aa(paint);
+    aa.setAntiAlias(true);
+    EXPECT_EQ(stats, draw({0, 2}, {10, 2}, aa), 20);
+    EXPECT_TRUE(stats, frame.at(5, 1) != 0 && frame.at(5, 1) != 0xFFFF);
+    EXPECT_TRUE(stats, frame.at(5, 2) != 0 && frame.at(5, 2) != 0xFFFF);
+    EXPECT_EQ(stats, draw({0, 2.5f}, {10, 2.5f}, aa), 10);
+    EXPECT_EQ(stats, frame.at(5, 2), 0xFFFF);
+
+    // but a mode that does not leave the dst under a transparent src (e.g. kSrc) cannot draw a
+    // partially covered pixel as a fainter src, so the line is drawn with the whole src
+    GPaint src(aa);
+    src.setBlendMode(GBlendMode::kSrc);
+    canvas->clear({1, 0, 0, 1});
+    canvas->drawLine({0, 2}, {10, 3}, src);
+    EXPECT_EQ(stats, count_not(frame.bitmap(), 0xF800), 10);   // white
+    EXPECT_EQ(stats, count_not(frame.bitmap(), 0xFFFF), 90);   // red
+
+    // thick lines are rects around the segment, with butt caps
+    GPaint thick(paint);
+    thick.setStrokeWidth(2);
+    EXPECT_EQ(stats, draw({1, 5}, {9, 5}, thick), 16);
+    EXPECT_EQ(stats, frame.at(1, 4), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(0, 5), 0);
+    const int diagonal = draw({1, 1}, {8, 7}, thick);
+    canvas->clear({0, 0, 0, 1});
+    const GPoint pts[] = { {1, 1}, {8, 7} };
+    canvas->GCanvas::drawLines(pts, 2, thick);
+    EXPECT_EQ(stats, frame.count(), diagonal);
+}
+
+#include "../include/GStroke.h"
+
+static void test_stroke(GTestStats* stats) {
+    TestFrame frame(10, 10);
+    GCanvas* canvas = frame.canvas();
+    auto fill = [&](const std::shared_ptr<GPath>& path) {
+        canvas->clear({0, 0, 0, 1});
+        canvas->drawPath(*path, GPaint({1, 1, 1, 1}));
+        return frame.count();
+    };
+    const auto J = GStrokeJoin::kMiter;
+    const auto C = GStrokeCap::kButt;
+
+    auto line = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(3, 5);
+        bu.lineTo(7, 5);
+    });
+    EXPECT_NULL(stats, GStrokePath(*line, 0, J, C).get());
+
+    // contours are closed, as when they are filled: a line is stroked to its end and back, so its
+    // ends are joins (a miter that reverses is beveled, so it ends at the points)
+    EXPECT_EQ(stats, fill(GStrokePath(*line, 4, J, C)), 16);
+    EXPECT_EQ(stats, fill(GStrokePath(*line, 4, J, GStrokeCap::kSquare)), 16);
+    const int round = fill(GStrokePath(*line, 4, GStrokeJoin::kRound, C));
+    EXPECT_TRUE(stats, round > 16 && round < 32);
+
+    // caps are drawn around a contour with no length: none, a square, or a circle
+    auto dot = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(5, 5);
+        bu.lineTo(5, 5);
+    });
+    EXPECT_EQ(stats, fill(GStrokePath(*dot, 4, J, C)), 0);
+    EXPECT_EQ(stats, fill(GStrokePath(*dot, 4, J, GStrokeCap::kSquare)), 16);
+    const int roundDot = fill(GStrokePath(*dot, 4, J, GStrokeCap::kRound));
+    EXPECT_TRUE(stats, roundDot > 4 && roundDot < 16);
+
+    // a closed contour has no caps, and leaves its inside empty
+    auto square = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(2, 2);
+        bu.lineTo(8, 2);
+        bu.lineTo(8, 8);
+        bu.lineTo(2, 8);
+        bu.lineTo(2, 2);
+    });
+    EXPECT_EQ(stats, fill(GStrokePath(*square, 2, J, C)), 64 - 16);
+    EXPECT_EQ(stats, frame.at(1, 1), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 5), 0);
+    EXPECT_EQ(stats, fill(GStrokePath(*square, 4, J, C)), 100 - 4);
+    EXPECT_EQ(stats, fill(GStrokePath(*square, 4, GStrokeJoin::kRound, C)), 100 - 4 - 4);
+    // a miter limit below sqrt(2) bevels right angles
+    EXPECT_EQ(stats, fill(GStrokePath(*square, 2, J, C, 1.3f)),
+                     fill(GStrokePath(*square, 2, GStrokeJoin::kBevel, C)));
+
+    // addRect and addPolygon do not repeat their first points, but are stroked all the way around
+    auto rect = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.addRect(GRect::LTRB(2, 2, 8, 8));
+    });
+    EXPECT_EQ(stats, fill(GStrokePath(*rect, 2, J, C)), 64 - 16);
+    EXPECT_EQ(stats, frame.at(1, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(8, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 1), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 8), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 5), 0);
+    const GPoint tri[] = {{2, 1}, {8, 5}, {2, 9}};
+    auto poly = GPathBuilder::Build([&](GPathBuilder& bu) {
+        bu.addPolygon(tri, 3);
+    });
+    auto closedPoly = GPathBuilder::Build([&](GPathBuilder& bu) {
+        bu.addPolygon(tri, 3);
+        bu.lineTo(tri[0]);
+    });
+    const int polyCount = fill(GStrokePath(*poly, 2, J, C));
+    EXPECT_EQ(stats, frame.at(1, 5), 0xFFFF);     // the side that closes it
+    EXPECT_EQ(stats, polyCount, fill(GStrokePath(*closedPoly, 2, J, C)));
+
+    // curves are offset by quads
+    auto quad = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(1, 8);
+        bu.quadTo({5, 0}, {9, 8});
+    });
+    fill(GStrokePath(*quad, 2, J, C));
+    EXPECT_EQ(stats, frame.at(4, 4), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 2), 0);
+    EXPECT_EQ(stats, frame.at(5, 6), 0);
+
+    // the paint's stroke style does the same, or hairlines if its width is 0
+    GPaint paint({1, 1, 1, 1});
+    paint.setStyle(GPaintStyle::kStroke);
+    paint.setStrokeWidth(2);
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawPath(*line, paint);
+    EXPECT_EQ(stats, frame.at(3, 4), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(3, 6), 0);
+    paint.setStrokeWidth(0);
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawPath(*square, paint);
+    EXPECT_EQ(stats, frame.at(2, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 5), 0);
+    EXPECT_EQ(stats, frame.at(1, 5), 0);
+    // hairlines close the contour too
+    canvas->clear({0, 0, 0, 1});
+    canvas->drawPath(*rect, paint);
+    EXPECT_EQ(stats, frame.at(2, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(8, 5), 0xFFFF);
+    EXPECT_EQ(stats, frame.at(5, 5), 0);
+}
+
+#include "../include/GMaskCache.h"
+
+static void test_mask_cache(GTestStats* stats) {
+    TestFrame cached(32, 32), direct(32, 32);
+    GCanvas* c0 = cached.canvas();
+    GCanvas* c1 = direct.canvas();
+    GMaskCache cache(1 << 20);
+    c0->setMaskCache(&cache);
+
+    auto make_star = []() {
+        return GPathBuilder::Build([](GPathBuilder& bu) {
+            bu.moveTo(10, 0);
+            bu.lineTo(16, 20);
+            bu.lineTo(0, 7);
+            bu.lineTo(20, 7);
+            bu.lineTo(4, 20);
+        });
+    };
+    auto star = make_star();
+    const GPaint paint({1, 0.5f, 0, 1});
+    auto draw = [&](float dx, float dy) {
+        return draws_equal(cached, direct, [&](GCanvas* canvas) {
+            canvas->save();
+            canvas->translate(dx, dy);
+            canvas->drawPath(*star, paint);
+            canvas->restore();
+        });
+    };
+
+    // moving by whole pixels (even partly outside the canvas) reuses the mask
+    EXPECT_TRUE(stats, draw(2, 3));
+    EXPECT_TRUE(stats, draw(7, 1));
+    EXPECT_TRUE(stats, draw(20, -5));
+    GMaskCache::Stats s = cache.stats();
+    EXPECT_EQ(stats, s.fMisses, 1);
+    EXPECT_EQ(stats, s.fHits, 2);
+    EXPECT_EQ(stats, s.fCount, 1);
+
+    // fractions of a pixel are rounded to quarters, each with its own mask
+    EXPECT_TRUE(stats, draw(2.25f, 3.5f));
+    EXPECT_TRUE(stats, draw(5.25f, 1.5f));
+    EXPECT_EQ(stats, cache.stats().fMisses, 2);
+
+    // scaling needs a new mask
+    for (GCanvas* canvas : { c0, c1 }) {
+        canvas->save();
+        canvas->scale(1.5f, 1.5f);
+    }
+    EXPECT_TRUE(stats, draw(1, 1));
+    EXPECT_EQ(stats, cache.stats().fMisses, 3);
+    c0->restore();
+    c1->restore();
+
+    // a path that is not owned by a shared_ptr is drawn directly
+    const GPath loose({{10, 0}, {16, 20}, {0, 7}}, {kMove, kLine, kLine});
+    c0->save();
+    c0->translate(1, 1);
+    c0->drawPath(loose, paint);
+    c0->restore();
+    EXPECT_EQ(stats, cache.stats().fMisses, 3);
+
+    // once a path is deleted, its entries are never hit again
+    star = make_star();
+    EXPECT_TRUE(stats, draw(1, 1));
+    EXPECT_EQ(stats, cache.stats().fMisses, 4);
+
+    // the least recently used masks are evicted to stay within the budget
+    GMaskCache small(600);
+    c0->setMaskCache(&small);
+    EXPECT_TRUE(stats, draw(0, 0));
+    EXPECT_TRUE(stats, draw(0.5f, 0));
+    s = small.stats();
+    EXPECT_EQ(stats, s.fCount, 1);
+    EXPECT_EQ(stats, s.fEvictions, 1);
+    EXPECT_TRUE(stats, s.fBytesUsed <= 600);
+    small.purge();
+    EXPECT_EQ(stats, small.stats().fCount, 0);
+}
+
+static void test_fill_engines(GTestStats* stats) {
+    TestFrame edges(40, 30), accum(40, 30);
+    edges.canvas()->setFillEngine(GFillEngine::kEdgeList);
+    accum.canvas()->setFillEngine(GFillEngine::kAccumulate);
+
+    // both engines draw exactly the same pixels, including where the path is clipped (and where
+    // its contours cross themselves and each other)
+    GRandom rand;
+    for (float scale : { 20.0f, 40.0f, 100.0f }) {
+        auto pt = [&]() {
+            return GPoint{ rand.nextF() * scale - 5, rand.nextF() * scale - 5 };
+        };
+        GPathBuilder bu;
+        for (int c = 0; c < 5; ++c) {
+            const GPoint start = pt();
+            bu.moveTo(start);
+            for (int i = 0; i < 10; ++i) {
+                if (i % 3 == 0) {
+                    bu.lineTo(pt());
+                } else if (i % 3 == 1) {
+                    bu.quadTo(pt(), pt());
+                } else {
+                    bu.cubicTo(pt(), pt(), pt());
+                }
+            }
+            bu.lineTo(start);
+        }
+        auto path = bu.detach();
+        EXPECT_TRUE(stats, draws_equal(edges, accum, [&](GCanvas* canvas) {
+            canvas->save();
+            canvas->translate(0.5f, 0.25f);
+            canvas->drawPath(*path, GPaint({1, 1, 1, 1}));
+            canvas->restore();
+        }));
+        EXPECT_TRUE(stats, edges.count() > 0);
+    }
+}
+
+static void test_convex(GTestStats* stats) {
+    EXPECT_TRUE(stats, make_polygon({{0, 0}, {10, 0}, {10, 10}, {0, 10}})->isConvex());
+    EXPECT_TRUE(stats, make_polygon({{0, 0}, {0, 10}, {10, 10}, {10, 0}})->isConvex());
+    EXPECT_TRUE(stats, make_polygon({{0, 0}, {5, 0}, {10, 0}, {5, 8}, {0, 0}})->isConvex());
+    EXPECT_TRUE(stats, !make_polygon({{0, 0}, {10, 0}, {5, 3}, {5, 10}})->isConvex());
+    EXPECT_TRUE(stats, !make_polygon({{0, 0}, {10, 0}, {5, 0}})->isConvex());
+    EXPECT_TRUE(stats, !make_polygon({{0, 0}, {10, 0}})->isConvex());
+    // a pentagram turns the same way at each point, but goes around twice
+    GPoint star[5];
+    for (int i = 0; i < 5; ++i) {
+        const float angle = i * 4 * gFloatPI / 5;
+        star[i] = { 10 + 10 * cosf(angle), 10 + 10 * sinf(angle) };
+    }
+    EXPECT_TRUE(stats, !make_polygon(std::vector<GPoint>(star, star + 5))->isConvex());
+    EXPECT_TRUE(stats, !GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(0, 0);
+        bu.quadTo(10, 0, 10, 10);
+    })->isConvex());
+    EXPECT_TRUE(stats, !GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(0, 0);
+        bu.lineTo(5, 0);
+        bu.lineTo(0, 5);
+        bu.moveTo(10, 10);
+        bu.lineTo(15, 10);
+        bu.lineTo(10, 15);
+    })->isConvex());
+
+    // the two-edge walker draws the same pixels as the general scan converter
+    TestFrame walked(30, 30), sorted(30, 30);
+    sorted.canvas()->setFillEngine(GFillEngine::kEdgeList);
+    GRandom rand;
+    for (int i = 0; i < 20; ++i) {
+        const int n = 3 + i % 7;
+        const float rx = 2 + rand.nextF() * 20, ry = 2 + rand.nextF() * 20;
+        const GPoint center = { rand.nextF() * 30, rand.nextF() * 30 };
+        const float start = rand.nextF() * 2 * gFloatPI;
+        std::vector<GPoint> pts(n);
+        for (int j = 0; j < n; ++j) {
+            const float angle = start + (i & 1 ? 1 : -1) * j * 2 * gFloatPI / n;
+            pts[j] = { center.x + rx * cosf(angle), center.y + ry * sinf(angle) };
+        }
+        const GPaint paint({1, 1, 1, 1});
+        EXPECT_TRUE(stats, draws_equal(walked, sorted, [&](GCanvas* canvas) {
+            canvas->drawConvexPolygon(pts.data(), n, paint);
+        }, [&](GCanvas* canvas) {
+            canvas->drawPath(*make_polygon(pts), paint);
+        }));
+    }
+
+    // x is not stepped down a tall edge (where rounding its step would drift): each row's span is
+    // where its center crosses the edges (but for rows where that is too close to call)
+    const int height = 4000;
+    const float slope = 806.5f / 65536;     // halfway between two steps of 1/65536
+    const GPoint tall[] = {{2.3f, 0}, {10.3f, 0}, {10.3f + slope * height, (float)height},
+                           {2.3f + slope * height, (float)height}};
+    GAlphaBitmap bm;
+    bm.alloc(64, height);
+    auto canvas = GCreateCanvas(bm);
+    canvas->clear({0, 0, 0, 0});
+    canvas->drawConvexPolygon(tall, 4, GPaint());
+    int wrong = 0;
+    for (int y = 0; y < height; ++y) {
+        const double t = (y + 0.5) / height;
+        const double left = tall[0].x + t * (tall[3].x - tall[0].x);
+        const double right = tall[1].x + t * (tall[2].x - tall[1].x);
+        auto close = [](double x) { return std::abs(x - floor(x) - 0.5) < 1e-3; };
+        if (close(left) || close(right)) {
+            continue;
+        }
+        const int L = (int)floor(left + 0.5), R = (int)floor(right + 0.5);
+        int n = 0;
+        for (int x = 0; x < bm.width(); ++x) {
+            n += *bm.getAddr(x, y) != 0;
+        }
+        wrong += n != R - L || *bm.getAddr(L, y) == 0;
+    }
+    EXPECT_EQ(stats, wrong, 0);
+    free(bm.pixels());
+}
+
+static void test_fill_type(GTestStats* stats) {
+    GAlphaBitmap bm;
+    bm.alloc(30, 30);
+    auto canvas = GCreateCanvas(bm);
+
+    auto nested = [](GPathFillType fillType) {
+        GPathBuilder bu;
+        const GPoint outer[] = {{0, 0}, {20, 0}, {20, 20}, {0, 20}};
+        const GPoint inner[] = {{5, 5}, {15, 5}, {15, 15}, {5, 15}};
+        bu.addPolygon(outer, 4);
+        bu.addPolygon(inner, 4);    // the same direction, so it winds twice
+        bu.setFillType(fillType);
+        return bu.detach();
+    };
+    auto drawn = [&](const GPath& path) {
+        canvas->clear({0, 0, 0, 0});
+        canvas->drawPath(path, GPaint());
+        return count_not(bm, 0);
+    };
+    for (GFillEngine engine : { GFillEngine::kAuto, GFillEngine::kEdgeList,
+                                GFillEngine::kAccumulate }) {
+        canvas->setFillEngine(engine);
+        EXPECT_EQ(stats, drawn(*nested(GPathFillType::kWinding)), 20 * 20);
+        EXPECT_EQ(stats, drawn(*nested(GPathFillType::kEvenOdd)), 20 * 20 - 10 * 10);
+        EXPECT_EQ(stats, drawn(*nested(GPathFillType::kInverseWinding)), 30 * 30 - 20 * 20);
+        EXPECT_EQ(stats, drawn(*nested(GPathFillType::kInverseEvenOdd)), 30 * 30 - 300);
+    }
+    canvas->setFillEngine(GFillEngine::kAuto);
+
+    // an inverse path covers the rest of the clip, even when the path is empty or convex
+    GPathBuilder bu;
+    bu.setFillType(GPathFillType::kInverseWinding);
+    EXPECT_EQ(stats, drawn(*bu.detach()), 30 * 30);
+    EXPECT_TRUE(stats, bu.fillType() == GPathFillType::kWinding);
+    const GPoint tri[] = {{0, 0}, {10.2f, 0}, {0, 10.2f}};
+    bu.addPolygon(tri, 3);
+    bu.setFillType(GPathFillType::kInverseWinding);
+    auto inverse = bu.detach();
+    EXPECT_TRUE(stats, inverse->isConvex());
+    EXPECT_EQ(stats, drawn(*inverse), 30 * 30 - 55);
+    canvas->save();
+    canvas->translate(1, 1);
+    EXPECT_TRUE(stats, inverse->transform(GMatrix::Translate(1, 1))->isInverseFillType());
+    EXPECT_EQ(stats, drawn(*inverse), 30 * 30 - 55);
+    canvas->restore();
+
+    // it has no bounded mask to cache
+    GMaskCache cache(1 << 20);
+    int x, y;
+    EXPECT_NULL(stats, cache.get(*inverse, GMatrix(), &x, &y).get());
+
+    free(bm.pixels());
+}
+
+static void test_path_shape(GTestStats* stats) {
+    auto same = [](const GRect& a, const GRect& b) {
+        return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+    };
+    GRect r;
+    auto rect = make_polygon({{2, 3}, {2, 9}, {7, 9}, {7, 3}, {2, 3}});
+    EXPECT_TRUE(stats, rect->isRect(&r));
+    EXPECT_TRUE(stats, same(r, GRect::LTRB(2, 3, 7, 9)));
+    EXPECT_TRUE(stats, same(rect->cachedBounds(), GRect::LTRB(2, 3, 7, 9)));
+    EXPECT_TRUE(stats, !rect->isOval());
+    EXPECT_TRUE(stats, !make_polygon({{2, 3}, {7, 3}, {7, 9}, {3, 9}})->isRect());
+    EXPECT_TRUE(stats, !make_polygon({{2, 3}, {7, 3}, {7, 9}})->isRect());
+    EXPECT_TRUE(stats, !make_polygon({{2, 3}, {7, 3}, {7, 3}, {2, 3}})->isRect());
+    EXPECT_TRUE(stats, !make_polygon({{0, 5}, {5, 0}, {10, 5}, {5, 10}})->isRect());
+
+    // an ellipse from 4 cubics (each control point is k times the radius from its end point),
+    // with its first control point moved by bump, and its last point by gap
+    auto oval = [](const GRect& r, float k, float bump = 0, float gap = 0, bool moveAfter = false) {
+        const float cx = (r.left + r.right) * 0.5f, cy = (r.top + r.bottom) * 0.5f;
+        const float kx = k * r.width() * 0.5f, ky = k * r.height() * 0.5f;
+        GPathBuilder bu;
+        bu.moveTo(r.right, cy);
+        bu.cubicTo(r.right + bump, cy + ky, cx + kx, r.bottom, cx, r.bottom);
+        bu.cubicTo(cx - kx, r.bottom, r.left, cy + ky, r.left, cy);
+        bu.cubicTo(r.left, cy - ky, cx - kx, r.top, cx, r.top);
+        bu.cubicTo(cx + kx, r.top, r.right, cy - ky, r.right, cy - gap);
+        if (moveAfter) {
+            bu.moveTo(cx, cy);  // (which is no longer a single contour)
+        }
+        return bu.detach();
+    };
+    const GRect bounds = GRect::LTRB(3, 4, 27, 20);
+    auto ellipse = oval(bounds, 0.5522848f);
+    EXPECT_TRUE(stats, ellipse->isOval(&r));
+    EXPECT_TRUE(stats, same(r, bounds));
+    EXPECT_TRUE(stats, !ellipse->isRect());
+    EXPECT_TRUE(stats, !ellipse->isConvex());
+    EXPECT_TRUE(stats, !oval(bounds, 1)->isOval());
+    EXPECT_TRUE(stats, !oval(bounds, 0)->isOval());
+    // an arc that stops just short of its start is filled with a line back to it
+    EXPECT_TRUE(stats, !oval(bounds, 0.5522848f, 0, 0.01f)->isOval());
+
+    // a large circle that strays from the ellipse by much less than its radius, but by most of a
+    // pixel when drawn, is filled as the path it is
+    const GRect big = GRect::LTRB(0, 0, 2000, 2000);
+    float error = 0;
+    EXPECT_TRUE(stats, oval(big, 0.5522848f, 8)->isOval(nullptr, &error));
+    EXPECT_TRUE(stats, error >= 8 && error < 10);
+    EXPECT_TRUE(stats, !oval(big, 0.5522848f, 8, 0, true)->isOval());
+    TestFrame curves(200, 200), twin(200, 200);
+    EXPECT_TRUE(stats, draws_equal(curves, twin, [&](GCanvas* canvas) {
+        canvas->scale(0.1f, 0.1f);
+        canvas->drawPath(*oval(big, 0.5522848f, 8), GPaint({1, 1, 1, 1}));
+    }, [&](GCanvas* canvas) {
+        canvas->scale(0.1f, 0.1f);
+        canvas->drawPath(*oval(big, 0.5522848f, 8, 0, true), GPaint({1, 1, 1, 1}));
+    }));
+
+    // the shapes are filled directly, with the same pixels as drawRect and drawRRect
+    TestFrame path(30, 30), shape(30, 30);
+    const GPaint paint({1, 1, 1, 1});
+    EXPECT_TRUE(stats, draws_equal(path, shape, [&](GCanvas* canvas) {
+        canvas->scale(0.9f, 1.1f);
+        canvas->translate(0.3f, 0.2f);
+        canvas->drawPath(*rect, paint);
+        canvas->drawPath(*ellipse, paint);
+    }, [&](GCanvas* canvas) {
+        canvas->scale(0.9f, 1.1f);
+        canvas->translate(0.3f, 0.2f);
+        canvas->drawRect(GRect::LTRB(2, 3, 7, 9), paint);
+        canvas->drawRRect(bounds, bounds.width() * 0.5f, bounds.height() * 0.5f, paint);
+    }));
+}
+
+static void test_curve_edges(GTestStats* stats) {
+    GAlphaBitmap bm;
+    bm.alloc(256, 256);
+    auto canvas = GCreateCanvas(bm);
+    auto area = [&](const GPath& path, float dx, float dy) {
+        canvas->clear({0, 0, 0, 0});
+        canvas->save();
+        canvas->translate(dx, dy);
+        canvas->drawPath(path, GPaint());
+        canvas->restore();
+        return count_not(bm, 0);
+    };
+    auto near = [](int n, float expected) { return std::abs(n - expected) <= expected * 0.01f; };
+
+    // a quad that goes down and back up (so it is chopped where it turns): the area under a
+    // parabola is 2/3 of its bounding rect
+    auto bowl = GPathBuilder::Build([](GPathBuilder& bu) {
+        bu.moveTo(0, 0);
+        bu.quadTo(100, 200, 200, 0);
+    });
+    for (GFillEngine engine : { GFillEngine::kEdgeList, GFillEngine::kAccumulate }) {
+        canvas->setFillEngine(engine);
+        EXPECT_TRUE(stats, near(area(*bowl, 20, 20), 200 * 100 * 2 / 3.0f));
+        // the top half is clipped out, so the edges start part way down their curves, and only
+        // the parabola's tip is left: 2/3 of its bounding rect too
+        EXPECT_TRUE(stats, near(area(*bowl, 20, -50), 2 * 100 * sqrtf(0.5f) * 50 * 2 / 3.0f));
+    }
+    canvas->setFillEngine(GFillEngine::kAuto);
+
+    // a circle from 4 cubics (rotated, so that it is not drawn as an oval), which turn at its
+    // top and bottom
+    const float k = 0.5522848f * 100;
+    auto circle = GPathBuilder::Build([k](GPathBuilder& bu) {
+        bu.moveTo(100, 0);
+        bu.cubicTo(100, k, k, 100, 0, 100);
+        bu.cubicTo(-k, 100, -100, k, -100, 0);
+        bu.cubicTo(-100, -k, -k, -100, 0, -100);
+        bu.cubicTo(k, -100, 100, -k, 100, 0);
+    });
+    canvas->save();
+    canvas->translate(128, 128);
+    canvas->rotate(0.3f);
+    canvas->clear({0, 0, 0, 0});
+    canvas->drawPath(*circle, GPaint());
+    canvas->restore();
+    EXPECT_TRUE(stats, near(count_not(bm, 0), gFloatPI * 100 * 100));
+    // it is symmetric around its center (to within a pixel at the ends of each row)
+    int asymmetric = 0;
+    for (int y = 28; y < 228; ++y) {
+        for (int x = 28; x < 228; ++x) {
+            asymmetric += *bm.getAddr(x, y) != *bm.getAddr(255 - x, 255 - y);
+        }
+    }
+    EXPECT_TRUE(stats, asymmetric <= 2 * 2 * 200);
+
+    free(bm.pixels());
+}
@@ -14,6 +14,8 @@
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_io.cpp"
+#include "tests_raster.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_clear,       "clear"         },
@@ -39,6 +41,39 @@ const GTestRec gTestRecs[] = {
     { test_path_chop_cubic,   "path_chop_cubic"    },
     { test_path_bounds, "path_bounds" },
 
+    { test_png_levels,      "png_levels"      },
+    { test_png_writer_rows, "png_writer_rows" },
+    { test_pixel_convert,   "pixel_convert"   },
+    { test_load_bitmaps,    "load_bitmaps"    },
+    { test_image_cache,     "image_cache"     },
+    { test_raw_bitmap,      "raw_bitmap"      },
+    { test_mapped_bitmap,   "mapped_bitmap"   },
+    { test_huge_pages,      "huge_pages"      },
+
+    { test_alpha_canvas,    "alpha_canvas"    },
+    { test_alpha_shaders,   "alpha_shaders"   },
+    { test_565_convert,     "565_convert"     },
+    { test_565_canvas,      "565_canvas"      },
+    { test_f16_convert,     "f16_convert"     },
+    { test_f16_canvas,      "f16_canvas"      },
+    { test_linear_canvas,   "linear_canvas"   },
+    { test_save_layer,      "save_layer"      },
+    { test_blur,            "blur"            },
+    { test_color_filter,    "color_filter"    },
+    { test_advanced_modes,  "advanced_modes"  },
+    { test_bitmap_rect,     "bitmap_rect"     },
+    { test_atlas,           "atlas"           },
+    { test_bitmap_nine,     "bitmap_nine"     },
+    { test_rrect,           "rrect"           },
+    { test_lines,           "lines"           },
+    { test_stroke,          "stroke"          },
+    { test_mask_cache,      "mask_cache"      },
+    { test_fill_engines,    "fill_engines"    },
+    { test_convex,          "convex"          },
+    { test_fill_type,       "fill_type"       },
+    { test_path_shape,      "path_shape"      },
+    { test_curve_edges,     "curve_edges"     },
+
     { nullptr, nullptr },
 };
 
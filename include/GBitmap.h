@@ -69,14 +69,36 @@ public:
     /*
      *  Attempt to write the bitmap as a PNG into a new file (the file will be created/overwritten).
      *  Return true on success.
+     *
+     *  The image is encoded a row at a time (see GPNGWriter, which also offers faster
+     *  compression levels), so this does not need a second copy of the pixels.
      */
     bool writeToFile(const char path[]) const;
 
+    /**
+     *  Write the bitmap to a new file in the uncompressed "raw" format (see GRawBitmapHeader):
+     *  a small header followed by the premultiplied pixel rows, exactly as they are in memory.
+     *  Files are much larger than PNGs, but can be loaded with GMappedBitmap::Open() without
+     *  any decoding. Return true on success.
+     */
+    bool writeToRawFile(const char path[]) const;
+
     /**
      *  Allocate the memory for the bitmap. If rowBytes is 0, it will be computed from w.
      */
     void alloc(int w, int h, size_t rowBytes = 0);
 
+    /**
+     *  Like alloc(), but intended for very large bitmaps (e.g. poster-sized renders). The pixel
+     *  memory is aligned to a huge-page boundary and, where the OS supports it, advised to be
+     *  backed by transparent huge pages to reduce TLB misses.
+     *
+     *  The memory is still released by calling free(bitmap->pixels()).
+     *
+     *  On failure, return false and bitmap is reset to empty.
+     */
+    bool allocHugePages(int w, int h, size_t rowBytes = 0);
+
 private:
     int     fWidth;
     int     fHeight;
@@ -0,0 +1,26 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GBitmapLoader_DEFINED
+#define GBitmapLoader_DEFINED
+
+#include "GBitmap.h"
+#include <string>
+
+struct GBitmapLoadResult {
+    GBitmap fBitmap;        // empty if the file could not be decoded
+    bool    fSuccess;
+    double  fDecodeMS;      // wall-clock time spent reading + decoding this file
+};
+
+/**
+ *  Decode each of the files (as if by GBitmap::readFromFile) concurrently, using up to maxThreads
+ *  threads (0 means one per core). The results are returned in the same order as paths.
+ *
+ *  As with readFromFile, the caller must call free() on each successful bitmap's pixels.
+ */
+std::vector<GBitmapLoadResult> GLoadBitmaps(const std::vector<std::string>& paths,
+                                            int maxThreads = 0);
+
+#endif
@@ -7,19 +7,38 @@
 
 #include "GTypes.h"
 
+/**
+ *  The Porter-Duff modes (kClear ... kXor) are listed with their formula for each premultiplied
+ *  channel, including alpha.
+ *
+ *  The advanced, separable modes (kMultiply ... kExclusion) blend each color channel on its own
+ *  (using the formula listed), and all produce the same alpha as kSrcOver: Sa + Da - Sa*Da.
+ */
 enum class GBlendMode {
-    kClear,    //!<     0
-    kSrc,      //!<     S
-    kDst,      //!<     D
-    kSrcOver,  //!<     S + (1 - Sa)*D
-    kDstOver,  //!<     D + (1 - Da)*S
-    kSrcIn,    //!<     Da * S
-    kDstIn,    //!<     Sa * D
-    kSrcOut,   //!<     (1 - Da)*S
-    kDstOut,   //!<     (1 - Sa)*D
-    kSrcATop,  //!<     Da*S + (1 - Sa)*D
-    kDstATop,  //!<     Sa*D + (1 - Da)*S
-    kXor,      //!<     (1 - Sa)*D + (1 - Da)*S
+    kClear,         //!<     0
+    kSrc,           //!<     S
+    kDst,           //!<     D
+    kSrcOver,       //!<     S + (1 - Sa)*D
+    kDstOver,       //!<     D + (1 - Da)*S
+    kSrcIn,         //!<     Da * S
+    kDstIn,         //!<     Sa * D
+    kSrcOut,        //!<     (1 - Da)*S
+    kDstOut,        //!<     (1 - Sa)*D
+    kSrcATop,       //!<     Da*S + (1 - Sa)*D
+    kDstATop,       //!<     Sa*D + (1 - Da)*S
+    kXor,           //!<     (1 - Sa)*D + (1 - Da)*S
+
+    kMultiply,      //!<     (1 - Da)*S + (1 - Sa)*D + S*D
+    kScreen,        //!<     S + D - S*D
+    kOverlay,       //!<     kHardLight, with S and D swapped
+    kDarken,        //!<     S + D - max(S*Da, D*Sa)
+    kLighten,       //!<     S + D - min(S*Da, D*Sa)
+    kColorDodge,    //!<     brightens D to reflect S
+    kColorBurn,     //!<     darkens D to reflect S
+    kHardLight,     //!<     kMultiply (2*S) if 2*S <= Sa, else kScreen (2*S - Sa)
+    kSoftLight,     //!<     darkens or lightens D, depending on S (a softer kHardLight)
+    kDifference,    //!<     S + D - 2*min(S*Da, D*Sa)
+    kExclusion,     //!<     S + D - 2*S*D
 };
 
 #endif
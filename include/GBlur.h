@@ -0,0 +1,33 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GBlur_DEFINED
+#define GBlur_DEFINED
+
+#include "GBitmap.h"
+
+/**
+ *  Blur filters for GBitmaps, e.g. for drop shadows. Pixels outside of the bitmap count as
+ *  transparent, so content fades out towards the edges.
+ *
+ *  Each blur is separable (a horizontal pass over rows, then a vertical pass over columns), uses
+ *  running sums so its cost does not depend on the radius, and spreads its rows and columns
+ *  across threads.
+ *
+ *  src and dst must be the same size, but may be the same bitmap (blurring it in place).
+ *  Return false if the sizes do not match.
+ */
+
+/**
+ *  Each pixel becomes the average of the (2*radius + 1) x (2*radius + 1) pixels around it.
+ */
+bool GBoxBlur(const GBitmap& src, const GBitmap& dst, int radius);
+
+/**
+ *  Approximates a Gaussian blur with standard deviation sigma, using three box blurs (whose
+ *  sizes are chosen to match sigma). The blur reaches about 3*sigma pixels in each direction.
+ */
+bool GGaussianBlur(const GBitmap& src, const GBitmap& dst, float sigma);
+
+#endif
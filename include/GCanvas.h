@@ -5,15 +5,26 @@
 #ifndef GCanvas_DEFINED
 #define GCanvas_DEFINED
 
+#include "GBitmap.h"
 #include "GMatrix.h"
 #include "GPaint.h"
+#include "GPixmap.h"
 #include <string>
 
-class GBitmap;
+class GMaskCache;
 class GPath;
 class GPoint;
 class GRect;
 
+/**
+ *  How canvases created by this library fill paths. Both engines draw the same pixels.
+ */
+enum class GFillEngine {
+    kAuto,          // choose by the number of edges and the size of the path (or if it is convex)
+    kEdgeList,      // walk the edges that cross each row, sorted by x
+    kAccumulate,    // add each edge's winding into a buffer, then sum along each row (no sorting)
+};
+
 class GCanvas {
 public:
     virtual ~GCanvas() {}
@@ -37,6 +48,22 @@ public:
      */
     virtual void restore() = 0;
 
+    /**
+     *  Like save(), but subsequent drawing goes into an offscreen layer, which the matching
+     *  restore() composites back using the paint's alpha and blendmode (its color and shader are
+     *  ignored). This applies "group opacity" to everything drawn in between.
+     *
+     *  If bounds is not null, nothing outside of it (in local coordinates) is drawn into the
+     *  layer, so the layer need only be that large.
+     *
+     *  If blurSigma > 0, the layer's contents are blurred (see GGaussianBlur) before they are
+     *  composited, e.g. for a drop shadow. The blur may spread up to 3*blurSigma pixels beyond
+     *  bounds.
+     *
+     *  The default implementation just calls save(), so the group is drawn directly.
+     */
+    virtual void saveLayer(const GRect* bounds, const GPaint&, float blurSigma = 0);
+
     /**
      *  Modifies the CTM by preconcatenating the specified matrix with the CTM. The canvas
      *  is constructed with an identity CTM.
@@ -66,9 +93,26 @@ public:
 
     /**
      *  Fill the path with the paint, interpreting the path using winding-fill (non-zero winding).
+     *  (Canvases created by this library use the path's fill type instead, see GPath::fillType,
+     *  and stroke the path if the paint's style is kStroke.)
      */
     virtual void drawPath(const GPath&, const GPaint&) = 0;
 
+    /**
+     *  If cache is not null, drawPath keeps the coverage masks of the paths it fills in the cache,
+     *  and blits a path's mask when it is drawn again with the same matrix (up to an integer
+     *  translation), instead of scan converting it again (see GMaskCache). The cache must
+     *  outlive its use by the canvas. Canvases created by this library use it; by default it is
+     *  ignored.
+     */
+    virtual void setMaskCache(GMaskCache* cache) {}
+
+    /**
+     *  Choose how drawPath fills paths, e.g. to compare the engines. Canvases created by this
+     *  library use it; by default it is ignored.
+     */
+    virtual void setFillEngine(GFillEngine) {}
+
     /**
      *  Draw a mesh of triangles, with optional colors and/or texture-coordinates at each vertex.
      *
@@ -131,6 +175,71 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Draw the paint's color (or its shader, if it has one) through the mask: each pixel's
+     *  alpha is scaled by the mask's value (coverage) at that pixel. The top-left of the mask is
+     *  positioned at (x, y), and the mask is transformed by the CTM.
+     *
+     *  The default implementation draws a rect with a shader that applies the mask (see
+     *  GCreateAlphaShader and GCreateMaskShader).
+     */
+    virtual void drawMask(const GAlphaBitmap& mask, float x, float y, const GPaint&);
+
+    /**
+     *  Draw count / 2 separate line segments: pts[0] to pts[1], pts[2] to pts[3], and so on.
+     *  Each is a rectangle around the segment, the paint's stroke width wide, ending exactly at
+     *  its points (butt caps). A stroke width of 0 draws hairlines, which touch one pixel per row
+     *  or column that they cross (and are antialiased if the paint is, and its blend mode can draw
+     *  a partially covered pixel as a fainter src: e.g. kSrcOver, but not kSrc, kClear or kDstIn).
+     *
+     *  The default implementation draws each segment as a convex polygon (hairlines are 1 unit
+     *  wide before the CTM, and not antialiased).
+     */
+    virtual void drawLines(const GPoint pts[], int count, const GPaint&);
+
+    /**
+     *  Fill the rect with its corners rounded by quarter-ellipses with radii rx and ry (which are
+     *  limited to half of the rect's width and height). Zero radii draw just the rect.
+     *
+     *  The default implementation draws a path, with each corner approximated by a cubic.
+     */
+    virtual void drawRRect(const GRect&, float rx, float ry, const GPaint&);
+
+    /**
+     *  Draw the src rect of the bitmap's pixels, scaled to fill dst (which is transformed by the
+     *  CTM). Only pixels inside src are sampled (nearest neighbor). The paint's alpha scales the
+     *  bitmap, and its blendmode applies; its color and shader are ignored.
+     *
+     *  The default implementation draws dst with a bitmap shader.
+     */
+    virtual void drawBitmapRect(const GBitmap&, const GIRect& src, const GRect& dst,
+                                const GPaint&);
+
+    /**
+     *  Draw count sprites from the atlas, e.g. icons packed into one image. Sprite i is the src[i]
+     *  rect of the atlas's pixels, drawn with its top-left at the origin of xforms[i] (which is
+     *  applied before the CTM). If colors is not null, sprite i's pixels are multiplied by
+     *  colors[i] (e.g. to tint or fade it). The paint applies to every sprite, as in
+     *  drawBitmapRect.
+     *
+     *  The default implementation draws each sprite with a bitmap shader.
+     */
+    virtual void drawAtlas(const GBitmap& atlas, const GIRect src[], const GMatrix xforms[],
+                           const GColor colors[], int count, const GPaint&);
+
+    /**
+     *  Draw the bitmap stretched to fill dst, as a "nine-patch" (e.g. a UI panel or button): the
+     *  center rect (in the bitmap's pixels) splits it into a 3x3 grid. The four corners are drawn
+     *  unscaled, the top and bottom edges are stretched horizontally, the left and right edges are
+     *  stretched vertically, and the center is stretched both ways. If dst is too small for the
+     *  corners, they are scaled down to fit (and the center is not drawn). The paint applies as in
+     *  drawBitmapRect.
+     *
+     *  The default implementation calls drawBitmapRect for each of the nine regions.
+     */
+    virtual void drawBitmapNine(const GBitmap&, const GIRect& center, const GRect& dst,
+                                const GPaint&);
+
     // Helpers
 
     void translate(float x, float y) {
@@ -145,7 +254,23 @@ public:
         this->concat(GMatrix::Rotate(radians));
     }
 
-    // Helpers
+    // Draw the single segment from a to b (see drawLines)
+    void drawLine(GPoint a, GPoint b, const GPaint& paint) {
+        const GPoint pts[] = { a, b };
+        this->drawLines(pts, 2, paint);
+    }
+
+    // Fill the ellipse inscribed in the rect
+    void drawOval(const GRect& rect, const GPaint& paint) {
+        this->drawRRect(rect, rect.width() * 0.5f, rect.height() * 0.5f, paint);
+    }
+
+    // Draw the whole bitmap, unscaled, with its top-left at (x, y)
+    void drawBitmap(const GBitmap& bitmap, float x, float y, const GPaint& paint) {
+        const GIRect src = GIRect::WH(bitmap.width(), bitmap.height());
+        this->drawBitmapRect(bitmap, src, GRect::XYWH(x, y, src.width(), src.height()), paint);
+    }
+
     // Note -- these used to be virtuals, but now they are 'demoted' to just methods
     //         that, in turn, call through to the new virtuals. This is done mostly
     //         for compatibility with our old calling code (e.g. pa1 tests).
@@ -153,6 +278,14 @@ public:
     void fillRect(const GRect& rect, const GColor& color) {
         this->drawRect(rect, GPaint(color));
     }
+
+protected:
+    /**
+     *  Compute the edges of drawBitmapNine's grid: the 4 edges of its columns (xs) and rows (ys),
+     *  in the bitmap and in dst. Returns false if there is nothing to draw.
+     */
+    static bool ComputeNineGrid(const GBitmap&, const GIRect& center, const GRect& dst,
+                                int srcX[4], int srcY[4], float dstX[4], float dstY[4]);
 };
 
 /**
@@ -161,6 +294,46 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Optional behaviors for a canvas that draws into a GBitmap.
+ */
+struct GCanvasOptions {
+    /**
+     *  GPixels hold sRGB-encoded values. By default they are blended as is; if this is true,
+     *  they are decoded to linear light, blended, and re-encoded. This makes translucent
+     *  overlaps and antialiased edges look like mixed light, rather than too dark.
+     */
+    bool fLinearBlending = false;
+};
+
+/**
+ *  As GCreateCanvas(bitmap), but with the specified options.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, const GCanvasOptions& options);
+
+/**
+ *  Returns a canvas that draws into an 8-bit alpha bitmap, e.g. to render a mask. Only the alpha
+ *  of each paint (or of its shader) is used, and blendmodes apply to the alpha channel alone.
+ *  If bitmap is invalid, this returns NULL.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GAlphaBitmap& bitmap);
+
+/**
+ *  Returns a canvas that draws directly into a 565 bitmap. Since 565 has no alpha, the dst is
+ *  always treated as opaque (Da == 1) when blending, and only the color channels of the result
+ *  are stored, as if it were composited onto black (e.g. kClear writes black).
+ *  If bitmap is invalid, this returns NULL.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const G565Bitmap& bitmap);
+
+/**
+ *  Returns a canvas that draws into a half float bitmap, blending in float. Use this for deep
+ *  stacks of translucent draws, where 8-bit pixels would band, and convert the result afterwards
+ *  (e.g. GConvertF16ToPixels, or GPNGWriter::Write).
+ *  If bitmap is invalid, this returns NULL.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GF16Bitmap& bitmap);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
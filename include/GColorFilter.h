@@ -0,0 +1,60 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GColorFilter_DEFINED
+#define GColorFilter_DEFINED
+
+#include "GColor.h"
+#include "GPixel.h"
+#include <memory>
+
+class GShader;
+
+/**
+ *  GColorFilters transform each color produced by a paint (its color, or its shader's output)
+ *  before it is blended, e.g. to tint or desaturate. They operate on unpremultiplied colors.
+ */
+class GColorFilter {
+public:
+    virtual ~GColorFilter() {}
+
+    // Return true iff the filter never changes alpha (so opaque colors stay opaque).
+    virtual bool preservesAlpha() const = 0;
+
+    // Filter count premultiplied pixels, in place.
+    virtual void filterRow(GPixel row[], int count) const = 0;
+
+    // Filter a single (unpremultiplied) color. This is used when a filter is applied to a
+    // paint's color, so that the result is computed once, rather than for each pixel.
+    virtual GColor filterColor(const GColor&) const = 0;
+};
+
+/**
+ *  Returns a filter that multiplies each color [r, g, b, a, 1] by the 4x5 matrix (given in row
+ *  major order, with values in 0...1), and pins the result to [0, 1]:
+ *
+ *      r' = m[ 0]*r + m[ 1]*g + m[ 2]*b + m[ 3]*a + m[ 4]
+ *      g' = m[ 5]*r + m[ 6]*g + m[ 7]*b + m[ 8]*a + m[ 9]
+ *      b' = m[10]*r + m[11]*g + m[12]*b + m[13]*a + m[14]
+ *      a' = m[15]*r + m[16]*g + m[17]*b + m[18]*a + m[19]
+ */
+std::shared_ptr<GColorFilter> GCreateColorMatrixFilter(const float matrix[20]);
+
+/**
+ *  Returns a filter that replaces each 8-bit channel with its entry in that channel's table.
+ *  A null table leaves that channel unchanged.
+ */
+std::shared_ptr<GColorFilter> GCreateTableColorFilter(const uint8_t tableR[256],
+                                                      const uint8_t tableG[256],
+                                                      const uint8_t tableB[256],
+                                                      const uint8_t tableA[256]);
+
+/**
+ *  Returns a shader that applies the filter to the output of another shader. This lets a filter
+ *  be used with any canvas (GPaint's color filter is applied by the canvases in this library).
+ */
+std::shared_ptr<GShader> GCreateColorFilterShader(std::shared_ptr<GShader>,
+                                                  std::shared_ptr<GColorFilter>);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GImageCache_DEFINED
+#define GImageCache_DEFINED
+
+#include "GBitmap.h"
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ *  Caches decoded images, so that asking for the same file repeatedly only decodes it once.
+ *
+ *  Entries are keyed by the file's path, and are only reused while the file's modification time
+ *  and size are unchanged (so editing an image on disk is picked up on the next request).
+ *
+ *  The returned bitmaps are shared and immutable: callers must not write to (or free) their
+ *  pixels. The pixels are released once the entry has been evicted *and* the last caller has
+ *  dropped its reference, so a bitmap stays valid for as long as it is held, e.g. by a shader
+ *  that was created from it.
+ *
+ *  The cache is safe to use from multiple threads.
+ */
+class GImageCache {
+public:
+    /**
+     *  budgetBytes limits the total size of the cached pixels; once it is exceeded, the least
+     *  recently used entries are evicted.
+     *
+     *  If diskCacheDir is not null, it names an (existing) directory where decoded pixels are
+     *  also persisted in the raw format (see GRawBitmapHeader). A later miss -- even in a
+     *  different process -- then reads those pixels back instead of decoding the PNG again.
+     */
+    GImageCache(size_t budgetBytes, const char diskCacheDir[] = nullptr);
+    ~GImageCache();
+
+    /**
+     *  Return the decoded image for the PNG at path, or null if it could not be read.
+     */
+    std::shared_ptr<const GBitmap> get(const char path[]);
+
+    /**
+     *  Drop all of the entries (bitmaps that are still referenced by callers remain valid).
+     */
+    void purge();
+
+    struct Stats {
+        int    fHits;        // found in memory
+        int    fMisses;      // not in memory (decoded, or read from the disk cache)
+        int    fDiskHits;    // ... of the misses, how many were read from the disk cache
+        int    fEvictions;
+        int    fCount;       // current number of entries
+        size_t fBytesUsed;   // current size of the cached pixels
+    };
+    Stats stats() const;
+
+    /**
+     *  A process-wide cache, for callers that just want to avoid re-decoding common images.
+     */
+    static GImageCache* Shared();
+
+private:
+    struct Entry {
+        std::string                     fPath;
+        long long                       fModTime;
+        long long                       fFileSize;
+        std::shared_ptr<const GBitmap>  fBitmap;
+        size_t                          fBytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    std::shared_ptr<const GBitmap> load(const char path[], long long modTime, long long size);
+    void remove(EntryList::iterator);
+    void purgeToBudget();
+
+    const size_t        fBudget;
+    const std::string   fDiskDir;   // empty if there is no disk cache
+
+    mutable std::mutex  fMutex;
+    EntryList           fLRU;       // most recently used at the front
+    std::unordered_map<std::string, EntryList::iterator> fMap;
+    Stats               fStats = {};
+};
+
+#endif
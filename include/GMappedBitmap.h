@@ -0,0 +1,80 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GMappedBitmap_DEFINED
+#define GMappedBitmap_DEFINED
+
+#include "GBitmap.h"
+
+/**
+ *  Layout of a "raw" bitmap file: this header, followed (at fPixelOffset) by fHeight rows of
+ *  premultiplied GPixels, each row fRowBytes long. All fields are stored in native byte order.
+ */
+struct GRawBitmapHeader {
+    char     fMagic[4];      // "GRAW"
+    uint32_t fVersion;
+    int32_t  fWidth;
+    int32_t  fHeight;
+    uint64_t fRowBytes;
+    uint32_t fIsOpaque;
+    uint32_t fPixelOffset;   // multiple of the page size, so the pixels are page-aligned
+
+    enum {
+        kVersion = 1,
+        kPixelOffset = 4096,
+    };
+};
+
+/**
+ *  Owns a memory-mapped file whose pixels are exposed as a GBitmap. This lets a canvas render
+ *  directly into the file, so surfaces larger than physical RAM can be paged by the OS rather
+ *  than allocated up front.
+ *
+ *  It is also the fast way to load an image that was saved with GBitmap::writeToRawFile(): the
+ *  pixels are already premultiplied GPixels, so there is nothing to decode, convert or copy.
+ */
+class GMappedBitmap {
+public:
+    ~GMappedBitmap();
+
+    /**
+     *  Create (or truncate) the file at path, size it to hold a w x h raw bitmap, and map it
+     *  read-write. The pixels start out as all zeros.
+     *
+     *  Returns null on failure.
+     */
+    static std::unique_ptr<GMappedBitmap> Create(const char path[], int w, int h);
+
+    /**
+     *  Map an existing raw bitmap file. The mapping is copy-on-write: pages are read from the
+     *  file on demand, and drawing into the bitmap is allowed, but never changes the file.
+     *
+     *  Returns null if the file cannot be mapped, or is not a valid raw bitmap.
+     */
+    static std::unique_ptr<GMappedBitmap> Open(const char path[]);
+
+    /**
+     *  The bitmap that views the mapped pixels. It is only valid while this object is alive,
+     *  and its pixels must NOT be passed to free().
+     */
+    const GBitmap& bitmap() const { return fBitmap; }
+
+    /**
+     *  Synchronously write any modified pixels back to the file (if created by Create()).
+     *  Returns true on success.
+     */
+    bool flush();
+
+private:
+    GMappedBitmap(int fd, void* addr, size_t size, const GBitmap&);
+    GMappedBitmap(const GMappedBitmap&) = delete;
+    GMappedBitmap& operator=(const GMappedBitmap&) = delete;
+
+    int     fFD;
+    void*   fAddr;
+    size_t  fSize;
+    GBitmap fBitmap;
+};
+
+#endif
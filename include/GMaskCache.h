@@ -0,0 +1,109 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GMaskCache_DEFINED
+#define GMaskCache_DEFINED
+
+#include "GMatrix.h"
+#include "GPath.h"
+#include "GPixmap.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ *  Caches the coverage masks of filled paths, so that drawing the same path again (e.g. every
+ *  frame, at a different position) blits its mask instead of scan converting it again.
+ *
+ *  Entries are keyed by the path's identity (its address, while it is alive) and by the matrix
+ *  it is drawn with, except for the integer part of the translation: moving a path by whole
+ *  pixels just moves its mask. The fractional part is rounded to a quarter of a pixel, so a
+ *  path that moves by fractions of a pixel needs at most 16 masks (and may be drawn up to 1/8
+ *  of a pixel from where it would be drawn without the cache).
+ *
+ *  Only paths that are owned by a shared_ptr (e.g. from GPathBuilder::detach) can be cached,
+ *  since the cache needs to notice when they are deleted: an entry whose path has been deleted
+ *  is never hit (even by a new path at the same address), and is evicted in turn.
+ *
+ *  The cache is safe to use from multiple threads (e.g. several canvases can share one).
+ */
+class GMaskCache {
+public:
+    /**
+     *  budgetBytes limits the total size of the cached masks; once it is exceeded, the least
+     *  recently used entries are evicted. A mask larger than the whole budget is not cached.
+     */
+    explicit GMaskCache(size_t budgetBytes);
+    ~GMaskCache();
+
+    /**
+     *  The coverage of a path (0 or 255, as the scan converter is not antialiased), and where
+     *  its top-left goes in device space, before the integer translation is added.
+     */
+    struct Mask {
+        GAlphaBitmap fBitmap;
+        int          fLeft, fTop;
+
+        Mask() {}
+        Mask(const Mask&) = delete;
+        ~Mask() { free(fBitmap.pixels()); }
+    };
+
+    /**
+     *  Return the mask of the path, filled (with its fill type) after being transformed by ctm,
+     *  rendering it if it is not already cached. Its top-left goes at (*x, *y) in device space.
+     *
+     *  Returns null if the path cannot be cached (it is not owned by a shared_ptr, it has an
+     *  inverse fill type, or its mask is empty or too large), in which case the caller should
+     *  fill it directly.
+     */
+    std::shared_ptr<const Mask> get(const GPath&, const GMatrix& ctm, int* x, int* y);
+
+    /**
+     *  Drop all of the entries (masks that are still referenced by callers remain valid).
+     */
+    void purge();
+
+    struct Stats {
+        int    fHits;
+        int    fMisses;      // rendered (paths that cannot be cached are not counted)
+        int    fEvictions;
+        int    fCount;       // current number of entries
+        size_t fBytesUsed;   // current size of the cached masks
+    };
+    Stats stats() const;
+
+private:
+    struct Key {
+        const GPath* fPath;
+        float        fMat[4];       // the matrix without its translation
+        int          fSubX, fSubY;  // the fractional translation, in quarter pixels
+
+        bool operator==(const Key&) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key&) const;
+    };
+    struct Entry {
+        Key                         fKey;
+        std::weak_ptr<const GPath>  fOwner;
+        std::shared_ptr<const Mask> fMask;
+        size_t                      fBytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    std::shared_ptr<const Mask> render(const GPath&, const Key&) const;
+    void remove(EntryList::iterator);
+    void purgeToBudget();
+
+    const size_t        fBudget;
+
+    mutable std::mutex  fMutex;
+    EntryList           fLRU;       // most recently used at the front
+    std::unordered_map<Key, EntryList::iterator, KeyHash> fMap;
+    Stats               fStats = {};
+};
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GPNGWriter_DEFINED
+#define GPNGWriter_DEFINED
+
+#include "GBitmap.h"
+#include "GPixmap.h"
+
+class GDeflater;
+
+/**
+ *  Encodes a PNG one row at a time, so the extra memory needed is proportional to the width of
+ *  the image rather than its area. Useful for surfaces too large to copy (e.g. GMappedBitmap).
+ *  Each row is unpremultiplied, filtered and fed to the compressor before the next one arrives.
+ *
+ *      auto writer = GPNGWriter::Create(path, w, h);
+ *      for (int y = 0; y < h; ++y) {
+ *          writer->writeRow(bitmap.getAddr(0, y));
+ *      }
+ *      writer->finish();
+ */
+class GPNGWriter {
+public:
+    ~GPNGWriter();
+
+    /**
+     *  Compression levels follow zlib's convention (0...9). Lower levels encode faster but
+     *  produce larger files, which is often the right trade-off for intermediate images.
+     */
+    enum {
+        kStore_Level   = 0,     // no compression
+        kFast_Level    = 1,
+        kDefault_Level = 6,
+        kBest_Level    = 9,
+    };
+
+    /**
+     *  Create (or overwrite) the file at path, and write the PNG header for a w x h image.
+     *  If opaque is true, the caller promises that every pixel will have 0xFF for alpha, and the
+     *  image is stored as RGB (no alpha channel). Returns null on failure.
+     */
+    static std::unique_ptr<GPNGWriter> Create(const char path[], int w, int h,
+                                              int level = kDefault_Level, bool opaque = false);
+
+    /**
+     *  Convenience: stream all of the rows in the bitmap to a PNG file. Return true on success.
+     */
+    static bool Write(const GBitmap&, const char path[], int level = kDefault_Level);
+
+    /**
+     *  Same, but for a half float bitmap: each row is converted to GPixels (see
+     *  GConvertF16ToPixels) as it is written.
+     */
+    static bool Write(const GF16Bitmap&, const char path[], int level = kDefault_Level);
+
+    /**
+     *  Append the next row of (premultiplied) pixels. The row must contain width() pixels.
+     *  Return false if there was an error, or if all of the rows have already been written.
+     */
+    bool writeRow(const GPixel row[]);
+
+    /**
+     *  Finish the encoded data and close the file. Must be called after all height() rows have
+     *  been written. Return true on success.
+     */
+    bool finish();
+
+    int width() const { return fWidth; }
+    int height() const { return fHeight; }
+
+private:
+    GPNGWriter(FILE*, int w, int h, int level, bool opaque);
+
+    bool writeChunk(const char type[4], const uint8_t data[], size_t length);
+    void filterRow();
+
+    FILE*                      fFile;
+    const int                  fWidth;
+    const int                  fHeight;
+    const int                  fLevel;
+    const int                  fBytesPerPixel;     // 3 (RGB) or 4 (RGBA)
+    int                        fRowsWritten = 0;
+    bool                       fOK = true;
+    std::unique_ptr<GDeflater> fDeflater;
+    std::vector<uint8_t>       fCurr;      // unpremultiplied RGB[A] for the current row
+    std::vector<uint8_t>       fPrev;      // ... and for the previous row (needed by filters)
+    std::vector<uint8_t>       fRow;       // filter-type + filtered bytes, as sent to deflate
+    std::vector<uint8_t>       fScratch;   // candidate filtered row
+};
+
+#endif
@@ -7,7 +7,9 @@
 
 #include "GColor.h"
 #include "GBlendMode.h"
+#include "GStroke.h"
 
+class GColorFilter;
 class GShader;
 
 class GPaint {
@@ -35,10 +37,55 @@ public:
     std::shared_ptr<GShader> shareShader() const { return fShader; }
     GPaint&  setShader(std::shared_ptr<GShader> s) { fShader = s; return *this; }
 
+    /**
+     *  If set, the filter is applied to the paint's color (or its shader's output) before
+     *  blending. Canvases created by this library apply it; for any other canvas, use
+     *  GCreateColorFilterShader (or GColorFilter::filterColor) instead.
+     */
+    GColorFilter* peekColorFilter() const { return fColorFilter.get(); }
+    std::shared_ptr<GColorFilter> shareColorFilter() const { return fColorFilter; }
+    GPaint& setColorFilter(std::shared_ptr<GColorFilter> f) { fColorFilter = f; return *this; }
+
+    /**
+     *  The width of lines (see GCanvas::drawLines). 0, the default, means hairlines, which are
+     *  one pixel wide however they are transformed.
+     */
+    float   getStrokeWidth() const { return fStrokeWidth; }
+    GPaint& setStrokeWidth(float width) { fStrokeWidth = width; return *this; }
+
+    /**
+     *  With kStroke, drawPath strokes the path (see GStrokePath) with the stroke width, join, cap
+     *  and miter limit, rather than filling it; a stroke width of 0 strokes it with hairlines.
+     *  Canvases created by this library apply it; for any other canvas, fill the path returned by
+     *  GStrokePath instead.
+     */
+    GPaintStyle getStyle() const { return fStyle; }
+    GPaint&     setStyle(GPaintStyle style) { fStyle = style; return *this; }
+
+    GStrokeJoin getStrokeJoin() const { return fJoin; }
+    GPaint&     setStrokeJoin(GStrokeJoin join) { fJoin = join; return *this; }
+
+    GStrokeCap  getStrokeCap() const { return fCap; }
+    GPaint&     setStrokeCap(GStrokeCap cap) { fCap = cap; return *this; }
+
+    float       getMiterLimit() const { return fMiterLimit; }
+    GPaint&     setMiterLimit(float limit) { fMiterLimit = limit; return *this; }
+
+    // If true, drawLines' hairlines are antialiased (other geometry is not affected).
+    bool    isAntiAlias() const { return fAntiAlias; }
+    GPaint& setAntiAlias(bool aa) { fAntiAlias = aa; return *this; }
+
 private:
-    GColor                      fColor = {0, 0, 0, 1};
-    std::shared_ptr<GShader>    fShader;
-    GBlendMode                  fMode = GBlendMode::kSrcOver;
+    GColor                          fColor = {0, 0, 0, 1};
+    std::shared_ptr<GShader>        fShader;
+    std::shared_ptr<GColorFilter>   fColorFilter;
+    GBlendMode                      fMode = GBlendMode::kSrcOver;
+    float                           fStrokeWidth = 0;
+    float                           fMiterLimit = 4;
+    GPaintStyle                     fStyle = GPaintStyle::kFill;
+    GStrokeJoin                     fJoin = GStrokeJoin::kMiter;
+    GStrokeCap                      fCap = GStrokeCap::kButt;
+    bool                            fAntiAlias = false;
 };
 
 #endif
@@ -5,6 +5,8 @@
 #include "GPoint.h"
 #include "GRect.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 enum GPathVerb {
@@ -19,6 +21,14 @@ enum class GPathDirection {
     kCCW, // counter-clockwise
 };
 
+// Which points are inside a path, and so are filled
+enum class GPathFillType {
+    kWinding,           // the contours wind around the point a non-zero number of times
+    kEvenOdd,           // a ray from the point crosses the contours an odd number of times
+    kInverseWinding,    // the points that kWinding leaves out
+    kInverseEvenOdd,    // the points that kEvenOdd leaves out
+};
+
 class GPath : public std::enable_shared_from_this<GPath> {
 public:
     /**
@@ -31,7 +41,62 @@ public:
     size_t countPoints() const { return fPts.size(); }
 
     /**
-     *  Create a new path by transforming the points in this path.
+     *  How the path is filled. Canvases created by this library honor it; others fill every path
+     *  with kWinding.
+     */
+    GPathFillType fillType() const { return fFillType; }
+    bool isInverseFillType() const {
+        return fFillType == GPathFillType::kInverseWinding ||
+               fFillType == GPathFillType::kInverseEvenOdd;
+    }
+
+    // The rest of these describe the path's geometry. Each is computed the first time that it is
+    // asked for, and then kept (paths are immutable), so drawing the same path repeatedly only
+    // analyzes it once. They are safe to call from multiple threads.
+
+    // As bounds(), but only computed once
+    const GRect& cachedBounds() const { return this->shape().fBounds; }
+
+    /**
+     *  Returns true if the path is a single contour of lines that is convex (every turn is in the
+     *  same direction, and it goes around just once), e.g. a polygon from addRect or addPolygon.
+     *  Such a path can be filled faster (see GCanvas::drawConvexPolygon). A transformed path
+     *  (see transform) inherits this from the original.
+     */
+    bool isConvex() const;
+
+    /**
+     *  Returns true if the path is a single contour that is an axis-aligned rectangle (with an
+     *  area), e.g. from addRect. If rect is not null, it is set to the rectangle.
+     */
+    bool isRect(GRect* rect = nullptr) const {
+        if (rect && this->shape().fIsRect) {
+            *rect = this->shape().fBounds;
+        }
+        return this->shape().fIsRect;
+    }
+
+    /**
+     *  Returns true if the path is a single closed contour of 4 cubics or 8 quads whose control
+     *  points are those of the ellipse inscribed in an axis-aligned rect (to within 1% of its
+     *  smaller radius), e.g. from addCircle. If oval is not null, it is set to that rect. If error
+     *  is not null, it is set to how far (in the path's units) the path may stray from the ellipse:
+     *  callers that draw the ellipse instead must check that this is small once transformed.
+     */
+    bool isOval(GRect* oval = nullptr, float* error = nullptr) const {
+        if (this->shape().fIsOval) {
+            if (oval) {
+                *oval = this->shape().fBounds;
+            }
+            if (error) {
+                *error = this->shape().fOvalError;
+            }
+        }
+        return this->shape().fIsOval;
+    }
+
+    /**
+     *  Create a new path by transforming the points in this path. It has the same fill type.
      */
     std::shared_ptr<GPath> transform(const GMatrix&) const;
 
@@ -112,9 +177,11 @@ public:
      */
     static void ChopCubicAt(const GPoint src[4], GPoint dst[7], float t);
 
-    GPath(std::vector<GPoint> pts, std::vector<GPathVerb> vbs)
+    GPath(std::vector<GPoint> pts, std::vector<GPathVerb> vbs,
+          GPathFillType fillType = GPathFillType::kWinding)
         : fPts(std::move(pts))
         , fVbs(std::move(vbs))
+        , fFillType(fillType)
     {}
 
 private:
@@ -123,8 +190,25 @@ private:
 
     friend class GPathBuilder;
 
+    struct Shape {
+        GRect fBounds;
+        bool  fIsRect;
+        bool  fIsOval;
+        float fOvalError;
+    };
+    const Shape& shape() const;
+
+    enum Convexity : int8_t { kUnknown_Convexity, kConvex_Convexity, kConcave_Convexity };
+
     const std::vector<GPoint>    fPts;
     const std::vector<GPathVerb> fVbs;
+    const GPathFillType          fFillType;
+
+    mutable std::once_flag          fShapeOnce;
+    mutable Shape                   fShape;
+    mutable std::atomic<Convexity>  fConvexity { kUnknown_Convexity };
+
+    static bool ComputeIsConvex(const std::vector<GPoint>&, const std::vector<GPathVerb>&);
 };
 
 #endif
@@ -71,6 +71,12 @@ public:
 
     void transform(const GMatrix&);
 
+    /**
+     *  The fill type of the path that detach() returns. reset() restores it to kWinding.
+     */
+    GPathFillType fillType() const { return fFillType; }
+    void setFillType(GPathFillType fillType) { fFillType = fillType; }
+
     /**
      * Return a GPath from the contents of this builder,
      * and then reset() the builder back to its empty state.
@@ -86,6 +92,7 @@ public:
 private:
     std::vector<GPoint>    fPts;
     std::vector<GPathVerb> fVbs;
+    GPathFillType          fFillType = GPathFillType::kWinding;
 };
 
 #endif
@@ -0,0 +1,66 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GPixelConvert_DEFINED
+#define GPixelConvert_DEFINED
+
+#include "GPixel.h"
+#include "GPixmap.h"
+
+/**
+ *  Row converters between GPixel (premultiplied) and RGBA8888 (unpremultiplied, stored in memory
+ *  as the bytes R, G, B, A -- the layout used by PNG).
+ *
+ *  These use SIMD where available, but always produce exactly the same results as the scalar
+ *  reference formulas:
+ *      premul:     c' = (c * a + 127) / 255
+ *      unpremul:   c' = (c * 255 + a/2) / a     (c' = c when a is 0 or 255)
+ */
+
+/**
+ *  Convert count unpremultiplied RGBA pixels in src[] into premultiplied GPixels in dst[].
+ */
+void GConvertRGBAToPixels(const uint8_t src[], int count, GPixel dst[]);
+
+/**
+ *  Convert count premultiplied GPixels in src[] into unpremultiplied RGBA pixels in dst[].
+ *  dst[] must hold count * 4 bytes.
+ */
+void GConvertPixelsToRGBA(const GPixel src[], int count, uint8_t dst[]);
+
+/**
+ *  Convert count GPixels to 565. Alpha is dropped: the (premultiplied) color channels are kept,
+ *  which is the same as compositing the pixels onto black. Each channel is rounded as in
+ *  GPixel565_PackRGB.
+ */
+void GConvertPixelsTo565(const GPixel src[], int count, GPixel565 dst[]);
+
+/**
+ *  Convert count 565 pixels to (opaque) GPixels, expanding each channel as in GPixel565_GetR.
+ */
+void GConvert565ToPixels(const GPixel565 src[], int count, GPixel dst[]);
+
+/**
+ *  Convert between half and single precision floats. Float to half rounds to the nearest half
+ *  (ties to even); out of range values become infinity. The row versions use the F16C
+ *  instructions when the CPU supports them, and produce the same results either way.
+ */
+float GHalfToFloat(GHalf);
+GHalf GFloatToHalf(float);
+void GConvertHalfToFloat(const GHalf src[], int count, float dst[]);
+void GConvertFloatToHalf(const float src[], int count, GHalf dst[]);
+
+/**
+ *  Convert count F16 pixels to GPixels. Each channel is pinned to [0, 1] (and each color to its
+ *  alpha, so the result is a valid premultiplied GPixel), then scaled by 255 and rounded.
+ */
+void GConvertF16ToPixels(const GPixelF16 src[], int count, GPixel dst[]);
+
+/**
+ *  Convert count GPixels to F16 pixels (exactly: every 8-bit value / 255 has a nearest half
+ *  that rounds back to it).
+ */
+void GConvertPixelsToF16(const GPixel src[], int count, GPixelF16 dst[]);
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GPixmap_DEFINED
+#define GPixmap_DEFINED
+
+#include "GPixel.h"
+
+/**
+ *  A view of pixels in a format other than GPixel, e.g. 8-bit alpha masks. Like GBitmap, this
+ *  does not own its pixels: alloc() uses calloc(), and the caller must call free(pixels()) when
+ *  they are finished.
+ */
+template <typename T> class GPixmap {
+public:
+    GPixmap() { this->reset(); }
+
+    GPixmap(int w, int h, size_t rb, T* pixels)
+        : fWidth(w), fHeight(h), fPixels(pixels), fRowBytes(rb)
+    {
+        this->validate();
+    }
+
+    int width() const { return fWidth; }
+    int height() const { return fHeight; }
+    size_t rowBytes() const { return fRowBytes; }
+    T* pixels() const { return fPixels; }
+
+    void reset() {
+        fWidth = 0;
+        fHeight = 0;
+        fPixels = nullptr;
+        fRowBytes = 0;
+    }
+
+    void reset(int w, int h, size_t rb, T* pixels) {
+        fWidth = w;
+        fHeight = h;
+        fRowBytes = rb;
+        fPixels = pixels;
+        this->validate();
+    }
+
+    T* getAddr(int x, int y) const {
+        assert(x >= 0 && x < this->width());
+        assert(y >= 0 && y < this->height());
+        return (T*)((char*)fPixels + y * fRowBytes) + x;
+    }
+
+    /**
+     *  Allocate (zero-filled) memory for the pixels. If rowBytes is 0, it will be computed from w.
+     */
+    void alloc(int w, int h, size_t rowBytes = 0) {
+        assert(w >= 0);
+        assert(h >= 0);
+        if (rowBytes == 0) {
+            rowBytes = w * sizeof(T);
+        }
+        this->reset(w, h, rowBytes, (w > 0 && h > 0) ? (T*)calloc(h, rowBytes) : nullptr);
+    }
+
+private:
+    int     fWidth;
+    int     fHeight;
+    T*      fPixels;
+    size_t  fRowBytes;
+
+    void validate() const {
+        assert(fWidth >= 0);
+        assert(fHeight >= 0);
+        assert((size_t)fWidth * sizeof(T) <= fRowBytes || fHeight == 0);
+    }
+};
+
+/**
+ *  8-bit coverage / alpha values (0 is transparent, 255 is opaque). A quarter of the size of
+ *  the equivalent GBitmap, which makes it the natural format for masks.
+ */
+typedef uint8_t GAlpha;
+using GAlphaBitmap = GPixmap<GAlpha>;
+
+/**
+ *  16-bit opaque color: 5 bits of red (the high bits), 6 of green, 5 of blue. Half the size of
+ *  a GPixel, for bandwidth- or memory-limited framebuffers. There is no alpha: every pixel is
+ *  opaque.
+ */
+typedef uint16_t GPixel565;
+using G565Bitmap = GPixmap<GPixel565>;
+
+/**
+ *  Packs 8-bit r, g, b (each rounded to the nearest 5 or 6 bit value).
+ */
+static inline GPixel565 GPixel565_PackRGB(unsigned r, unsigned g, unsigned b) {
+    assert(r <= 255 && g <= 255 && b <= 255);
+    auto div255 = [](unsigned x) { return (x + 128) * 257 >> 16; };
+    return (div255(r * 31) << 11) | (div255(g * 63) << 5) | div255(b * 31);
+}
+
+// These return the components expanded to 8 bits (so 0 and full-intensity map to 0 and 255)
+static inline int GPixel565_GetR(GPixel565 p) {
+    unsigned r = p >> 11;
+    return (r << 3) | (r >> 2);
+}
+static inline int GPixel565_GetG(GPixel565 p) {
+    unsigned g = (p >> 5) & 63;
+    return (g << 2) | (g >> 4);
+}
+static inline int GPixel565_GetB(GPixel565 p) {
+    unsigned b = p & 31;
+    return (b << 3) | (b >> 2);
+}
+
+/**
+ *  A 16-bit (IEEE half precision) float. See GPixelConvert.h for conversions to and from float.
+ */
+typedef uint16_t GHalf;
+
+/**
+ *  Premultiplied color with a half float per channel, stored as r, g, b, a. Twice the size of a
+ *  GPixel, but with 11 significant bits per channel (more near 0), so deep stacks of translucent
+ *  blends do not band the way 8-bit pixels do. Values are normally within [0, 1].
+ */
+struct GPixelF16 {
+    GHalf r, g, b, a;
+};
+using GF16Bitmap = GPixmap<GPixelF16>;
+
+#endif
@@ -8,6 +8,7 @@
 #include <memory>
 #include "GColor.h"
 #include "GPixel.h"
+#include "GPixmap.h"
 #include "GPoint.h"
 
 class GBitmap;
@@ -68,4 +69,20 @@ static inline std::shared_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p
     return GCreateLinearGradient(p0, p1, colors, 2, mode);
 }
 
+/**
+ *  Return a shader that draws the alpha bitmap, tinted by color: each pixel is color with its
+ *  alpha scaled by the bitmap's value. Returns null if the shader can not be created.
+ */
+std::shared_ptr<GShader> GCreateAlphaShader(const GAlphaBitmap&, const GColor& color,
+                                            const GMatrix& localMatrix,
+                                            GTileMode = GTileMode::kClamp);
+
+/**
+ *  Return a shader that draws src through the mask: src's pixels are scaled by the mask's value
+ *  at each pixel. Outside of the mask's bounds, nothing is drawn (the coverage is zero).
+ *  Returns null if the shader can not be created.
+ */
+std::shared_ptr<GShader> GCreateMaskShader(std::shared_ptr<GShader> src, const GAlphaBitmap& mask,
+                                           const GMatrix& localMatrix);
+
 #endif
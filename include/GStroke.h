@@ -0,0 +1,47 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GStroke_DEFINED
+#define GStroke_DEFINED
+
+#include "GPath.h"
+#include <memory>
+
+// Whether a path is filled, or stroked (see GPaint's stroke settings)
+enum class GPaintStyle {
+    kFill,
+    kStroke,
+};
+
+// How the outside of the corner between two segments is drawn
+enum class GStrokeJoin {
+    kMiter,     // extend the edges to meet at a point (unless it is too long: see miter limit)
+    kRound,     // a circular arc
+    kBevel,     // a line across the corner
+};
+
+// How a contour with no length (just a point) is drawn
+enum class GStrokeCap {
+    kButt,      // not at all
+    kRound,     // a circle around the point, whose diameter is the width
+    kSquare,    // a square around the point, whose sides are the width
+};
+
+/**
+ *  Returns a path that, when filled (with the non-zero winding rule), covers the stroke of src:
+ *  each of its segments widened to width, with the joins between them. Each contour becomes two
+ *  contours (its two sides), whose curved edges are quads that approximate the offsets of src's
+ *  curves.
+ *
+ *  As when a path is filled, every contour is closed: if it does not end at its first point, a
+ *  line back to it is stroked too, and the contour is joined there. (So a single line is
+ *  stroked to and back, and its ends look like its joins.) Caps are only drawn for contours that
+ *  have no length. Miters longer than miterLimit times the width are beveled instead.
+ *
+ *  Returns null if width is not positive.
+ */
+std::shared_ptr<GPath> GStrokePath(const GPath& src, float width, GStrokeJoin, GStrokeCap,
+                                   float miterLimit = 4);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GBlend.h"
+#include "GRasterCanvas.h"
+#include "../include/GPixelConvert.h"
+#include "../include/GShader.h"
+
+using RowProc   = void (*)(GPixel dst[], const GPixel src[], int count);
+using ColorProc = void (*)(GPixel dst[], GPixel src, int count);
+
+static void fill_565(GPixel565 dst[], GPixel565 value, int count) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = value;
+    }
+}
+
+/**
+ *  Every dst pixel is opaque (Da == 1), so each span is expanded to GPixels, blended with the
+ *  usual 8888 procs, and packed back -- keeping the color channels and dropping the result's
+ *  alpha (i.e. compositing the result onto black).
+ */
+class Blitter565 : public GBlitter {
+public:
+    Blitter565(const G565Bitmap& dst, const GPaint& paint)
+        : fDst(dst), fShader(paint.peekShader()), fColor(GColorToPixel(paint.getColor()))
+    {
+        GBlendMode mode = paint.getBlendMode();
+        const bool srcIsOpaque = fShader ? fShader->isOpaque() : GPixel_GetA(fColor) == 0xFF;
+
+        // Simplify using Da == 1 (and Sa == 1 when we know it)
+        switch (mode) {
+            case GBlendMode::kDstOver:  mode = GBlendMode::kDst;     break;
+            case GBlendMode::kSrcIn:    mode = GBlendMode::kSrc;     break;
+            case GBlendMode::kSrcOut:   mode = GBlendMode::kClear;   break;
+            case GBlendMode::kSrcATop:  mode = GBlendMode::kSrcOver; break;
+            case GBlendMode::kDstATop:  mode = GBlendMode::kDstIn;   break;
+            case GBlendMode::kXor:      mode = GBlendMode::kDstOut;  break;
+            default: break;
+        }
+        if (srcIsOpaque && mode == GBlendMode::kSrcOver) {
+            mode = GBlendMode::kSrc;
+        }
+        fMode = mode;
+
+        GVisitBlendMode(mode, [this](auto m) {
+            constexpr GBlendMode Mode = decltype(m)::value;
+            fRowProc = GBlendRow<Mode>;
+            fColorProc = GBlendColorRow<Mode>;
+        });
+        if (!fShader && fMode == GBlendMode::kSrc) {
+            fPackedColor = GPixel565_PackRGB(GPixel_GetR(fColor), GPixel_GetG(fColor),
+                                             GPixel_GetB(fColor));
+        } else if (fMode == GBlendMode::kClear) {
+            fPackedColor = 0;
+        } else if (!fShader) {
+            this->buildTables();
+        }
+    }
+
+    void blitRow(int x, int y, int count) override {
+        GPixel565* dst = fDst.getAddr(x, y);
+        if (fMode == GBlendMode::kDst) {
+            return;
+        }
+        if ((!fShader && fMode == GBlendMode::kSrc) || fMode == GBlendMode::kClear) {
+            fill_565(dst, fPackedColor, count);
+            return;
+        }
+
+        if (!fShader) {
+            // with a constant src (and Da == 1), each channel's result depends only on its own
+            // dst value, so it can be looked up
+            for (int i = 0; i < count; ++i) {
+                const GPixel565 d = dst[i];
+                dst[i] = fTableR[d >> 11] | fTableG[(d >> 5) & 63] | fTableB[d & 31];
+            }
+            return;
+        }
+
+        fSrc.resize(count);
+        fShader->shadeRow(x, y, count, fSrc.data());
+        if (fMode == GBlendMode::kSrc) {
+            GConvertPixelsTo565(fSrc.data(), count, dst);
+            return;
+        }
+        fRow.resize(count);
+        GConvert565ToPixels(dst, count, fRow.data());
+        fRowProc(fRow.data(), fSrc.data(), count);
+        GConvertPixelsTo565(fRow.data(), count, dst);
+    }
+
+private:
+    // Blend the color with every possible value of each dst channel, exactly as blitRow would
+    void buildTables() {
+        GPixel row[64];
+        for (int i = 0; i < 64; ++i) {
+            const GPixel565 d = ((i & 31) << 11) | (i << 5) | (i & 31);
+            row[i] = GPixel_PackARGB(0xFF, GPixel565_GetR(d), GPixel565_GetG(d),
+                                     GPixel565_GetB(d));
+        }
+        fColorProc(row, fColor, 64);
+        GPixel565 packed[64];
+        GConvertPixelsTo565(row, 64, packed);
+        for (int i = 0; i < 64; ++i) {
+            fTableG[i] = packed[i] & (63 << 5);
+            if (i < 32) {
+                fTableR[i] = packed[i] & (31 << 11);
+                fTableB[i] = packed[i] & 31;
+            }
+        }
+    }
+
+    const G565Bitmap    fDst;
+    GShader*            fShader;
+    const GPixel        fColor;
+    GPixel565           fPackedColor = 0;
+    GBlendMode          fMode;
+    RowProc             fRowProc;
+    ColorProc           fColorProc;
+    GPixel565           fTableR[32], fTableG[64], fTableB[32];
+    std::vector<GPixel> fSrc;
+    std::vector<GPixel> fRow;
+};
+
+class Canvas565 : public GRasterCanvas {
+public:
+    Canvas565(const G565Bitmap& bitmap)
+        : GRasterCanvas(bitmap.width(), bitmap.height()), fBitmap(bitmap)
+    {}
+
+protected:
+    std::unique_ptr<GBlitter> makeBlitter(const GPaint& paint) override {
+        return std::unique_ptr<GBlitter>(new Blitter565(fBitmap, paint));
+    }
+
+private:
+    const G565Bitmap fBitmap;
+};
+
+std::unique_ptr<GCanvas> GCreateCanvas(const G565Bitmap& bitmap) {
+    if (bitmap.width() <= 0 || bitmap.height() <= 0 || !bitmap.pixels()) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new Canvas565(bitmap));
+}
@@ -0,0 +1,102 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GBlend.h"
+#include "GRasterCanvas.h"
+#include "../include/GShader.h"
+
+using AlphaColorProc = void (*)(GAlpha dst[], unsigned sa, int count);
+using AlphaRowProc   = void (*)(GAlpha dst[], const GPixel src[], int count);
+
+template <GBlendMode Mode> void alpha_color(GAlpha dst[], unsigned sa, int count) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendAlpha<Mode>(sa, dst[i]);
+    }
+}
+
+template <GBlendMode Mode> void alpha_row(GAlpha dst[], const GPixel src[], int count) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendAlpha<Mode>(GPixel_GetA(src[i]), dst[i]);
+    }
+}
+
+static void alpha_fill(GAlpha dst[], unsigned sa, int count) {
+    memset(dst, sa, count);
+}
+
+static void alpha_noop(GAlpha[], unsigned, int) {}
+
+/**
+ *  Only the alpha of the paint (or of its shader) is used: the color channels are discarded,
+ *  and the blendmodes reduce to their alpha terms, e.g. srcover is Sa + (1 - Sa)*Da.
+ */
+class AlphaBlitter : public GBlitter {
+public:
+    AlphaBlitter(const GAlphaBitmap& dst, const GPaint& paint)
+        : fDst(dst), fShader(paint.peekShader())
+        , fAlpha(GPixel_GetA(GColorToPixel(paint.getColor())))
+    {
+        GBlendMode mode = paint.getBlendMode();
+        if (GBlendModeIsAdvanced(mode)) {
+            // they all have srcover's alpha
+            mode = GBlendMode::kSrcOver;
+        }
+        GVisitBlendMode(mode, [this](auto m) {
+            constexpr GBlendMode Mode = decltype(m)::value;
+            fColorProc = alpha_color<Mode>;
+            fRowProc = alpha_row<Mode>;
+        });
+        if (!fShader) {
+            if (mode == GBlendMode::kSrc || (mode == GBlendMode::kSrcOver && fAlpha == 0xFF) ||
+                mode == GBlendMode::kDstATop) {
+                fColorProc = alpha_fill;
+            } else if (mode == GBlendMode::kDst || mode == GBlendMode::kSrcATop ||
+                       (fAlpha == 0 && (mode == GBlendMode::kSrcOver ||
+                                        mode == GBlendMode::kDstOver))) {
+                fColorProc = alpha_noop;
+            }
+        }
+    }
+
+    void blitRow(int x, int y, int count) override {
+        GAlpha* dst = fDst.getAddr(x, y);
+        if (fShader) {
+            fRow.resize(count);
+            fShader->shadeRow(x, y, count, fRow.data());
+            fRowProc(dst, fRow.data(), count);
+        } else {
+            fColorProc(dst, fAlpha, count);
+        }
+    }
+
+private:
+    const GAlphaBitmap  fDst;
+    GShader*            fShader;
+    const unsigned      fAlpha;
+    AlphaColorProc      fColorProc;
+    AlphaRowProc        fRowProc;
+    std::vector<GPixel> fRow;
+};
+
+class AlphaCanvas : public GRasterCanvas {
+public:
+    AlphaCanvas(const GAlphaBitmap& bitmap)
+        : GRasterCanvas(bitmap.width(), bitmap.height()), fBitmap(bitmap)
+    {}
+
+protected:
+    std::unique_ptr<GBlitter> makeBlitter(const GPaint& paint) override {
+        return std::unique_ptr<GBlitter>(new AlphaBlitter(fBitmap, paint));
+    }
+
+private:
+    const GAlphaBitmap fBitmap;
+};
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GAlphaBitmap& bitmap) {
+    if (bitmap.width() <= 0 || bitmap.height() <= 0 || !bitmap.pixels()) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new AlphaCanvas(bitmap));
+}
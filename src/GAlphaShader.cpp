@@ -0,0 +1,133 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GMatrix.h"
+#include "../include/GShader.h"
+#include "GBlend.h"
+
+static inline GPixel scale_pixel(GPixel p, unsigned scale) {
+    return GPixel_PackARGB(GMul255(GPixel_GetA(p), scale), GMul255(GPixel_GetR(p), scale),
+                           GMul255(GPixel_GetG(p), scale), GMul255(GPixel_GetB(p), scale));
+}
+
+/**
+ *  Samples (nearest neighbor) coverage from an alpha bitmap, and uses it to scale either a
+ *  constant color or the output of another shader.
+ */
+class AlphaShader : public GShader {
+public:
+    enum Tiling {
+        kClamp_Tiling,
+        kRepeat_Tiling,
+        kMirror_Tiling,
+        kDecal_Tiling,      // zero outside of the bitmap
+    };
+
+    AlphaShader(const GAlphaBitmap& mask, const GMatrix& local, Tiling tiling,
+                GPixel color, std::shared_ptr<GShader> src)
+        : fMask(mask), fLocal(local), fTiling(tiling), fColor(color), fSrc(std::move(src))
+        , fInverse(GMatrix())
+    {}
+
+    bool isOpaque() override { return false; }
+
+    bool setContext(const GMatrix& ctm) override {
+        auto inv = (ctm * fLocal).invert();
+        if (!inv || (fSrc && !fSrc->setContext(ctm))) {
+            return false;
+        }
+        fInverse = *inv;
+        return true;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        fCoverage.resize(count);
+        this->sampleRow(x, y, count, fCoverage.data());
+
+        if (fSrc) {
+            fSrc->shadeRow(x, y, count, row);
+            for (int i = 0; i < count; ++i) {
+                row[i] = fCoverage[i] == 0xFF ? row[i] : scale_pixel(row[i], fCoverage[i]);
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                row[i] = scale_pixel(fColor, fCoverage[i]);
+            }
+        }
+    }
+
+private:
+    const GAlphaBitmap       fMask;
+    const GMatrix            fLocal;
+    const Tiling             fTiling;
+    const GPixel             fColor;
+    std::shared_ptr<GShader> fSrc;
+    GMatrix                  fInverse;
+    std::vector<GAlpha>      fCoverage;
+
+    static int Tile(int i, int n, Tiling tiling) {
+        switch (tiling) {
+            case kClamp_Tiling:  return std::max(0, std::min(i, n - 1));
+            case kRepeat_Tiling: return ((i % n) + n) % n;
+            case kMirror_Tiling: {
+                const int m = ((i % (2 * n)) + 2 * n) % (2 * n);
+                return m < n ? m : 2 * n - 1 - m;
+            }
+            case kDecal_Tiling:  return (i >= 0 && i < n) ? i : -1;
+        }
+        return -1;
+    }
+
+    void sampleRow(int x, int y, int count, GAlpha dst[]) const {
+        const int w = fMask.width(), h = fMask.height();
+        const GPoint p = fInverse * GPoint{x + 0.5f, y + 0.5f};
+
+        if (fInverse[0] == 1 && fInverse[1] == 0 && fInverse[2] == 0 && fInverse[3] == 1) {
+            // Just a translate: sample a run of the mask directly
+            const int iy = Tile(GFloorToInt(p.y), h, fTiling);
+            const int ix = GFloorToInt(p.x);
+            if (iy >= 0 && ix >= 0 && ix + count <= w) {
+                memcpy(dst, fMask.getAddr(ix, iy), count);
+                return;
+            }
+        }
+
+        const float dx = fInverse[0], dy = fInverse[1];
+        float px = p.x, py = p.y;
+        for (int i = 0; i < count; ++i) {
+            const int ix = Tile(GFloorToInt(px), w, fTiling);
+            const int iy = Tile(GFloorToInt(py), h, fTiling);
+            dst[i] = (ix < 0 || iy < 0) ? 0 : *fMask.getAddr(ix, iy);
+            px += dx;
+            py += dy;
+        }
+    }
+};
+
+static bool valid(const GAlphaBitmap& bm) {
+    return bm.width() > 0 && bm.height() > 0 && bm.pixels();
+}
+
+std::shared_ptr<GShader> GCreateAlphaShader(const GAlphaBitmap& mask, const GColor& color,
+                                            const GMatrix& localMatrix, GTileMode mode) {
+    if (!valid(mask)) {
+        return nullptr;
+    }
+    AlphaShader::Tiling tiling = AlphaShader::kClamp_Tiling;
+    switch (mode) {
+        case GTileMode::kClamp:  tiling = AlphaShader::kClamp_Tiling;  break;
+        case GTileMode::kRepeat: tiling = AlphaShader::kRepeat_Tiling; break;
+        case GTileMode::kMirror: tiling = AlphaShader::kMirror_Tiling; break;
+    }
+    return std::make_shared<AlphaShader>(mask, localMatrix, tiling, GColorToPixel(color), nullptr);
+}
+
+std::shared_ptr<GShader> GCreateMaskShader(std::shared_ptr<GShader> src, const GAlphaBitmap& mask,
+                                           const GMatrix& localMatrix) {
+    if (!src || !valid(mask)) {
+        return nullptr;
+    }
+    return std::make_shared<AlphaShader>(mask, localMatrix, AlphaShader::kDecal_Tiling, 0,
+                                         std::move(src));
+}
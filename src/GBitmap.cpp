@@ -4,6 +4,10 @@
 
 #include "../include/GBitmap.h"
 
+#ifdef __linux__
+    #include <sys/mman.h>
+#endif
+
 void GBitmap::setIsOpaque(IsOpaque io) {
     switch (io) {
         case kYes_IsOpaque: fIsOpaque = true;  break;
@@ -47,3 +51,33 @@ void GBitmap::alloc(int w, int h, size_t rb) {
                 (w > 0 && h > 0) ? (GPixel*)calloc(h, rb) : nullptr,
                 kNo_IsOpaque);
 }
+
+// Transparent huge pages are 2MB on x86-64 and most arm64 kernels
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+bool GBitmap::allocHugePages(int w, int h, size_t rb) {
+    assert(w >= 0);
+    assert(h >= 0);
+    if (rb == 0) {
+        rb = w * sizeof(GPixel);
+    }
+
+    GPixel* pixels = nullptr;
+    if (w > 0 && h > 0) {
+        const size_t size = h * rb;
+        const size_t alignedSize = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        void* storage = nullptr;
+        if (posix_memalign(&storage, kHugePageSize, alignedSize)) {
+            this->reset();
+            return false;
+        }
+#ifdef MADV_HUGEPAGE
+        // Advise before touching the memory, so the first faults can be satisfied with huge pages
+        madvise(storage, alignedSize, MADV_HUGEPAGE);
+#endif
+        memset(storage, 0, size);
+        pixels = (GPixel*)storage;
+    }
+    this->reset(w, h, rb, pixels, kNo_IsOpaque);
+    return true;
+}
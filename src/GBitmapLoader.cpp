@@ -0,0 +1,23 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GBitmapLoader.h"
+#include "GParallel.h"
+
+#include <chrono>
+
+std::vector<GBitmapLoadResult> GLoadBitmaps(const std::vector<std::string>& paths,
+                                            int maxThreads) {
+    std::vector<GBitmapLoadResult> results(paths.size());
+
+    // Each file is independent (lodepng keeps no global state), so just hand them out to workers
+    GParallelFor((int)paths.size(), [&](int i) {
+        auto start = std::chrono::steady_clock::now();
+        results[i].fSuccess = results[i].fBitmap.readFromFile(paths[i].c_str());
+        std::chrono::duration<double, std::milli> dur = std::chrono::steady_clock::now() - start;
+        results[i].fDecodeMS = dur.count();
+    }, maxThreads);
+
+    return results;
+}
@@ -3,66 +3,237 @@
  */
 
 #include "../include/GBitmap.h"
+#include "../include/GPNGWriter.h"
+#include "../include/GPixelConvert.h"
+#include "GDeflate.h"
 #include "lodepng.h"
 
-static void convertToPNG(const GPixel src[], int width, uint8_t dst[]) {
-    for (int i = 0; i < width; i++) {
-        GPixel c = *src++;
-        int a = GPixel_GetA(c);
-        int r = GPixel_GetR(c);
-        int g = GPixel_GetG(c);
-        int b = GPixel_GetB(c);
-        
-        // PNG requires unpremultiplied, but GPixel is premultiplied
-        if (0 != a && 255 != a) {
-            r = (r * 255 + a/2) / a;
-            g = (g * 255 + a/2) / a;
-            b = (b * 255 + a/2) / a;
+#include <algorithm>
+
+bool GBitmap::writeToFile(const char path[]) const {
+    return GPNGWriter::Write(*this, path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void write_be32(uint8_t dst[], uint32_t value) {
+    dst[0] = value >> 24;
+    dst[1] = value >> 16;
+    dst[2] = value >>  8;
+    dst[3] = value >>  0;
+}
+
+/**
+ *  PNG filters predict each byte from its neighbors: a (left), b (above), c (above-left), and
+ *  store the difference. "left" is the same channel in the previous pixel, i.e. bpp bytes back.
+ */
+enum {
+    kNone_Filter,
+    kSub_Filter,
+    kUp_Filter,
+    kAverage_Filter,
+    kPaeth_Filter,
+};
+
+static int paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+template <int Filter>
+static unsigned filter_row(const uint8_t curr[], const uint8_t prev[], int n, int bpp,
+                           uint8_t dst[]) {
+    unsigned sum = 0;
+    for (int i = 0; i < n; ++i) {
+        const int a = i >= bpp ? curr[i - bpp] : 0;
+        const int b = prev[i];
+        const int c = i >= bpp ? prev[i - bpp] : 0;
+        int pred = 0;
+        switch (Filter) {
+            case kNone_Filter:    pred = 0;                break;
+            case kSub_Filter:     pred = a;                break;
+            case kUp_Filter:      pred = b;                break;
+            case kAverage_Filter: pred = (a + b) >> 1;     break;
+            case kPaeth_Filter:   pred = paeth(a, b, c);   break;
         }
-        *dst++ = r;
-        *dst++ = g;
-        *dst++ = b;
-        *dst++ = a;
+        dst[i] = curr[i] - pred;
+        // Score the residuals as signed values (small in either direction is good), except for
+        // "none", whose bytes are raw values and not residuals at all.
+        sum += Filter == kNone_Filter ? dst[i] : abs((int8_t)dst[i]);
     }
+    return sum;
 }
 
-bool GBitmap::writeToFile(const char path[]) const {
-    size_t rb = this->width() * 4;
-    uint8_t* pix = (uint8_t*)malloc(this->height() * rb);
-    if (!pix) {
-        return false;
+using FilterProc = unsigned (*)(const uint8_t[], const uint8_t[], int, int, uint8_t[]);
+static const FilterProc gFilterProcs[] = {
+    filter_row<kNone_Filter>,
+    filter_row<kSub_Filter>,
+    filter_row<kUp_Filter>,
+    filter_row<kAverage_Filter>,
+    filter_row<kPaeth_Filter>,
+};
+
+GPNGWriter::GPNGWriter(FILE* file, int w, int h, int level, bool opaque)
+    : fFile(file), fWidth(w), fHeight(h), fLevel(level), fBytesPerPixel(opaque ? 3 : 4)
+    , fCurr(w * 4), fPrev(w * 4, 0), fRow(1 + w * 4), fScratch(w * 4)
+{
+    fDeflater.reset(new GDeflater(level, [this](const uint8_t data[], size_t length) {
+        return this->writeChunk("IDAT", data, length);
+    }));
+}
+
+GPNGWriter::~GPNGWriter() {
+    if (fFile) {
+        fclose(fFile);
+    }
+}
+
+std::unique_ptr<GPNGWriter> GPNGWriter::Create(const char path[], int w, int h, int level,
+                                               bool opaque) {
+    if (w <= 0 || h <= 0 || level < kStore_Level || level > kBest_Level) {
+        return nullptr;
+    }
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return nullptr;
     }
+    std::unique_ptr<GPNGWriter> writer(new GPNGWriter(file, w, h, level, opaque));
 
-    const GPixel* src = this->pixels();
-    uint8_t* dst = pix;
-    for (int y = 0; y < this->height(); ++y) {
-        convertToPNG(src, this->width(), dst);
-        src += this->rowBytes() / 4;
-        dst += rb;
+    const uint8_t signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    uint8_t ihdr[13];
+    write_be32(ihdr + 0, w);
+    write_be32(ihdr + 4, h);
+    ihdr[8]  = 8;   // bits per channel
+    ihdr[9]  = opaque ? 2 : 6;   // color-type : RGB or RGBA
+    ihdr[10] = 0;   // compression: deflate
+    ihdr[11] = 0;   // filtering  : adaptive
+    ihdr[12] = 0;   // no interlace
+    if (fwrite(signature, sizeof(signature), 1, file) != 1 ||
+        !writer->writeChunk("IHDR", ihdr, sizeof(ihdr))) {
+        return nullptr;
     }
+    return writer;
+}
 
-    unsigned err = lodepng_encode32_file(path, pix, this->width(), this->height());
-    free(pix);
-    return err == 0;
+bool GPNGWriter::writeChunk(const char type[4], const uint8_t data[], size_t length) {
+    std::vector<uint8_t> chunk(4 + 4 + length + 4);
+    write_be32(&chunk[0], (uint32_t)length);
+    memcpy(&chunk[4], type, 4);
+    if (length) {
+        memcpy(&chunk[8], data, length);
+    }
+    write_be32(&chunk[8 + length], lodepng_crc32(&chunk[4], 4 + length));
+    fOK = fOK && fwrite(chunk.data(), chunk.size(), 1, fFile) == 1;
+    return fOK;
 }
 
-///////////////////////////////////////////////////////////////////////////////
+void GPNGWriter::filterRow() {
+    const int bpp = fBytesPerPixel;
+    const int n = fWidth * bpp;
+    uint8_t* dst = &fRow[1];
 
-static int alpha_mul(unsigned a, unsigned c) {
-    return (a * c + 127) / 255;
+    if (fLevel == kStore_Level) {
+        // not compressing, so there is no point in spending time filtering
+        fRow[0] = kNone_Filter;
+        memcpy(dst, fCurr.data(), n);
+    } else if (fLevel <= 3) {
+        fRow[0] = kSub_Filter;
+        gFilterProcs[kSub_Filter](fCurr.data(), fPrev.data(), n, bpp, dst);
+    } else {
+        // Try each filter, keeping the one whose output is "smallest" (sum of abs(signed-byte)).
+        // This is the usual heuristic (e.g. libpng, lodepng) for picking filters adaptively.
+        unsigned best = ~0u;
+        for (int f = kNone_Filter; f <= kPaeth_Filter; ++f) {
+            unsigned sum = gFilterProcs[f](fCurr.data(), fPrev.data(), n, bpp, fScratch.data());
+            if (sum < best) {
+                best = sum;
+                fRow[0] = f;
+                memcpy(dst, fScratch.data(), n);
+            }
+        }
+    }
+    std::swap(fCurr, fPrev);
+}
+
+bool GPNGWriter::writeRow(const GPixel row[]) {
+    if (!fOK || fRowsWritten >= fHeight) {
+        return false;
+    }
+    GConvertPixelsToRGBA(row, fWidth, fCurr.data());
+    if (fBytesPerPixel == 3) {
+        // drop the (all 0xFF) alpha bytes, packing the row down to RGB
+        uint8_t* rgb = fCurr.data();
+        for (int i = 0; i < fWidth; ++i) {
+            assert(fCurr[i * 4 + 3] == 0xFF);
+            memmove(rgb + i * 3, &fCurr[i * 4], 3);
+        }
+    }
+    this->filterRow();
+    fRowsWritten += 1;
+    return fDeflater->write(fRow.data(), 1 + fWidth * fBytesPerPixel) && fOK;
 }
 
-static void swizzle_rgba_row(GPixel dst[], const uint8_t src[], int count) {
-    for (int i = 0; i < count; ++i) {
-        unsigned a = src[3];
-        dst[i] = GPixel_PackARGB(a,
-                                 alpha_mul(a, src[0]),
-                                 alpha_mul(a, src[1]),
-                                 alpha_mul(a, src[2]));
-        src += 4;
+bool GPNGWriter::finish() {
+    if (!fOK || fRowsWritten != fHeight) {
+        return false;
     }
+    fOK = fDeflater->finish() && fOK;
+    fOK = fOK && this->writeChunk("IEND", nullptr, 0);
+    fOK = fclose(fFile) == 0 && fOK;
+    fFile = nullptr;
+    return fOK;
 }
 
+bool GPNGWriter::Write(const GBitmap& bitmap, const char path[], int level) {
+    // Checking is a quick read-only pass, and dropping alpha shrinks the data to be compressed
+    GBitmap probe = bitmap;
+    probe.computeIsOpaque();
+
+    auto writer = Create(path, bitmap.width(), bitmap.height(), level, probe.isOpaque());
+    if (!writer) {
+        return false;
+    }
+    for (int y = 0; y < bitmap.height(); ++y) {
+        if (!writer->writeRow(bitmap.getAddr(0, y))) {
+            return false;
+        }
+    }
+    return writer->finish();
+}
+
+bool GPNGWriter::Write(const GF16Bitmap& bitmap, const char path[], int level) {
+    const int w = bitmap.width(), h = bitmap.height();
+    std::vector<GPixel> row(w);
+
+    bool opaque = true;
+    for (int y = 0; y < h && opaque; ++y) {
+        GConvertF16ToPixels(bitmap.getAddr(0, y), w, row.data());
+        for (int x = 0; x < w && opaque; ++x) {
+            opaque = GPixel_GetA(row[x]) == 0xFF;
+        }
+    }
+
+    auto writer = Create(path, w, h, level, opaque);
+    if (!writer) {
+        return false;
+    }
+    for (int y = 0; y < h; ++y) {
+        GConvertF16ToPixels(bitmap.getAddr(0, y), w, row.data());
+        if (!writer->writeRow(row.data())) {
+            return false;
+        }
+    }
+    return writer->finish();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool GBitmap::readFromFile(const char path[]) {
     unsigned w, h;
     unsigned char* pix = nullptr;
@@ -77,7 +248,7 @@ bool GBitmap::readFromFile(const char path[]) {
     const uint8_t* src = pix;
     size_t rb = w * 4;
     for (unsigned y = 0; y < h; ++y) {
-        swizzle_rgba_row(dst, src, w);
+        GConvertRGBAToPixels(src, w, dst);
         src += rb;
         dst += this->rowBytes() / 4;
     }
@@ -0,0 +1,569 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GBlend_DEFINED
+#define GBlend_DEFINED
+
+#include "../include/GBlendMode.h"
+#include "../include/GColor.h"
+#include "../include/GPixel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+/**
+ *  Returns (x + 127) / 255 for 0 <= x <= 255*255, i.e. the correctly rounded product of two
+ *  8-bit values, without a divide.
+ */
+static inline unsigned GDiv255(unsigned x) {
+    return (x + 128) * 257 >> 16;
+}
+
+static inline unsigned GMul255(unsigned a, unsigned b) {
+    return GDiv255(a * b);
+}
+
+/**
+ *  Convert the (unpremultiplied) color into a premultiplied GPixel.
+ */
+static inline GPixel GColorToPixel(const GColor& color) {
+    const GColor c = color.pinToUnit();
+    const float a = c.a * 255;
+    return GPixel_PackARGB(GRoundToInt(a), GRoundToInt(c.r * a), GRoundToInt(c.g * a),
+                           GRoundToInt(c.b * a));
+}
+
+/**
+ *  The advanced modes (kMultiply and after) all produce srcover's alpha, and compute each color
+ *  channel on its own.
+ */
+static constexpr bool GBlendModeIsAdvanced(GBlendMode mode) {
+    return mode >= GBlendMode::kMultiply;
+}
+
+/**
+ *  One color channel of each advanced mode, for premultiplied values in 0...1.
+ */
+template <GBlendMode Mode> float GBlendAdvanced(float s, float d, float sa, float da) {
+    // the parts of the src and dst that the other does not cover
+    const float uncovered = s * (1 - da) + d * (1 - sa);
+    switch (Mode) {
+        case GBlendMode::kMultiply:     return uncovered + s * d;
+        case GBlendMode::kScreen:       return s + d - s * d;
+        case GBlendMode::kOverlay:
+            return uncovered + (2 * d <= da ? 2 * s * d : sa * da - 2 * (da - d) * (sa - s));
+        case GBlendMode::kDarken:       return s + d - std::max(s * da, d * sa);
+        case GBlendMode::kLighten:      return s + d - std::min(s * da, d * sa);
+        case GBlendMode::kColorDodge:
+            if (d <= 0) {
+                return s * (1 - da);
+            }
+            if (s >= sa) {
+                return sa * da + uncovered;
+            }
+            return sa * std::min(da, d * sa / (sa - s)) + uncovered;
+        case GBlendMode::kColorBurn:
+            if (d >= da) {
+                return d + s * (1 - da);
+            }
+            if (s <= 0) {
+                return d * (1 - sa);
+            }
+            return sa * (da - std::min(da, (da - d) * sa / s)) + uncovered;
+        case GBlendMode::kHardLight:
+            return uncovered + (2 * s <= sa ? 2 * s * d : sa * da - 2 * (da - d) * (sa - s));
+        case GBlendMode::kSoftLight: {
+            // see the W3C compositing spec; m is the unpremultiplied dst
+            const float m = da > 0 ? d / da : 0;
+            const float s2 = 2 * s, m4 = 4 * m;
+            const float darkSrc = d * (sa + (s2 - sa) * (1 - m));
+            const float darkDst = (m4 * m4 + m4) * (m - 1) + 7 * m;
+            const float liteDst = sqrtf(m) - m;
+            const float liteSrc = d * sa + da * (s2 - sa) * (4 * d <= da ? darkDst : liteDst);
+            return uncovered + (s2 <= sa ? darkSrc : liteSrc);
+        }
+        case GBlendMode::kDifference:   return s + d - 2 * std::min(s * da, d * sa);
+        case GBlendMode::kExclusion:    return s + d - 2 * s * d;
+        default: break;
+    }
+    return 0;
+}
+
+// The advanced modes whose 8-bit channels are computed (with GDiv255) in integers; the others
+// need a divide or a square root, and are computed with GBlendAdvanced.
+static constexpr bool GBlendModeIsIntegral(GBlendMode mode) {
+    return GBlendModeIsAdvanced(mode) && mode != GBlendMode::kColorDodge &&
+           mode != GBlendMode::kColorBurn && mode != GBlendMode::kSoftLight;
+}
+
+/**
+ *  The alpha channel of each GBlendMode, given the src and dst alphas (0...255).
+ */
+template <GBlendMode Mode> unsigned GBlendAlpha(unsigned sa, unsigned da) {
+    if (GBlendModeIsAdvanced(Mode)) {
+        return sa + GMul255(255 - sa, da);
+    }
+    switch (Mode) {
+        case GBlendMode::kClear:    return 0;
+        case GBlendMode::kSrc:      return sa;
+        case GBlendMode::kDst:      return da;
+        case GBlendMode::kSrcOver:  return sa + GMul255(255 - sa, da);
+        case GBlendMode::kDstOver:  return da + GMul255(255 - da, sa);
+        case GBlendMode::kSrcIn:    return GMul255(sa, da);
+        case GBlendMode::kDstIn:    return GMul255(sa, da);
+        case GBlendMode::kSrcOut:   return GMul255(255 - da, sa);
+        case GBlendMode::kDstOut:   return GMul255(255 - sa, da);
+        case GBlendMode::kSrcATop:  return da;
+        case GBlendMode::kDstATop:  return sa;
+        case GBlendMode::kXor:      return GMul255(255 - sa, da) + GMul255(255 - da, sa);
+        default: break;
+    }
+    return 0;
+}
+
+/**
+ *  One (premultiplied) channel of each GBlendMode, given the src and dst values of that channel
+ *  and the src and dst alphas (all 0...255). For the alpha channel itself, s == sa and d == da
+ *  (except for the advanced modes, whose alpha is GBlendAlpha).
+ */
+template <GBlendMode Mode>
+unsigned GBlendChannel(unsigned s, unsigned d, unsigned sa, unsigned da) {
+    switch (Mode) {
+        case GBlendMode::kClear:    return 0;
+        case GBlendMode::kSrc:      return s;
+        case GBlendMode::kDst:      return d;
+        case GBlendMode::kSrcOver:  return s + GMul255(255 - sa, d);
+        case GBlendMode::kDstOver:  return d + GMul255(255 - da, s);
+        case GBlendMode::kSrcIn:    return GMul255(da, s);
+        case GBlendMode::kDstIn:    return GMul255(sa, d);
+        case GBlendMode::kSrcOut:   return GMul255(255 - da, s);
+        case GBlendMode::kDstOut:   return GMul255(255 - sa, d);
+        case GBlendMode::kSrcATop:  return GMul255(da, s) + GMul255(255 - sa, d);
+        case GBlendMode::kDstATop:  return GMul255(sa, d) + GMul255(255 - da, s);
+        case GBlendMode::kXor:      return GMul255(255 - sa, d) + GMul255(255 - da, s);
+
+        // The advanced modes, for color channels only. These are exact (before the final
+        // GDiv255), so the sums never exceed 255*255 and the differences are never negative.
+        case GBlendMode::kMultiply:
+            return GDiv255(s * (255 - da) + d * (255 - sa) + s * d);
+        case GBlendMode::kScreen:       return s + d - GMul255(s, d);
+        case GBlendMode::kOverlay:
+            return GDiv255(s * (255 - da) + d * (255 - sa) +
+                           (2 * d <= da ? 2 * s * d : sa * da - 2 * (da - d) * (sa - s)));
+        case GBlendMode::kDarken:       return s + d - GDiv255(std::max(s * da, d * sa));
+        case GBlendMode::kLighten:      return s + d - GDiv255(std::min(s * da, d * sa));
+        case GBlendMode::kHardLight:
+            return GDiv255(s * (255 - da) + d * (255 - sa) +
+                           (2 * s <= sa ? 2 * s * d : sa * da - 2 * (da - d) * (sa - s)));
+        case GBlendMode::kDifference:   return s + d - 2 * GDiv255(std::min(s * da, d * sa));
+        case GBlendMode::kExclusion:    return s + d - 2 * GMul255(s, d);
+        default: {
+            const float k = 1 / 255.0f;
+            const float c = GBlendAdvanced<Mode>(s * k, d * k, sa * k, da * k);
+            return GRoundToInt(GPinToUnit(c) * 255);
+        }
+    }
+    return 0;
+}
+
+template <GBlendMode Mode> GPixel GBlendPixel(GPixel src, GPixel dst) {
+    const unsigned sa = GPixel_GetA(src), da = GPixel_GetA(dst);
+    if (GBlendModeIsAdvanced(Mode)) {
+        // keep the result premultiplied, in case of rounding in GBlendAdvanced
+        const unsigned a = GBlendAlpha<Mode>(sa, da);
+        auto channel = [&](unsigned s, unsigned d) {
+            return std::min(GBlendChannel<Mode>(s, d, sa, da), a);
+        };
+        return GPixel_PackARGB(a, channel(GPixel_GetR(src), GPixel_GetR(dst)),
+                               channel(GPixel_GetG(src), GPixel_GetG(dst)),
+                               channel(GPixel_GetB(src), GPixel_GetB(dst)));
+    }
+    return GPixel_PackARGB(GBlendChannel<Mode>(sa, da, sa, da),
+                           GBlendChannel<Mode>(GPixel_GetR(src), GPixel_GetR(dst), sa, da),
+                           GBlendChannel<Mode>(GPixel_GetG(src), GPixel_GetG(dst), sa, da),
+                           GBlendChannel<Mode>(GPixel_GetB(src), GPixel_GetB(dst), sa, da));
+}
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+/**
+ *  SIMD versions of srcover (the most common mode) and the integral advanced modes, for 4 pixels
+ *  at a time. Each channel is computed in a 16-bit lane with the same rounding as GMul255 and
+ *  GDiv255, so results are identical to the scalar procs.
+ */
+static inline __m128i GDiv255_epu16(__m128i x) {
+    __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// broadcast the alpha of each of the 2 unpacked pixels to all 4 of its lanes
+static inline __m128i GAlpha_epu16(__m128i x) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)),
+                               _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// s + (255 - sa) * d / 255 for 2 pixels, each unpacked as 4 16-bit lanes
+static inline __m128i GSrcOver_epu16(__m128i s, __m128i d) {
+    __m128i isa = _mm_sub_epi16(_mm_set1_epi16(255), GAlpha_epu16(s));
+    return _mm_add_epi16(s, GDiv255_epu16(_mm_mullo_epi16(d, isa)));
+}
+
+static inline __m128i GSrcOver4(__m128i src, __m128i dst) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = GSrcOver_epu16(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+    __m128i hi = GSrcOver_epu16(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+// SSE2 only compares signed 16-bit values, so products (up to 255*255) are biased first
+static inline __m128i GMin_epu16(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi16(-0x8000);
+    return _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+static inline __m128i GMax_epu16(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi16(-0x8000);
+    return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+// 2*s*d if 2*s <= sa, else sa*da - 2*(da - d)*(sa - s): the middle term of kHardLight. (Both
+// sides are computed for every lane; the one not selected may wrap, which is harmless.)
+static inline __m128i GHardLightTerm_epu16(__m128i s, __m128i d, __m128i sa, __m128i da) {
+    __m128i mul = _mm_slli_epi16(_mm_mullo_epi16(s, d), 1);
+    __m128i scr = _mm_sub_epi16(_mm_mullo_epi16(sa, da),
+                                _mm_slli_epi16(_mm_mullo_epi16(_mm_sub_epi16(da, d),
+                                                               _mm_sub_epi16(sa, s)), 1));
+    __m128i useScreen = _mm_cmpgt_epi16(_mm_slli_epi16(s, 1), sa);
+    return _mm_or_si128(_mm_and_si128(useScreen, scr), _mm_andnot_si128(useScreen, mul));
+}
+
+/**
+ *  The integral advanced modes for 2 unpacked pixels, following GBlendChannel. Every lane is
+ *  blended as a color, then the alpha lanes are replaced with srcover's.
+ */
+template <GBlendMode Mode> __m128i GBlendAdvanced_epu16(__m128i s, __m128i d) {
+    const __m128i k255 = _mm_set1_epi16(255);
+    const __m128i sa = GAlpha_epu16(s), da = GAlpha_epu16(d);
+    auto uncovered = [&]() {
+        return _mm_add_epi16(_mm_mullo_epi16(s, _mm_sub_epi16(k255, da)),
+                             _mm_mullo_epi16(d, _mm_sub_epi16(k255, sa)));
+    };
+    auto sum = [&]() { return _mm_add_epi16(s, d); };
+
+    __m128i c;
+    switch (Mode) {
+        case GBlendMode::kMultiply:
+            c = GDiv255_epu16(_mm_add_epi16(uncovered(), _mm_mullo_epi16(s, d)));
+            break;
+        case GBlendMode::kScreen:
+            c = _mm_sub_epi16(sum(), GDiv255_epu16(_mm_mullo_epi16(s, d)));
+            break;
+        case GBlendMode::kOverlay:
+            c = GDiv255_epu16(_mm_add_epi16(uncovered(), GHardLightTerm_epu16(d, s, da, sa)));
+            break;
+        case GBlendMode::kDarken:
+            c = _mm_sub_epi16(sum(), GDiv255_epu16(GMax_epu16(_mm_mullo_epi16(s, da),
+                                                              _mm_mullo_epi16(d, sa))));
+            break;
+        case GBlendMode::kLighten:
+            c = _mm_sub_epi16(sum(), GDiv255_epu16(GMin_epu16(_mm_mullo_epi16(s, da),
+                                                              _mm_mullo_epi16(d, sa))));
+            break;
+        case GBlendMode::kHardLight:
+            c = GDiv255_epu16(_mm_add_epi16(uncovered(), GHardLightTerm_epu16(s, d, sa, da)));
+            break;
+        case GBlendMode::kDifference:
+            c = _mm_sub_epi16(sum(), _mm_slli_epi16(GDiv255_epu16(
+                    GMin_epu16(_mm_mullo_epi16(s, da), _mm_mullo_epi16(d, sa))), 1));
+            break;
+        case GBlendMode::kExclusion:
+            c = _mm_sub_epi16(sum(), _mm_slli_epi16(GDiv255_epu16(_mm_mullo_epi16(s, d)), 1));
+            break;
+        default:
+            c = _mm_setzero_si128();
+            break;
+    }
+
+    const __m128i a = GSrcOver_epu16(sa, da);
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    c = _mm_min_epi16(c, a);
+    return _mm_or_si128(_mm_and_si128(alphaLanes, a), _mm_andnot_si128(alphaLanes, c));
+}
+
+template <GBlendMode Mode> __m128i GBlendAdvanced4(__m128i src, __m128i dst) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = GBlendAdvanced_epu16<Mode>(_mm_unpacklo_epi8(src, zero),
+                                            _mm_unpacklo_epi8(dst, zero));
+    __m128i hi = GBlendAdvanced_epu16<Mode>(_mm_unpackhi_epi8(src, zero),
+                                            _mm_unpackhi_epi8(dst, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+static inline __m128 GSelect_ps(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/**
+ *  The other advanced modes (which divide, or take a square root) for 1 pixel, with each channel
+ *  in a float lane. This follows GBlendAdvanced and GBlendChannel operation for operation, so
+ *  again the results are identical. Every branch is computed, and the right one selected.
+ */
+template <GBlendMode Mode> GPixel GBlendAdvanced1(GPixel src, GPixel dst) {
+    const __m128i zero = _mm_setzero_si128();
+    auto load = [&](GPixel p) {
+        __m128i i = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p), zero), zero);
+        return _mm_mul_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(1 / 255.0f));
+    };
+    const __m128 s = load(src), d = load(dst);
+    const __m128 sa = _mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 da = _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 one = _mm_set1_ps(1), fzero = _mm_setzero_ps();
+    const __m128 uncovered = _mm_add_ps(_mm_mul_ps(s, _mm_sub_ps(one, da)),
+                                        _mm_mul_ps(d, _mm_sub_ps(one, sa)));
+    __m128 c;
+    switch (Mode) {
+        case GBlendMode::kColorDodge: {
+            __m128 q = _mm_div_ps(_mm_mul_ps(d, sa), _mm_sub_ps(sa, s));
+            __m128 r = _mm_add_ps(_mm_mul_ps(sa, _mm_min_ps(q, da)), uncovered);
+            r = GSelect_ps(_mm_cmpge_ps(s, sa), _mm_add_ps(_mm_mul_ps(sa, da), uncovered), r);
+            c = GSelect_ps(_mm_cmple_ps(d, fzero), _mm_mul_ps(s, _mm_sub_ps(one, da)), r);
+        } break;
+        case GBlendMode::kColorBurn: {
+            __m128 q = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(da, d), sa), s);
+            __m128 r = _mm_add_ps(_mm_mul_ps(sa, _mm_sub_ps(da, _mm_min_ps(q, da))), uncovered);
+            r = GSelect_ps(_mm_cmple_ps(s, fzero), _mm_mul_ps(d, _mm_sub_ps(one, sa)), r);
+            c = GSelect_ps(_mm_cmpge_ps(d, da),
+                           _mm_add_ps(d, _mm_mul_ps(s, _mm_sub_ps(one, da))), r);
+        } break;
+        case GBlendMode::kSoftLight: {
+            const __m128 m = _mm_and_ps(_mm_cmpgt_ps(da, fzero), _mm_div_ps(d, da));
+            const __m128 s2 = _mm_add_ps(s, s), m4 = _mm_mul_ps(_mm_set1_ps(4), m);
+            const __m128 s2sa = _mm_sub_ps(s2, sa);
+            const __m128 darkSrc = _mm_mul_ps(d, _mm_add_ps(sa, _mm_mul_ps(s2sa,
+                                                                           _mm_sub_ps(one, m))));
+            const __m128 darkDst = _mm_add_ps(
+                    _mm_mul_ps(_mm_add_ps(_mm_mul_ps(m4, m4), m4), _mm_sub_ps(m, one)),
+                    _mm_mul_ps(_mm_set1_ps(7), m));
+            const __m128 liteDst = _mm_sub_ps(_mm_sqrt_ps(m), m);
+            const __m128 useDark = _mm_cmple_ps(_mm_mul_ps(_mm_set1_ps(4), d), da);
+            const __m128 liteSrc = _mm_add_ps(_mm_mul_ps(d, sa),
+                                              _mm_mul_ps(_mm_mul_ps(da, s2sa),
+                                                         GSelect_ps(useDark, darkDst, liteDst)));
+            c = _mm_add_ps(uncovered, GSelect_ps(_mm_cmple_ps(s2, sa), darkSrc, liteSrc));
+        } break;
+        default:
+            c = fzero;
+            break;
+    }
+    c = _mm_max_ps(_mm_min_ps(c, one), fzero);
+    __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255)),
+                                            _mm_set1_ps(0.5f)));
+
+    const unsigned a = GBlendAlpha<Mode>(GPixel_GetA(src), GPixel_GetA(dst));
+    i = _mm_min_epi16(i, _mm_set1_epi32(a));
+    i = _mm_packs_epi32(i, i);
+    const GPixel p = _mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+    return (p & ~(0xFFu << GPIXEL_SHIFT_A)) | (a << GPIXEL_SHIFT_A);
+}
+
+#endif
+
+/**
+ *  Blend a row of src pixels (or a single src color) into dst[].
+ */
+template <GBlendMode Mode> void GBlendRow(GPixel dst[], const GPixel src[], int count) {
+#if defined(__SSE2__)
+    if constexpr (GBlendModeIsIntegral(Mode)) {
+        for (; count >= 4; count -= 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)dst);
+            __m128i s = _mm_loadu_si128((const __m128i*)src);
+            _mm_storeu_si128((__m128i*)dst, GBlendAdvanced4<Mode>(s, d));
+            src += 4;
+            dst += 4;
+        }
+    } else if constexpr (GBlendModeIsAdvanced(Mode)) {
+        for (; count > 0; --count) {
+            *dst = GBlendAdvanced1<Mode>(*src++, *dst);
+            dst += 1;
+        }
+    }
+#endif
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendPixel<Mode>(src[i], dst[i]);
+    }
+}
+
+template <GBlendMode Mode> void GBlendColorRow(GPixel dst[], GPixel src, int count) {
+#if defined(__SSE2__)
+    if constexpr (GBlendModeIsIntegral(Mode)) {
+        const __m128i s = _mm_set1_epi32(src);
+        for (; count >= 4; count -= 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)dst);
+            _mm_storeu_si128((__m128i*)dst, GBlendAdvanced4<Mode>(s, d));
+            dst += 4;
+        }
+    } else if constexpr (GBlendModeIsAdvanced(Mode)) {
+        for (; count > 0; --count) {
+            *dst = GBlendAdvanced1<Mode>(src, *dst);
+            dst += 1;
+        }
+    }
+#endif
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendPixel<Mode>(src, dst[i]);
+    }
+}
+
+#if defined(__SSE2__)
+
+template <> inline void GBlendRow<GBlendMode::kSrcOver>(GPixel dst[], const GPixel src[],
+                                                         int count) {
+    for (; count >= 4; count -= 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)dst);
+        _mm_storeu_si128((__m128i*)dst, GSrcOver4(_mm_loadu_si128((const __m128i*)src), d));
+        src += 4;
+        dst += 4;
+    }
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendPixel<GBlendMode::kSrcOver>(src[i], dst[i]);
+    }
+}
+
+template <> inline void GBlendColorRow<GBlendMode::kSrcOver>(GPixel dst[], GPixel src,
+                                                              int count) {
+    const __m128i s = _mm_set1_epi32(src);
+    for (; count >= 4; count -= 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)dst);
+        _mm_storeu_si128((__m128i*)dst, GSrcOver4(s, d));
+        dst += 4;
+    }
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GBlendPixel<GBlendMode::kSrcOver>(src, dst[i]);
+    }
+}
+
+#endif
+
+/**
+ *  Four floats -- one premultiplied r, g, b, a pixel -- held in a single SSE register where
+ *  available, for blending in float (e.g. for higher precision formats).
+ */
+struct GFloat4 {
+#if defined(__SSE2__)
+    __m128 fV;
+
+    GFloat4(__m128 v) : fV(v) {}
+    GFloat4(float x) : fV(_mm_set1_ps(x)) {}
+    GFloat4(float r, float g, float b, float a) : fV(_mm_setr_ps(r, g, b, a)) {}
+
+    static GFloat4 Load(const float p[]) { return _mm_loadu_ps(p); }
+    void store(float p[]) const { _mm_storeu_ps(p, fV); }
+
+    GFloat4 alpha() const { return _mm_shuffle_ps(fV, fV, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    GFloat4 operator+(GFloat4 o) const { return _mm_add_ps(fV, o.fV); }
+    GFloat4 operator-(GFloat4 o) const { return _mm_sub_ps(fV, o.fV); }
+    GFloat4 operator*(GFloat4 o) const { return _mm_mul_ps(fV, o.fV); }
+#else
+    float fV[4];
+
+    GFloat4(float x) : fV{x, x, x, x} {}
+    GFloat4(float r, float g, float b, float a) : fV{r, g, b, a} {}
+
+    static GFloat4 Load(const float p[]) { return {p[0], p[1], p[2], p[3]}; }
+    void store(float p[]) const { memcpy(p, fV, sizeof(fV)); }
+
+    GFloat4 alpha() const { return fV[3]; }
+
+    GFloat4 operator+(GFloat4 o) const {
+        return {fV[0] + o.fV[0], fV[1] + o.fV[1], fV[2] + o.fV[2], fV[3] + o.fV[3]};
+    }
+    GFloat4 operator-(GFloat4 o) const {
+        return {fV[0] - o.fV[0], fV[1] - o.fV[1], fV[2] - o.fV[2], fV[3] - o.fV[3]};
+    }
+    GFloat4 operator*(GFloat4 o) const {
+        return {fV[0] * o.fV[0], fV[1] * o.fV[1], fV[2] * o.fV[2], fV[3] * o.fV[3]};
+    }
+#endif
+};
+
+/**
+ *  Each GBlendMode for float (0...1) premultiplied pixels. For the Porter-Duff modes, all four
+ *  channels, including alpha, use the same formula. The advanced modes blend each color lane
+ *  with GBlendAdvanced.
+ */
+template <GBlendMode Mode> GFloat4 GBlendFloat4(GFloat4 s, GFloat4 d) {
+    const GFloat4 one(1.0f);
+    if (GBlendModeIsAdvanced(Mode)) {
+        float sv[4], dv[4];
+        s.store(sv);
+        d.store(dv);
+        const float sa = sv[3], da = dv[3];
+        return { GBlendAdvanced<Mode>(sv[0], dv[0], sa, da),
+                 GBlendAdvanced<Mode>(sv[1], dv[1], sa, da),
+                 GBlendAdvanced<Mode>(sv[2], dv[2], sa, da),
+                 sa + da - sa * da };
+    }
+    switch (Mode) {
+        case GBlendMode::kClear:    return 0.0f;
+        case GBlendMode::kSrc:      return s;
+        case GBlendMode::kDst:      return d;
+        case GBlendMode::kSrcOver:  return s + (one - s.alpha()) * d;
+        case GBlendMode::kDstOver:  return d + (one - d.alpha()) * s;
+        case GBlendMode::kSrcIn:    return d.alpha() * s;
+        case GBlendMode::kDstIn:    return s.alpha() * d;
+        case GBlendMode::kSrcOut:   return (one - d.alpha()) * s;
+        case GBlendMode::kDstOut:   return (one - s.alpha()) * d;
+        case GBlendMode::kSrcATop:  return d.alpha() * s + (one - s.alpha()) * d;
+        case GBlendMode::kDstATop:  return s.alpha() * d + (one - d.alpha()) * s;
+        case GBlendMode::kXor:      return (one - s.alpha()) * d + (one - d.alpha()) * s;
+        default: break;
+    }
+    return 0.0f;
+}
+
+/**
+ *  Calls proc with a std::integral_constant for the runtime value of mode, e.g.
+ *
+ *      GVisitBlendMode(mode, [&](auto m) {
+ *          constexpr GBlendMode Mode = decltype(m)::value;
+ *          ...
+ *      });
+ *
+ *  This lets blitters write each loop once and still get a loop specialized for each mode.
+ */
+template <GBlendMode Mode> using GBlendModeTag = std::integral_constant<GBlendMode, Mode>;
+
+template <typename Proc> void GVisitBlendMode(GBlendMode mode, Proc&& proc) {
+    switch (mode) {
+        case GBlendMode::kClear:    proc(GBlendModeTag<GBlendMode::kClear>()); break;
+        case GBlendMode::kSrc:      proc(GBlendModeTag<GBlendMode::kSrc>()); break;
+        case GBlendMode::kDst:      proc(GBlendModeTag<GBlendMode::kDst>()); break;
+        case GBlendMode::kSrcOver:  proc(GBlendModeTag<GBlendMode::kSrcOver>()); break;
+        case GBlendMode::kDstOver:  proc(GBlendModeTag<GBlendMode::kDstOver>()); break;
+        case GBlendMode::kSrcIn:    proc(GBlendModeTag<GBlendMode::kSrcIn>()); break;
+        case GBlendMode::kDstIn:    proc(GBlendModeTag<GBlendMode::kDstIn>()); break;
+        case GBlendMode::kSrcOut:   proc(GBlendModeTag<GBlendMode::kSrcOut>()); break;
+        case GBlendMode::kDstOut:   proc(GBlendModeTag<GBlendMode::kDstOut>()); break;
+        case GBlendMode::kSrcATop:  proc(GBlendModeTag<GBlendMode::kSrcATop>()); break;
+        case GBlendMode::kDstATop:  proc(GBlendModeTag<GBlendMode::kDstATop>()); break;
+        case GBlendMode::kXor:      proc(GBlendModeTag<GBlendMode::kXor>()); break;
+        case GBlendMode::kMultiply:   proc(GBlendModeTag<GBlendMode::kMultiply>()); break;
+        case GBlendMode::kScreen:     proc(GBlendModeTag<GBlendMode::kScreen>()); break;
+        case GBlendMode::kOverlay:    proc(GBlendModeTag<GBlendMode::kOverlay>()); break;
+        case GBlendMode::kDarken:     proc(GBlendModeTag<GBlendMode::kDarken>()); break;
+        case GBlendMode::kLighten:    proc(GBlendModeTag<GBlendMode::kLighten>()); break;
+        case GBlendMode::kColorDodge: proc(GBlendModeTag<GBlendMode::kColorDodge>()); break;
+        case GBlendMode::kColorBurn:  proc(GBlendModeTag<GBlendMode::kColorBurn>()); break;
+        case GBlendMode::kHardLight:  proc(GBlendModeTag<GBlendMode::kHardLight>()); break;
+        case GBlendMode::kSoftLight:  proc(GBlendModeTag<GBlendMode::kSoftLight>()); break;
+        case GBlendMode::kDifference: proc(GBlendModeTag<GBlendMode::kDifference>()); break;
+        case GBlendMode::kExclusion:  proc(GBlendModeTag<GBlendMode::kExclusion>()); break;
+    }
+}
+
+#endif
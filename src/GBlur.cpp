@@ -0,0 +1,199 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GBlur.h"
+#include "../include/GMath.h"
+#include "GParallel.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/**
+ *  Sum4 holds running sums of the 4 channels of a run of pixels, in 32-bit lanes (in the same
+ *  order as the bytes of a GPixel, so averaging simply packs them back).
+ */
+#if defined(__SSE2__)
+
+using Sum4 = __m128i;
+
+static inline Sum4 zero_sum() { return _mm_setzero_si128(); }
+
+static inline Sum4 expand(GPixel p) {
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p), zero), zero);
+}
+
+static inline Sum4 add(Sum4 a, Sum4 b) { return _mm_add_epi32(a, b); }
+static inline Sum4 sub(Sum4 a, Sum4 b) { return _mm_sub_epi32(a, b); }
+
+// Rounds sum * scale for each channel. Since each color's sum is no larger than its alpha's,
+// the result is still a valid premultiplied pixel.
+static inline GPixel average(Sum4 sum, float scale) {
+    __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(scale));
+    __m128i i = _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+    i = _mm_packs_epi32(i, i);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+}
+
+#else
+
+struct Sum4 {
+    int32_t fV[4];
+};
+
+static inline Sum4 zero_sum() { return {{0, 0, 0, 0}}; }
+
+static inline Sum4 expand(GPixel p) {
+    return {{ (int32_t)(p & 0xFF), (int32_t)((p >> 8) & 0xFF), (int32_t)((p >> 16) & 0xFF),
+              (int32_t)(p >> 24) }};
+}
+
+static inline Sum4 add(Sum4 a, Sum4 b) {
+    return {{ a.fV[0] + b.fV[0], a.fV[1] + b.fV[1], a.fV[2] + b.fV[2], a.fV[3] + b.fV[3] }};
+}
+static inline Sum4 sub(Sum4 a, Sum4 b) {
+    return {{ a.fV[0] - b.fV[0], a.fV[1] - b.fV[1], a.fV[2] - b.fV[2], a.fV[3] - b.fV[3] }};
+}
+
+static inline GPixel average(Sum4 sum, float scale) {
+    GPixel p = 0;
+    for (int i = 0; i < 4; ++i) {
+        p |= (GPixel)(sum.fV[i] * scale + 0.5f) << (i * 8);
+    }
+    return p;
+}
+
+#endif
+
+/**
+ *  One box blur of a row: each step adds the pixel entering the window and subtracts the one
+ *  leaving it.
+ */
+static void box_pass(const GPixel src[], GPixel dst[], int count, int r) {
+    const float scale = 1.0f / (2 * r + 1);
+    Sum4 sum = zero_sum();
+    for (int i = 0; i <= r && i < count; ++i) {
+        sum = add(sum, expand(src[i]));
+    }
+    for (int x = 0; x < count; ++x) {
+        dst[x] = average(sum, scale);
+        if (x + r + 1 < count) {
+            sum = add(sum, expand(src[x + r + 1]));
+        }
+        if (x - r >= 0) {
+            sum = sub(sum, expand(src[x - r]));
+        }
+    }
+}
+
+/**
+ *  The vertical passes work on strips of this many columns. Each strip is copied into a
+ *  buffer, so that the passes stride through a small, contiguous block instead of whole rows,
+ *  and the pixels in each of its rows are blurred side by side.
+ */
+enum { kStripWidth = 16 };
+
+static void box_pass_strip(const GPixel src[], GPixel dst[], int width, int height, int r) {
+    const float scale = 1.0f / (2 * r + 1);
+    Sum4 sums[kStripWidth];
+    for (int i = 0; i < width; ++i) {
+        sums[i] = zero_sum();
+    }
+    for (int y = 0; y <= r && y < height; ++y) {
+        for (int i = 0; i < width; ++i) {
+            sums[i] = add(sums[i], expand(src[y * kStripWidth + i]));
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        GPixel* row = dst + y * kStripWidth;
+        for (int i = 0; i < width; ++i) {
+            row[i] = average(sums[i], scale);
+        }
+        if (y + r + 1 < height) {
+            const GPixel* in = src + (y + r + 1) * kStripWidth;
+            for (int i = 0; i < width; ++i) {
+                sums[i] = add(sums[i], expand(in[i]));
+            }
+        }
+        if (y - r >= 0) {
+            const GPixel* out = src + (y - r) * kStripWidth;
+            for (int i = 0; i < width; ++i) {
+                sums[i] = sub(sums[i], expand(out[i]));
+            }
+        }
+    }
+}
+
+// Rows are handed to threads in groups of this many
+enum { kRowsPerTask = 16 };
+
+static bool blur(const GBitmap& src, const GBitmap& dst, const int radii[], int count) {
+    const int w = src.width(), h = src.height();
+    if (w != dst.width() || h != dst.height()) {
+        return false;
+    }
+    if (w == 0 || h == 0) {
+        return true;
+    }
+
+    // Horizontal: each row is read into a buffer, blurred back and forth, and written out,
+    // which also makes it safe for src and dst to be the same
+    GParallelFor((h + kRowsPerTask - 1) / kRowsPerTask, [&](int task) {
+        std::vector<GPixel> a(w), b(w);
+        const int y1 = std::min(h, (task + 1) * kRowsPerTask);
+        for (int y = task * kRowsPerTask; y < y1; ++y) {
+            memcpy(a.data(), src.getAddr(0, y), w * sizeof(GPixel));
+            for (int i = 0; i < count; ++i) {
+                box_pass(a.data(), b.data(), w, radii[i]);
+                std::swap(a, b);
+            }
+            memcpy(dst.getAddr(0, y), a.data(), w * sizeof(GPixel));
+        }
+    });
+
+    // Vertical: the same, in place, for each strip of columns
+    GParallelFor((w + kStripWidth - 1) / kStripWidth, [&](int task) {
+        const int x = task * kStripWidth;
+        const int n = std::min<int>(kStripWidth, w - x);
+        std::vector<GPixel> a(kStripWidth * h), b(kStripWidth * h);
+        for (int y = 0; y < h; ++y) {
+            memcpy(&a[y * kStripWidth], dst.getAddr(x, y), n * sizeof(GPixel));
+        }
+        for (int i = 0; i < count; ++i) {
+            box_pass_strip(a.data(), b.data(), n, h, radii[i]);
+            std::swap(a, b);
+        }
+        for (int y = 0; y < h; ++y) {
+            memcpy(dst.getAddr(x, y), &a[y * kStripWidth], n * sizeof(GPixel));
+        }
+    });
+    return true;
+}
+
+bool GBoxBlur(const GBitmap& src, const GBitmap& dst, int radius) {
+    const int radii[] = { std::max(radius, 0) };
+    return blur(src, dst, radii, 1);
+}
+
+bool GGaussianBlur(const GBitmap& src, const GBitmap& dst, float sigma) {
+    // Choose 3 (odd) box widths whose combined variance best matches sigma^2: m boxes of width
+    // wl and the rest of width wl + 2. See Kovesi, "Fast Almost-Gaussian Filtering".
+    const int n = 3;
+    const float s2 = std::max(sigma, 0.0f) * std::max(sigma, 0.0f);
+    int wl = (int)floorf(sqrtf(12 * s2 / n + 1));
+    if (wl % 2 == 0) {
+        wl -= 1;
+    }
+    const int m = GRoundToInt((12 * s2 - n * wl * wl - 4 * n * wl - 3 * n) / (-4 * wl - 4));
+
+    int radii[n];
+    for (int i = 0; i < n; ++i) {
+        const int width = i < m ? wl : wl + 2;
+        radii[i] = (width - 1) / 2;
+    }
+    return blur(src, dst, radii, n);
+}
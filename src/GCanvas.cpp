@@ -0,0 +1,170 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GCanvas.h"
+#include "../include/GColorFilter.h"
+#include "../include/GPathBuilder.h"
+#include "../include/GRect.h"
+#include "../include/GShader.h"
+
+/**
+ *  Default implementations of the (non-pure) virtuals, written in terms of the required ones,
+ *  so that every canvas supports them. Subclasses override these for faster, specialized paths.
+ */
+
+void GCanvas::saveLayer(const GRect*, const GPaint&, float) {
+    this->save();
+}
+
+void GCanvas::drawMask(const GAlphaBitmap& mask, float x, float y, const GPaint& paint) {
+    const GMatrix local = GMatrix::Translate(x, y);
+    auto shader = paint.peekShader() ? GCreateMaskShader(paint.shareShader(), mask, local)
+                                     : GCreateAlphaShader(mask, paint.getColor(), local);
+    if (!shader) {
+        return;
+    }
+    GPaint p(paint);
+    p.setShader(std::move(shader));
+    this->drawRect(GRect::XYWH(x, y, mask.width(), mask.height()), p);
+}
+
+void GCanvas::drawLines(const GPoint pts[], int count, const GPaint& paint) {
+    const float radius = std::max(paint.getStrokeWidth(), 1.0f) * 0.5f;
+    for (int i = 0; i + 1 < count; i += 2) {
+        const GPoint a = pts[i], b = pts[i + 1];
+        const GPoint v = b - a;
+        const float length = v.length();
+        if (length == 0) {
+            continue;
+        }
+        const GPoint n = { -v.y * radius / length, v.x * radius / length };
+        const GPoint quad[] = { a + n, b + n, b - n, a - n };
+        this->drawConvexPolygon(quad, 4, paint);
+    }
+}
+
+void GCanvas::drawRRect(const GRect& rect, float rx, float ry, const GPaint& paint) {
+    rx = std::min(std::max(rx, 0.0f), rect.width() * 0.5f);
+    ry = std::min(std::max(ry, 0.0f), rect.height() * 0.5f);
+    if (rx == 0 || ry == 0) {
+        this->drawRect(rect, paint);
+        return;
+    }
+    // each corner is a cubic, whose control points are k * radius from its ends
+    const float k = 0.5522848f;
+    const float L = rect.left, T = rect.top, R = rect.right, B = rect.bottom;
+    const float kx = k * rx, ky = k * ry;
+    GPathBuilder bu;
+    bu.moveTo(L + rx, T);
+    bu.lineTo(R - rx, T);
+    bu.cubicTo(R - rx + kx, T, R, T + ry - ky, R, T + ry);
+    bu.lineTo(R, B - ry);
+    bu.cubicTo(R, B - ry + ky, R - rx + kx, B, R - rx, B);
+    bu.lineTo(L + rx, B);
+    bu.cubicTo(L + rx - kx, B, L, B - ry + ky, L, B - ry);
+    bu.lineTo(L, T + ry);
+    bu.cubicTo(L, T + ry - ky, L + rx - kx, T, L + rx, T);
+    this->drawPath(*bu.detach(), paint);
+}
+
+/**
+ *  Returns a shader for the src rect of the bitmap, scaled to fill dst, and multiplied by color
+ *  (unpremultiplied), or null if there is nothing to draw.
+ */
+static std::shared_ptr<GShader> bitmap_rect_shader(const GBitmap& bitmap, const GIRect& src,
+                                                   const GRect& dst, const GColor& color) {
+    const GIRect r = GIRect::LTRB(std::max(src.left, 0), std::max(src.top, 0),
+                                  std::min(src.right, bitmap.width()),
+                                  std::min(src.bottom, bitmap.height()));
+    if (r.isEmpty() || dst.isEmpty() || !bitmap.pixels()) {
+        return nullptr;
+    }
+    // src's pixels, as a bitmap of their own, so that the shader never samples outside of them
+    const GBitmap subset(r.width(), r.height(), bitmap.rowBytes(), bitmap.getAddr(r.left, r.top),
+                         bitmap.isOpaque());
+    const GMatrix local = GMatrix::Translate(dst.left, dst.top) *
+                          GMatrix::Scale(dst.width() / r.width(), dst.height() / r.height());
+    auto shader = GCreateBitmapShader(subset, local);
+    const GColor c = color.pinToUnit();
+    if (shader && (c.r < 1 || c.g < 1 || c.b < 1 || c.a < 1)) {
+        const float scale[20] = {
+            c.r, 0,   0,   0,   0,
+            0,   c.g, 0,   0,   0,
+            0,   0,   c.b, 0,   0,
+            0,   0,   0,   c.a, 0,
+        };
+        shader = GCreateColorFilterShader(std::move(shader), GCreateColorMatrixFilter(scale));
+    }
+    return shader;
+}
+
+void GCanvas::drawBitmapRect(const GBitmap& bitmap, const GIRect& src, const GRect& dst,
+                             const GPaint& paint) {
+    if (auto shader = bitmap_rect_shader(bitmap, src, dst, {1, 1, 1, paint.getAlpha()})) {
+        GPaint p(paint);
+        p.setShader(std::move(shader));
+        this->drawRect(dst, p);
+    }
+}
+
+void GCanvas::drawAtlas(const GBitmap& atlas, const GIRect src[], const GMatrix xforms[],
+                        const GColor colors[], int count, const GPaint& paint) {
+    for (int i = 0; i < count; ++i) {
+        GColor c = colors ? colors[i] : GColor{1, 1, 1, 1};
+        c.a *= paint.getAlpha();
+        const GRect dst = GRect::WH(src[i].width(), src[i].height());
+        if (auto shader = bitmap_rect_shader(atlas, src[i], dst, c)) {
+            GPaint p(paint);
+            p.setShader(std::move(shader));
+            this->save();
+            this->concat(xforms[i]);
+            this->drawRect(dst, p);
+            this->restore();
+        }
+    }
+}
+
+bool GCanvas::ComputeNineGrid(const GBitmap& bitmap, const GIRect& center, const GRect& dst,
+                              int srcX[4], int srcY[4], float dstX[4], float dstY[4]) {
+    const int w = bitmap.width(), h = bitmap.height();
+    const GIRect c = GIRect::LTRB(std::max(center.left, 0), std::max(center.top, 0),
+                                  std::min(center.right, w), std::min(center.bottom, h));
+    if (c.isEmpty() || dst.isEmpty() || !bitmap.pixels()) {
+        return false;
+    }
+    // the corners keep their size, unless dst is too small for them (then they share it)
+    auto edges = [](int size, int lo, int hi, float dstLo, float dstHi, int src[], float d[]) {
+        src[0] = 0;
+        src[1] = lo;
+        src[2] = hi;
+        src[3] = size;
+        const float fixed = (float)(lo + size - hi), available = dstHi - dstLo;
+        const float scale = fixed > available ? available / fixed : 1;
+        d[0] = dstLo;
+        d[1] = dstLo + lo * scale;
+        d[2] = dstHi - (size - hi) * scale;
+        d[3] = dstHi;
+    };
+    edges(w, c.left, c.right, dst.left, dst.right, srcX, dstX);
+    edges(h, c.top, c.bottom, dst.top, dst.bottom, srcY, dstY);
+    return true;
+}
+
+void GCanvas::drawBitmapNine(const GBitmap& bitmap, const GIRect& center, const GRect& dst,
+                             const GPaint& paint) {
+    int srcX[4], srcY[4];
+    float dstX[4], dstY[4];
+    if (!ComputeNineGrid(bitmap, center, dst, srcX, srcY, dstX, dstY)) {
+        return;
+    }
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 3; ++i) {
+            const GIRect src = GIRect::LTRB(srcX[i], srcY[j], srcX[i + 1], srcY[j + 1]);
+            const GRect rect = GRect::LTRB(dstX[i], dstY[j], dstX[i + 1], dstY[j + 1]);
+            if (!src.isEmpty() && !rect.isEmpty()) {
+                this->drawBitmapRect(bitmap, src, rect, paint);
+            }
+        }
+    }
+}
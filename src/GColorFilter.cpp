@@ -0,0 +1,191 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GColorFilter.h"
+#include "../include/GMath.h"
+#include "../include/GShader.h"
+#include "GBlend.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace {
+
+// 1/a for each alpha (and 0 for a == 0, whose premultiplied colors are all 0)
+struct InverseTable {
+    float fInv[256];
+
+    InverseTable() {
+        fInv[0] = 0;
+        for (int a = 1; a < 256; ++a) {
+            fInv[a] = 1.0f / a;
+        }
+    }
+};
+static const InverseTable gInverse;
+
+class MatrixFilter : public GColorFilter {
+public:
+    MatrixFilter(const float m[20]) {
+        memcpy(fM, m, sizeof(fM));
+        fPreservesAlpha = m[15] == 0 && m[16] == 0 && m[17] == 0 && m[18] == 1 && m[19] == 0;
+    }
+
+    bool preservesAlpha() const override { return fPreservesAlpha; }
+
+    void filterRow(GPixel row[], int count) const override {
+#if defined(__SSE2__)
+        // Work in GPixel's byte order (b, g, r, a), so each column of the matrix is permuted
+        auto column = [this](int c) {
+            return _mm_setr_ps(fM[10 + c], fM[5 + c], fM[0 + c], fM[15 + c]);
+        };
+        const __m128 mr = column(0), mg = column(1), mb = column(2), ma = column(3),
+                     mt = column(4);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1), k255 = _mm_set1_ps(255);
+        const __m128i zeroi = _mm_setzero_si128();
+
+        for (int i = 0; i < count; ++i) {
+            const GPixel p = row[i];
+            const unsigned a = p >> GPIXEL_SHIFT_A;
+            __m128 v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+                    _mm_unpacklo_epi8(_mm_cvtsi32_si128(p), zeroi), zeroi));
+            // unpremul: colors / a, and alpha / 255
+            const float inv = gInverse.fInv[a];
+            v = _mm_mul_ps(v, _mm_setr_ps(inv, inv, inv, 1 / 255.0f));
+
+            __m128 c = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(mb, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0))),
+                               _mm_mul_ps(mg, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)))),
+                    _mm_add_ps(_mm_mul_ps(mr, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))),
+                               _mm_add_ps(_mm_mul_ps(ma, _mm_shuffle_ps(v, v,
+                                                                        _MM_SHUFFLE(3, 3, 3, 3))),
+                                          mt)));
+            c = _mm_min_ps(_mm_max_ps(c, zero), one);
+
+            // premul by the new alpha (leaving alpha itself alone), and scale to 0...255
+            __m128 ca = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+            ca = _mm_or_ps(_mm_and_ps(ca, alphaMaskNot()), _mm_and_ps(one, alphaMask()));
+            __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, ca), k255),
+                                                    _mm_set1_ps(0.5f)));
+            r = _mm_packs_epi32(r, r);
+            row[i] = _mm_cvtsi128_si32(_mm_packus_epi16(r, r));
+        }
+#else
+        for (int i = 0; i < count; ++i) {
+            const GPixel p = row[i];
+            const float inv = gInverse.fInv[GPixel_GetA(p)];
+            const GColor c = {GPixel_GetR(p) * inv, GPixel_GetG(p) * inv, GPixel_GetB(p) * inv,
+                              GPixel_GetA(p) * (1 / 255.0f)};
+            row[i] = GColorToPixel(this->filterColor(c));
+        }
+#endif
+    }
+
+    GColor filterColor(const GColor& c) const override {
+        auto row = [&](const float m[]) {
+            return m[0] * c.r + m[1] * c.g + m[2] * c.b + m[3] * c.a + m[4];
+        };
+        return GColor{ row(fM + 0), row(fM + 5), row(fM + 10), row(fM + 15) }.pinToUnit();
+    }
+
+private:
+    float fM[20];
+    bool  fPreservesAlpha;
+
+#if defined(__SSE2__)
+    static __m128 alphaMask() { return _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1)); }
+    static __m128 alphaMaskNot() { return _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)); }
+#endif
+};
+
+class TableFilter : public GColorFilter {
+public:
+    TableFilter(const uint8_t r[], const uint8_t g[], const uint8_t b[], const uint8_t a[]) {
+        auto init = [](uint8_t dst[], const uint8_t src[]) {
+            for (int i = 0; i < 256; ++i) {
+                dst[i] = src ? src[i] : i;
+            }
+        };
+        init(fR, r);
+        init(fG, g);
+        init(fB, b);
+        init(fA, a);
+        fPreservesAlpha = a == nullptr;
+    }
+
+    bool preservesAlpha() const override { return fPreservesAlpha; }
+
+    void filterRow(GPixel row[], int count) const override {
+        for (int i = 0; i < count; ++i) {
+            const GPixel p = row[i];
+            const unsigned a = GPixel_GetA(p);
+            if (a == 0xFF && fPreservesAlpha) {
+                // opaque: no need to unpremul or premul
+                row[i] = GPixel_PackARGB(0xFF, fR[GPixel_GetR(p)], fG[GPixel_GetG(p)],
+                                         fB[GPixel_GetB(p)]);
+                continue;
+            }
+            auto unpremul = [a](unsigned c) { return a ? (c * 255 + a / 2) / a : 0; };
+            const unsigned na = fA[a];
+            row[i] = GPixel_PackARGB(na, GMul255(fR[unpremul(GPixel_GetR(p))], na),
+                                     GMul255(fG[unpremul(GPixel_GetG(p))], na),
+                                     GMul255(fB[unpremul(GPixel_GetB(p))], na));
+        }
+    }
+
+    GColor filterColor(const GColor& color) const override {
+        const GColor c = color.pinToUnit();
+        auto lookup = [](const uint8_t table[], float x) {
+            return table[GRoundToInt(x * 255)] * (1 / 255.0f);
+        };
+        return { lookup(fR, c.r), lookup(fG, c.g), lookup(fB, c.b), lookup(fA, c.a) };
+    }
+
+private:
+    uint8_t fR[256], fG[256], fB[256], fA[256];
+    bool    fPreservesAlpha;
+};
+
+class ColorFilterShader : public GShader {
+public:
+    ColorFilterShader(std::shared_ptr<GShader> shader, std::shared_ptr<GColorFilter> filter)
+        : fShader(std::move(shader)), fFilter(std::move(filter))
+    {}
+
+    bool isOpaque() override { return fShader->isOpaque() && fFilter->preservesAlpha(); }
+    bool setContext(const GMatrix& ctm) override { return fShader->setContext(ctm); }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        fShader->shadeRow(x, y, count, row);
+        fFilter->filterRow(row, count);
+    }
+
+private:
+    std::shared_ptr<GShader>      fShader;
+    std::shared_ptr<GColorFilter> fFilter;
+};
+
+} // namespace
+
+std::shared_ptr<GColorFilter> GCreateColorMatrixFilter(const float matrix[20]) {
+    return std::make_shared<MatrixFilter>(matrix);
+}
+
+std::shared_ptr<GColorFilter> GCreateTableColorFilter(const uint8_t tableR[256],
+                                                      const uint8_t tableG[256],
+                                                      const uint8_t tableB[256],
+                                                      const uint8_t tableA[256]) {
+    return std::make_shared<TableFilter>(tableR, tableG, tableB, tableA);
+}
+
+std::shared_ptr<GShader> GCreateColorFilterShader(std::shared_ptr<GShader> shader,
+                                                  std::shared_ptr<GColorFilter> filter) {
+    if (!shader || !filter) {
+        return shader;
+    }
+    return std::make_shared<ColorFilterShader>(std::move(shader), std::move(filter));
+}
@@ -0,0 +1,544 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GDeflate.h"
+
+#include <algorithm>
+#include <queue>
+
+struct DeflateConfig {
+    int  fMaxChain;     // how many earlier positions to try when looking for a match
+    int  fNiceLength;   // stop searching once we find a match this long
+    bool fLazy;         // defer a match by one byte, in case the next position has a longer one
+};
+
+static const DeflateConfig gConfigs[] = {
+    {    0,   0, false },   // 0 : stored
+    {    4,   8, false },   // 1 : fastest
+    {    8,  16, false },
+    {   32,  32, false },
+    {   16,  32,  true },
+    {   32,  64,  true },
+    {  128, 128,  true },   // 6 : default
+    {  256, 258,  true },
+    { 1024, 258,  true },
+    { 4096, 258,  true },   // 9 : smallest
+};
+
+static const uint16_t gLengthBase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t gLengthExtra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t gDistBase[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t gDistExtra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+// The order in which the code-length code lengths are transmitted
+static const uint8_t gCodeLengthOrder[] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+constexpr int kNumLitLen = 286;
+constexpr int kNumDist = 30;
+constexpr int kNumCodeLength = 19;
+constexpr int kEndOfBlock = 256;
+constexpr int kMaxStoredBlock = 65535;
+constexpr int kWindowMask = GDeflater::kWindowSize - 1;
+// Keep this much input buffered (when not flushing) so a match can always run to kMaxMatch
+constexpr int kMinLookahead = GDeflater::kMaxMatch + GDeflater::kMinMatch + 1;
+
+static int length_code(int length) {
+    return (int)(std::upper_bound(gLengthBase, gLengthBase + GARRAY_COUNT(gLengthBase), length)
+                 - gLengthBase) - 1;
+}
+
+static int dist_code(int distance) {
+    return (int)(std::upper_bound(gDistBase, gDistBase + GARRAY_COUNT(gDistBase), distance)
+                 - gDistBase) - 1;
+}
+
+/**
+ *  Compute huffman code lengths for the given frequencies, none longer than maxBits. If the tree
+ *  is too deep, the frequencies are flattened (halved) and we try again.
+ */
+static void build_lengths(const uint32_t freqs[], int n, int maxBits, uint8_t lengths[]) {
+    std::vector<uint32_t> f(freqs, freqs + n);
+
+    // A decoder needs a complete code, so make sure there are at least two symbols
+    int used = (int)std::count_if(f.begin(), f.end(), [](uint32_t x) { return x != 0; });
+    for (int i = 0; used < 2 && i < n; ++i) {
+        if (!f[i]) {
+            f[i] = 1;
+            used += 1;
+        }
+    }
+
+    struct Node {
+        int fLeft, fRight;  // children, or -1 for a leaf
+        int fSymbol;
+    };
+    using Entry = std::pair<uint32_t, int>;    // frequency, node-index
+
+    for (;;) {
+        std::vector<Node> nodes;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        for (int i = 0; i < n; ++i) {
+            if (f[i]) {
+                queue.push({f[i], (int)nodes.size()});
+                nodes.push_back({-1, -1, i});
+            }
+        }
+        while (queue.size() > 1) {
+            Entry a = queue.top(); queue.pop();
+            Entry b = queue.top(); queue.pop();
+            queue.push({a.first + b.first, (int)nodes.size()});
+            nodes.push_back({a.second, b.second, -1});
+        }
+
+        // parents always follow their children, so walk backwards from the root
+        std::vector<int> depth(nodes.size(), 0);
+        int maxDepth = 0;
+        for (int i = (int)nodes.size() - 1; i >= 0; --i) {
+            if (nodes[i].fLeft >= 0) {
+                depth[nodes[i].fLeft]  = depth[i] + 1;
+                depth[nodes[i].fRight] = depth[i] + 1;
+            } else {
+                maxDepth = std::max(maxDepth, depth[i]);
+            }
+        }
+
+        if (maxDepth <= maxBits) {
+            memset(lengths, 0, n);
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i].fLeft < 0) {
+                    lengths[nodes[i].fSymbol] = depth[i];
+                }
+            }
+            return;
+        }
+        for (auto& x : f) {
+            if (x) {
+                x = (x >> 1) | 1;
+            }
+        }
+    }
+}
+
+/**
+ *  Assign canonical codes from the lengths. Deflate sends huffman codes most-significant-bit
+ *  first, but our bit-writer is least-significant-bit first, so the codes are stored reversed.
+ */
+static void build_codes(const uint8_t lengths[], int n, uint16_t codes[]) {
+    int count[16] = {};
+    for (int i = 0; i < n; ++i) {
+        count[lengths[i]] += 1;
+    }
+    count[0] = 0;
+
+    int next[16];
+    int code = 0;
+    for (int bits = 1; bits < 16; ++bits) {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (int i = 0; i < n; ++i) {
+        const int len = lengths[i];
+        if (len) {
+            int c = next[len]++;
+            int reversed = 0;
+            for (int b = 0; b < len; ++b) {
+                reversed = (reversed << 1) | (c & 1);
+                c >>= 1;
+            }
+            codes[i] = reversed;
+        }
+    }
+}
+
+static uint32_t update_adler32(uint32_t adler, const uint8_t data[], size_t length) {
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+    while (length > 0) {
+        // 5552 is the largest n such that the sums can't overflow 32 bits before the modulo
+        size_t n = std::min(length, (size_t)5552);
+        length -= n;
+        while (n--) {
+            s1 += *data++;
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+GDeflater::GDeflater(int level, Sink sink) : fSink(std::move(sink)), fLevel(level) {
+    assert(level >= 0 && level <= 9);
+    fMaxChain = gConfigs[level].fMaxChain;
+    fNiceLength = gConfigs[level].fNiceLength;
+    fLazy = gConfigs[level].fLazy;
+
+    if (fLevel == 0) {
+        fWindow.resize(kMaxStoredBlock);
+    } else {
+        fWindow.resize(2 * kWindowSize);
+        fHead.resize(1 << kHashBits, -1);
+        fPrev.resize(kWindowSize, -1);
+        fSymbols.reserve(kMaxBlockSymbols);
+    }
+
+    // zlib header: deflate with a 32K window, and a hint of the compression level
+    const int flevel = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+    int flg = flevel << 6;
+    const int check = ((0x78 << 8) | flg) % 31;
+    if (check) {
+        flg += 31 - check;
+    }
+    fOut.push_back(0x78);
+    fOut.push_back(flg);
+}
+
+void GDeflater::putBits(uint32_t bits, int count) {
+    assert(count <= 32);
+    fBitBuffer |= (uint64_t)bits << fBitCount;
+    fBitCount += count;
+    while (fBitCount >= 8) {
+        fOut.push_back(fBitBuffer & 0xFF);
+        fBitBuffer >>= 8;
+        fBitCount -= 8;
+    }
+}
+
+void GDeflater::alignToByte() {
+    if (fBitCount > 0) {
+        this->putBits(0, 8 - fBitCount);
+    }
+}
+
+bool GDeflater::flushOutput() {
+    if (!fOut.empty()) {
+        fOK = fOK && fSink(fOut.data(), fOut.size());
+        fOut.clear();
+    }
+    return fOK;
+}
+
+bool GDeflater::write(const uint8_t data[], size_t length) {
+    fAdler = update_adler32(fAdler, data, length);
+
+    if (fLevel == 0) {
+        while (length > 0) {
+            size_t n = std::min(length, (size_t)(kMaxStoredBlock - fLookahead));
+            memcpy(&fWindow[fLookahead], data, n);
+            fLookahead += n;
+            data += n;
+            length -= n;
+            if (fLookahead == kMaxStoredBlock) {
+                this->emitStoredBlock(fWindow.data(), fLookahead, false);
+                fLookahead = 0;
+            }
+        }
+        return fOK;
+    }
+
+    while (length > 0) {
+        if (fStart + fLookahead == (int)fWindow.size()) {
+            this->slideWindow();
+        }
+        size_t n = std::min(length, fWindow.size() - (fStart + fLookahead));
+        memcpy(&fWindow[fStart + fLookahead], data, n);
+        fLookahead += n;
+        data += n;
+        length -= n;
+        this->compress(false);
+    }
+    return fOK;
+}
+
+bool GDeflater::finish() {
+    if (fLevel == 0) {
+        this->emitStoredBlock(fWindow.data(), fLookahead, true);
+        fLookahead = 0;
+    } else {
+        this->compress(true);
+        if (fLiteralPending) {
+            this->addLiteral(fStart - 1);
+            fLiteralPending = false;
+        }
+        this->emitBlock(true);
+    }
+
+    this->alignToByte();
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        fOut.push_back((fAdler >> shift) & 0xFF);
+    }
+    return this->flushOutput();
+}
+
+void GDeflater::slideWindow() {
+    // compress() always leaves fStart in the upper half once the buffer is full
+    assert(fStart > kWindowSize);
+    memmove(&fWindow[0], &fWindow[kWindowSize], kWindowSize);
+    fStart -= kWindowSize;
+
+    auto slide = [](int32_t& pos) {
+        pos = pos >= kWindowSize ? pos - kWindowSize : -1;
+    };
+    std::for_each(fHead.begin(), fHead.end(), slide);
+    std::for_each(fPrev.begin(), fPrev.end(), slide);
+}
+
+int GDeflater::insertString(int pos) {
+    const uint8_t* p = &fWindow[pos];
+    const uint32_t key = (p[0] << 16) | (p[1] << 8) | p[2];
+    const uint32_t hash = (key * 2654435761u) >> (32 - kHashBits);
+
+    const int head = fHead[hash];
+    fPrev[pos & kWindowMask] = head;
+    fHead[hash] = pos;
+    return head;
+}
+
+int GDeflater::longestMatch(int pos, int candidate, int* distance) const {
+    const int maxLength = std::min<int>(kMaxMatch, fLookahead);
+    if (maxLength < kMinMatch) {
+        return 0;
+    }
+    const int limit = std::max(0, pos - kWindowSize);
+    const uint8_t* scan = &fWindow[pos];
+
+    int best = kMinMatch - 1;
+    int chain = fMaxChain;
+    while (candidate >= limit && chain-- > 0) {
+        const uint8_t* match = &fWindow[candidate];
+        // check the byte that would make this match longer than our best first
+        if (match[best] == scan[best] && match[0] == scan[0] && match[1] == scan[1]) {
+            int len = 2;
+            while (len < maxLength && match[len] == scan[len]) {
+                ++len;
+            }
+            if (len > best) {
+                best = len;
+                *distance = pos - candidate;
+                if (len >= fNiceLength || len == maxLength) {
+                    break;
+                }
+            }
+        }
+        // positions only go backwards along a chain; anything else is a stale (overwritten) link
+        const int next = fPrev[candidate & kWindowMask];
+        if (next >= candidate) {
+            break;
+        }
+        candidate = next;
+    }
+    return best >= kMinMatch ? best : 0;
+}
+
+void GDeflater::addLiteral(int pos) {
+    fSymbols.push_back({ fWindow[pos], 0 });
+}
+
+void GDeflater::addMatch(int length, int distance) {
+    assert(length >= kMinMatch && length <= kMaxMatch);
+    assert(distance >= 1 && distance <= kWindowSize);
+    fSymbols.push_back({ (uint16_t)length, (uint16_t)distance });
+}
+
+void GDeflater::compress(bool flushing) {
+    const int minLookahead = flushing ? 1 : kMinLookahead;
+
+    while (fLookahead >= minLookahead) {
+        int candidate = -1;
+        if (fLookahead >= kMinMatch) {
+            candidate = this->insertString(fStart);
+        }
+        int length = 0;
+        int distance = 0;
+        const bool search = !fLazy || fPrevLength < fNiceLength;
+        if (candidate >= 0 && search) {
+            length = this->longestMatch(fStart, candidate, &distance);
+        }
+
+        if (!fLazy) {
+            if (length) {
+                this->addMatch(length, distance);
+                // only index the inside of short matches; long ones are rare and costly to walk
+                const bool insert = length <= fNiceLength;
+                const int end = fStart + length;
+                for (++fStart, --fLookahead; fStart < end; ++fStart, --fLookahead) {
+                    if (insert && fLookahead >= kMinMatch) {
+                        this->insertString(fStart);
+                    }
+                }
+            } else {
+                this->addLiteral(fStart);
+                fStart += 1;
+                fLookahead -= 1;
+            }
+        } else if (fPrevLength && length <= fPrevLength) {
+            // The match that started at the previous byte is at least as good, so take it.
+            // fStart itself is already indexed; index the rest of the match as we skip it.
+            this->addMatch(fPrevLength, fPrevDistance);
+            const int end = fStart - 1 + fPrevLength;
+            for (++fStart, --fLookahead; fStart < end; ++fStart, --fLookahead) {
+                if (fLookahead >= kMinMatch) {
+                    this->insertString(fStart);
+                }
+            }
+            fPrevLength = 0;
+            fLiteralPending = false;
+        } else {
+            if (fLiteralPending) {
+                this->addLiteral(fStart - 1);
+            }
+            fLiteralPending = true;
+            fPrevLength = length;
+            fPrevDistance = distance;
+            fStart += 1;
+            fLookahead -= 1;
+        }
+
+        if (fSymbols.size() >= kMaxBlockSymbols) {
+            this->emitBlock(false);
+        }
+    }
+}
+
+bool GDeflater::emitStoredBlock(const uint8_t data[], size_t length, bool final) {
+    assert(length <= kMaxStoredBlock);
+    this->putBits(final ? 1 : 0, 1);
+    this->putBits(0, 2);    // BTYPE == 00 (stored)
+    this->alignToByte();
+    this->putBits(length & 0xFFFF, 16);
+    this->putBits(~length & 0xFFFF, 16);
+    fOut.insert(fOut.end(), data, data + length);
+    return this->flushOutput();
+}
+
+bool GDeflater::emitBlock(bool final) {
+    uint32_t litFreq[kNumLitLen] = {};
+    uint32_t distFreq[kNumDist] = {};
+    for (const Symbol& s : fSymbols) {
+        if (s.fDist == 0) {
+            litFreq[s.fLitLen] += 1;
+        } else {
+            litFreq[257 + length_code(s.fLitLen)] += 1;
+            distFreq[dist_code(s.fDist)] += 1;
+        }
+    }
+    litFreq[kEndOfBlock] = 1;
+
+    uint8_t  litLengths[kNumLitLen], distLengths[kNumDist];
+    uint16_t litCodes[kNumLitLen], distCodes[kNumDist];
+    build_lengths(litFreq, kNumLitLen, 15, litLengths);
+    build_lengths(distFreq, kNumDist, 15, distLengths);
+    build_codes(litLengths, kNumLitLen, litCodes);
+    build_codes(distLengths, kNumDist, distCodes);
+
+    int numLit = kNumLitLen;
+    while (numLit > 257 && !litLengths[numLit - 1]) {
+        --numLit;
+    }
+    int numDist = kNumDist;
+    while (numDist > 1 && !distLengths[numDist - 1]) {
+        --numDist;
+    }
+
+    // Run-length encode the (concatenated) code lengths with the code-length alphabet
+    std::vector<uint8_t> lengths(litLengths, litLengths + numLit);
+    lengths.insert(lengths.end(), distLengths, distLengths + numDist);
+
+    struct Run {
+        uint8_t fSymbol, fExtraBits, fExtra;
+    };
+    std::vector<Run> runs;
+    uint32_t clFreq[kNumCodeLength] = {};
+    auto add_run = [&](int symbol, int extraBits, int extra) {
+        runs.push_back({(uint8_t)symbol, (uint8_t)extraBits, (uint8_t)extra});
+        clFreq[symbol] += 1;
+    };
+    for (size_t i = 0; i < lengths.size();) {
+        const int len = lengths[i];
+        int run = 1;
+        while (i + run < lengths.size() && lengths[i + run] == len) {
+            ++run;
+        }
+        i += run;
+        if (len == 0) {
+            while (run >= 11) {
+                const int n = std::min(run, 138);
+                add_run(18, 7, n - 11);
+                run -= n;
+            }
+            if (run >= 3) {
+                add_run(17, 3, run - 3);
+                run = 0;
+            }
+        } else {
+            add_run(len, 0, 0);
+            run -= 1;
+            while (run >= 3) {
+                const int n = std::min(run, 6);
+                add_run(16, 2, n - 3);
+                run -= n;
+            }
+        }
+        while (run-- > 0) {
+            add_run(len, 0, 0);
+        }
+    }
+
+    uint8_t  clLengths[kNumCodeLength];
+    uint16_t clCodes[kNumCodeLength];
+    build_lengths(clFreq, kNumCodeLength, 7, clLengths);
+    build_codes(clLengths, kNumCodeLength, clCodes);
+
+    int numCL = kNumCodeLength;
+    while (numCL > 4 && !clLengths[gCodeLengthOrder[numCL - 1]]) {
+        --numCL;
+    }
+
+    this->putBits(final ? 1 : 0, 1);
+    this->putBits(2, 2);    // BTYPE == 10 (dynamic huffman)
+    this->putBits(numLit - 257, 5);
+    this->putBits(numDist - 1, 5);
+    this->putBits(numCL - 4, 4);
+    for (int i = 0; i < numCL; ++i) {
+        this->putBits(clLengths[gCodeLengthOrder[i]], 3);
+    }
+    for (const Run& r : runs) {
+        this->putBits(clCodes[r.fSymbol], clLengths[r.fSymbol]);
+        if (r.fExtraBits) {
+            this->putBits(r.fExtra, r.fExtraBits);
+        }
+    }
+
+    for (const Symbol& s : fSymbols) {
+        if (s.fDist == 0) {
+            this->putBits(litCodes[s.fLitLen], litLengths[s.fLitLen]);
+        } else {
+            const int lc = length_code(s.fLitLen);
+            this->putBits(litCodes[257 + lc], litLengths[257 + lc]);
+            this->putBits(s.fLitLen - gLengthBase[lc], gLengthExtra[lc]);
+            const int dc = dist_code(s.fDist);
+            this->putBits(distCodes[dc], distLengths[dc]);
+            this->putBits(s.fDist - gDistBase[dc], gDistExtra[dc]);
+        }
+    }
+    this->putBits(litCodes[kEndOfBlock], litLengths[kEndOfBlock]);
+
+    fSymbols.clear();
+    return this->flushOutput();
+}
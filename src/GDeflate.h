@@ -0,0 +1,87 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GDeflate_DEFINED
+#define GDeflate_DEFINED
+
+#include "../include/GTypes.h"
+#include <functional>
+
+/**
+ *  Incremental zlib (RFC 1950/1951) compressor. Bytes are fed in with write(), and the
+ *  compressed stream is handed to the sink a block at a time, so memory use is bounded by the
+ *  32K window plus one block, regardless of the total amount of data.
+ *
+ *  level follows zlib's convention: 0 stores the data uncompressed, 1 is fastest, 9 is smallest.
+ */
+class GDeflater {
+public:
+    using Sink = std::function<bool(const uint8_t data[], size_t length)>;
+
+    GDeflater(int level, Sink);
+
+    bool write(const uint8_t data[], size_t length);
+
+    /**
+     *  Compress any remaining input, terminate the stream (including the adler32 checksum)
+     *  and hand it to the sink. No more calls to write() are allowed after this.
+     */
+    bool finish();
+
+    enum {
+        kWindowSize = 32768,
+        kMinMatch   = 3,
+        kMaxMatch   = 258,
+        kHashBits   = 15,
+        kMaxBlockSymbols = 16384,
+    };
+
+private:
+    struct Symbol {
+        uint16_t fLitLen;   // literal byte, or match-length
+        uint16_t fDist;     // 0 for a literal, else match-distance
+    };
+
+    void putBits(uint32_t bits, int count);
+    void alignToByte();
+    bool flushOutput();
+
+    void compress(bool flushing);
+    void slideWindow();
+    int  insertString(int pos);
+    int  longestMatch(int pos, int chainHead, int* distance) const;
+
+    void addLiteral(int pos);
+    void addMatch(int length, int distance);
+    bool emitBlock(bool final);
+    bool emitStoredBlock(const uint8_t data[], size_t length, bool final);
+
+    Sink                    fSink;
+    const int               fLevel;
+    int                     fMaxChain;
+    int                     fNiceLength;
+    bool                    fLazy;
+    bool                    fOK = true;
+
+    uint32_t                fAdler = 1;
+
+    std::vector<uint8_t>    fWindow;        // 2 * kWindowSize, slid down as input arrives
+    std::vector<int32_t>    fHead;          // hash -> most recent position (or -1)
+    std::vector<int32_t>    fPrev;          // position & (kWindowSize-1) -> previous in chain
+    int                     fStart = 0;     // next position to compress
+    int                     fLookahead = 0; // valid bytes at and after fStart
+
+    // lazy-matching state
+    int                     fPrevLength = 0;
+    int                     fPrevDistance = 0;
+    bool                    fLiteralPending = false;
+
+    std::vector<Symbol>     fSymbols;
+
+    std::vector<uint8_t>    fOut;
+    uint64_t                fBitBuffer = 0;
+    int                     fBitCount = 0;
+};
+
+#endif
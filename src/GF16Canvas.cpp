@@ -0,0 +1,132 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GBlend.h"
+#include "GRasterCanvas.h"
+#include "../include/GPixelConvert.h"
+#include "../include/GShader.h"
+
+using FloatRowProc   = void (*)(float dst[], const float src[], int count);
+using FloatColorProc = void (*)(float dst[], GFloat4 src, int count);
+
+template <GBlendMode Mode> void blend_float_row(float dst[], const float src[], int count) {
+    for (int i = 0; i < count; ++i) {
+        GBlendFloat4<Mode>(GFloat4::Load(src), GFloat4::Load(dst)).store(dst);
+        src += 4;
+        dst += 4;
+    }
+}
+
+template <GBlendMode Mode> void blend_float_color_row(float dst[], GFloat4 src, int count) {
+    for (int i = 0; i < count; ++i) {
+        GBlendFloat4<Mode>(src, GFloat4::Load(dst)).store(dst);
+        dst += 4;
+    }
+}
+
+// GPixels (b, g, r, a in memory) --> r, g, b, a floats in 0...1
+static void pixels_to_floats(const GPixel src[], int count, float dst[]) {
+    for (int i = 0; i < count; ++i) {
+        const GPixel p = src[i];
+        GFloat4 c(GPixel_GetR(p), GPixel_GetG(p), GPixel_GetB(p), GPixel_GetA(p));
+        (c * GFloat4(1 / 255.0f)).store(dst);
+        dst += 4;
+    }
+}
+
+/**
+ *  Each span of dst is expanded to floats, blended (one pixel per SIMD register), and rounded
+ *  back to halfs. A solid color is premultiplied in float, so it is never quantized to 8 bits;
+ *  shaders still produce GPixels.
+ */
+class BlitterF16 : public GBlitter {
+public:
+    BlitterF16(const GF16Bitmap& dst, const GPaint& paint)
+        : fDst(dst), fShader(paint.peekShader()), fMode(paint.getBlendMode()), fColor(0.0f)
+    {
+        const GColor c = paint.getColor().pinToUnit();
+        fColor = GFloat4(c.r * c.a, c.g * c.a, c.b * c.a, c.a);
+
+        const bool srcIsOpaque = fShader ? fShader->isOpaque() : c.a == 1;
+        if (srcIsOpaque && fMode == GBlendMode::kSrcOver) {
+            fMode = GBlendMode::kSrc;
+        }
+
+        GVisitBlendMode(fMode, [this](auto m) {
+            constexpr GBlendMode Mode = decltype(m)::value;
+            fRowProc = blend_float_row<Mode>;
+            fColorProc = blend_float_color_row<Mode>;
+        });
+
+        float rgba[4];
+        (fMode == GBlendMode::kClear ? GFloat4(0.0f) : fColor).store(rgba);
+        GConvertFloatToHalf(rgba, 4, &fFill.r);
+    }
+
+    void blitRow(int x, int y, int count) override {
+        GPixelF16* dst = fDst.getAddr(x, y);
+        if (fMode == GBlendMode::kDst) {
+            return;
+        }
+        if ((!fShader && fMode == GBlendMode::kSrc) || fMode == GBlendMode::kClear) {
+            for (int i = 0; i < count; ++i) {
+                dst[i] = fFill;
+            }
+            return;
+        }
+
+        fRow.resize(count * 4);
+        if (fShader) {
+            fPixels.resize(count);
+            fSrc.resize(count * 4);
+            fShader->shadeRow(x, y, count, fPixels.data());
+            pixels_to_floats(fPixels.data(), count, fSrc.data());
+            if (fMode == GBlendMode::kSrc) {
+                GConvertFloatToHalf(fSrc.data(), count * 4, &dst->r);
+                return;
+            }
+        }
+        GConvertHalfToFloat(&dst->r, count * 4, fRow.data());
+        if (fShader) {
+            fRowProc(fRow.data(), fSrc.data(), count);
+        } else {
+            fColorProc(fRow.data(), fColor, count);
+        }
+        GConvertFloatToHalf(fRow.data(), count * 4, &dst->r);
+    }
+
+private:
+    const GF16Bitmap    fDst;
+    GShader*            fShader;
+    GBlendMode          fMode;
+    GFloat4             fColor;     // premultiplied
+    GPixelF16           fFill;      // the result of kSrc or kClear with a solid color
+    FloatRowProc        fRowProc;
+    FloatColorProc      fColorProc;
+    std::vector<GPixel> fPixels;
+    std::vector<float>  fSrc;
+    std::vector<float>  fRow;
+};
+
+class CanvasF16 : public GRasterCanvas {
+public:
+    CanvasF16(const GF16Bitmap& bitmap)
+        : GRasterCanvas(bitmap.width(), bitmap.height()), fBitmap(bitmap)
+    {}
+
+protected:
+    std::unique_ptr<GBlitter> makeBlitter(const GPaint& paint) override {
+        return std::unique_ptr<GBlitter>(new BlitterF16(fBitmap, paint));
+    }
+
+private:
+    const GF16Bitmap fBitmap;
+};
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GF16Bitmap& bitmap) {
+    if (bitmap.width() <= 0 || bitmap.height() <= 0 || !bitmap.pixels()) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new CanvasF16(bitmap));
+}
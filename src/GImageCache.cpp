@@ -0,0 +1,162 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GImageCache.h"
+#include "../include/GMappedBitmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::shared_ptr<const GBitmap> make_shared_bitmap(const GBitmap& bm) {
+    return std::shared_ptr<const GBitmap>(new GBitmap(bm), [](const GBitmap* b) {
+        free(b->pixels());
+        delete b;
+    });
+}
+
+// FNV-1a : only used to name files in the disk cache, so it just needs to be well distributed
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static std::string disk_cache_path(const std::string& dir, const char path[],
+                                   long long modTime, long long size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hash_bytes(hash, path, strlen(path));
+    hash = hash_bytes(hash, &modTime, sizeof(modTime));
+    hash = hash_bytes(hash, &size, sizeof(size));
+
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.graw", (unsigned long long)hash);
+    return dir + name;
+}
+
+static bool write_raw(const char path[], const GBitmap& bitmap) {
+    // Write to a temporary name and then rename, so a concurrent reader never sees a partial file.
+    // The name is unique (mkstemp creates it), so concurrent writers of the same image (in other
+    // threads or processes) never write into each other's file.
+    std::string tmp = std::string(path) + ".XXXXXX";
+    const int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    if (bitmap.writeToRawFile(tmp.c_str()) && rename(tmp.c_str(), path) == 0) {
+        return true;
+    }
+    ::remove(tmp.c_str());
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GImageCache::GImageCache(size_t budgetBytes, const char diskCacheDir[])
+    : fBudget(budgetBytes), fDiskDir(diskCacheDir ? diskCacheDir : "")
+{}
+
+GImageCache::~GImageCache() {}
+
+GImageCache* GImageCache::Shared() {
+    static GImageCache* gCache = new GImageCache(64 << 20);
+    return gCache;
+}
+
+std::shared_ptr<const GBitmap> GImageCache::get(const char path[]) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return nullptr;
+    }
+    const long long modTime = st.st_mtime;
+    const long long fileSize = st.st_size;
+
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto iter = fMap.find(path);
+        if (iter != fMap.end()) {
+            EntryList::iterator entry = iter->second;
+            if (entry->fModTime == modTime && entry->fFileSize == fileSize) {
+                fLRU.splice(fLRU.begin(), fLRU, entry);
+                fStats.fHits += 1;
+                return entry->fBitmap;
+            }
+            this->remove(entry);   // stale: the file has changed since we decoded it
+        }
+        fStats.fMisses += 1;
+    }
+
+    // Decode without holding the lock, so other threads can still hit (or decode) in parallel.
+    // If two threads miss on the same file at once, both decode it and the last one wins.
+    auto bitmap = this->load(path, modTime, fileSize);
+    if (!bitmap) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto iter = fMap.find(path);
+    if (iter != fMap.end()) {
+        this->remove(iter->second);
+    }
+    const size_t bytes = bitmap->height() * bitmap->rowBytes();
+    fLRU.push_front({path, modTime, fileSize, bitmap, bytes});
+    fMap[path] = fLRU.begin();
+    fStats.fCount += 1;
+    fStats.fBytesUsed += bytes;
+    this->purgeToBudget();
+    return bitmap;
+}
+
+std::shared_ptr<const GBitmap> GImageCache::load(const char path[], long long modTime,
+                                                 long long size) {
+    std::string rawPath;
+    if (!fDiskDir.empty()) {
+        rawPath = disk_cache_path(fDiskDir, path, modTime, size);
+        if (std::shared_ptr<GMappedBitmap> mapped = GMappedBitmap::Open(rawPath.c_str())) {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStats.fDiskHits += 1;
+            // zero-copy: the bitmap views the mapping, which lives as long as the bitmap does
+            return std::shared_ptr<const GBitmap>(mapped, &mapped->bitmap());
+        }
+    }
+    GBitmap bm;
+    if (!bm.readFromFile(path)) {
+        return nullptr;
+    }
+    if (!rawPath.empty()) {
+        write_raw(rawPath.c_str(), bm);   // best effort: failing just means decoding next time
+    }
+    return make_shared_bitmap(bm);
+}
+
+void GImageCache::remove(EntryList::iterator entry) {
+    fStats.fCount -= 1;
+    fStats.fBytesUsed -= entry->fBytes;
+    fMap.erase(entry->fPath);
+    fLRU.erase(entry);
+}
+
+void GImageCache::purgeToBudget() {
+    // The newest entry is allowed to remain even if it alone is over budget
+    while (fStats.fBytesUsed > fBudget && fLRU.size() > 1) {
+        this->remove(std::prev(fLRU.end()));
+        fStats.fEvictions += 1;
+    }
+}
+
+void GImageCache::purge() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    while (!fLRU.empty()) {
+        this->remove(fLRU.begin());
+    }
+}
+
+GImageCache::Stats GImageCache::stats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+}
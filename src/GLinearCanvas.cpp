@@ -0,0 +1,258 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GBlend.h"
+#include "GRasterCanvas.h"
+#include "../include/GBitmap.h"
+#include "../include/GShader.h"
+
+#include <algorithm>
+
+/**
+ *  Linear values are stored with 12 bits: enough that every 8-bit sRGB value (even the darkest,
+ *  where the curve is steepest) decodes to a distinct value, and encodes back to itself.
+ */
+enum { kLinearMax = 4095 };
+
+static float srgb_to_linear(float x) {
+    return x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float x) {
+    return x <= 0.0031308f ? x * 12.92f : 1.055f * powf(x, 1 / 2.4f) - 0.055f;
+}
+
+struct LinearTables {
+    uint16_t fToLinear[256];
+    uint8_t  fFromLinear[kLinearMax + 1];
+
+    LinearTables() {
+        for (int i = 0; i < 256; ++i) {
+            fToLinear[i] = GRoundToInt(srgb_to_linear(i / 255.0f) * kLinearMax);
+        }
+        for (int i = 0; i <= kLinearMax; ++i) {
+            fFromLinear[i] = GRoundToInt(linear_to_srgb(i * (1.0f / kLinearMax)) * 255);
+        }
+    }
+};
+static const LinearTables gTables;
+
+// (a * c + 127) / 255, for an 8-bit alpha a and a 12-bit linear value c
+static inline unsigned mul_linear(unsigned a, unsigned c) {
+    return (a * c + 127) / 255;
+}
+
+/**
+ *  As GBlendChannel, but s and d are 12-bit linear values (the alphas are still 0...255). This is
+ *  only used for color channels; the alpha is always GBlendAlpha.
+ */
+template <GBlendMode Mode>
+unsigned blend_linear(unsigned s, unsigned d, unsigned sa, unsigned da) {
+    switch (Mode) {
+        case GBlendMode::kClear:    return 0;
+        case GBlendMode::kSrc:      return s;
+        case GBlendMode::kDst:      return d;
+        case GBlendMode::kSrcOver:  return s + mul_linear(255 - sa, d);
+        case GBlendMode::kDstOver:  return d + mul_linear(255 - da, s);
+        case GBlendMode::kSrcIn:    return mul_linear(da, s);
+        case GBlendMode::kDstIn:    return mul_linear(sa, d);
+        case GBlendMode::kSrcOut:   return mul_linear(255 - da, s);
+        case GBlendMode::kDstOut:   return mul_linear(255 - sa, d);
+        case GBlendMode::kSrcATop:  return mul_linear(da, s) + mul_linear(255 - sa, d);
+        case GBlendMode::kDstATop:  return mul_linear(sa, d) + mul_linear(255 - da, s);
+        case GBlendMode::kXor:      return mul_linear(255 - sa, d) + mul_linear(255 - da, s);
+        default: {
+            // the advanced modes are computed in float
+            const float k = 1.0f / kLinearMax;
+            const float c = GBlendAdvanced<Mode>(s * k, d * k, sa / 255.0f, da / 255.0f);
+            return GRoundToInt(GPinToUnit(c) * kLinearMax);
+        }
+    }
+    return 0;
+}
+
+// A premultiplied src color: 12-bit linear r, g, b, and 8-bit alpha
+struct LinearColor {
+    unsigned r, g, b, a;
+};
+
+static inline LinearColor pixel_to_linear(GPixel p) {
+    const uint16_t* lin = gTables.fToLinear;
+    return { lin[GPixel_GetR(p)], lin[GPixel_GetG(p)], lin[GPixel_GetB(p)],
+             (unsigned)GPixel_GetA(p) };
+}
+
+template <GBlendMode Mode> GPixel blend_linear_pixel(const LinearColor& s, GPixel dst) {
+    const unsigned da = GPixel_GetA(dst);
+    const unsigned a = GBlendAlpha<Mode>(s.a, da);
+    // encoding can lift a translucent color above its alpha, so pin it to stay premultiplied
+    auto channel = [&](unsigned sc, unsigned dc) {
+        unsigned c = blend_linear<Mode>(sc, gTables.fToLinear[dc], s.a, da);
+        return std::min<unsigned>(gTables.fFromLinear[std::min<unsigned>(c, kLinearMax)], a);
+    };
+    return GPixel_PackARGB(a, channel(s.r, GPixel_GetR(dst)), channel(s.g, GPixel_GetG(dst)),
+                           channel(s.b, GPixel_GetB(dst)));
+}
+
+/**
+ *  With a constant src, each channel's result depends only on that channel of the dst and on the
+ *  dst's alpha. So for one dst alpha, the results can be computed once and then looked up.
+ */
+struct DstTables {
+    unsigned fDA;
+    GPixel   fA;
+    GPixel   fR[256], fG[256], fB[256];
+
+    template <GBlendMode Mode> void init(const LinearColor& src, unsigned da) {
+        fDA = da;
+        // premultiplied dst channels are never greater than da
+        for (unsigned i = 0; i <= da; ++i) {
+            const GPixel p = blend_linear_pixel<Mode>(src, GPixel_PackARGB(da, i, i, i));
+            fA = p & (0xFFu << GPIXEL_SHIFT_A);
+            fR[i] = p & (0xFFu << GPIXEL_SHIFT_R);
+            fG[i] = p & (0xFFu << GPIXEL_SHIFT_G);
+            fB[i] = p & (0xFFu << GPIXEL_SHIFT_B);
+        }
+    }
+};
+
+// Rebuilding the tables costs about as much as blending da pixels directly, so only do it for
+// runs of dst pixels (with the same alpha) at least this long
+enum { kMinRunForTables = 32 };
+
+using LinearRowProc   = void (*)(GPixel dst[], const GPixel src[], int count);
+using LinearColorProc = void (*)(GPixel dst[], const LinearColor& src, DstTables*, int count);
+
+template <GBlendMode Mode> void linear_row(GPixel dst[], const GPixel src[], int count) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = blend_linear_pixel<Mode>(pixel_to_linear(src[i]), dst[i]);
+    }
+}
+
+template <GBlendMode Mode> void linear_color_row(GPixel dst[], const LinearColor& src,
+                                                 DstTables* tables, int count) {
+    while (count > 0) {
+        const unsigned da = GPixel_GetA(dst[0]);
+        int n = 1;
+        while (n < count && (unsigned)GPixel_GetA(dst[n]) == da) {
+            n += 1;
+        }
+        if (da != tables->fDA && n >= kMinRunForTables) {
+            tables->init<Mode>(src, da);
+        }
+        if (da == tables->fDA) {
+            for (int i = 0; i < n; ++i) {
+                const GPixel d = dst[i];
+                dst[i] = tables->fA | tables->fR[GPixel_GetR(d)] | tables->fG[GPixel_GetG(d)] |
+                         tables->fB[GPixel_GetB(d)];
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                dst[i] = blend_linear_pixel<Mode>(src, dst[i]);
+            }
+        }
+        dst += n;
+        count -= n;
+    }
+}
+
+/**
+ *  Decodes src and dst through the tables, blends in linear light, and encodes the result.
+ *
+ *  The transfer function is applied to the premultiplied values, which is exact for opaque
+ *  pixels (the common case for a dst); a solid paint color is linearized exactly, before it is
+ *  premultiplied.
+ */
+class LinearBlitter : public GBlitter {
+public:
+    LinearBlitter(const GBitmap& dst, const GPaint& paint)
+        : fDst(dst), fShader(paint.peekShader()), fMode(paint.getBlendMode())
+    {
+        const GColor c = paint.getColor().pinToUnit();
+        const float scale = c.a * kLinearMax;
+        fColor = { (unsigned)GRoundToInt(srgb_to_linear(c.r) * scale),
+                   (unsigned)GRoundToInt(srgb_to_linear(c.g) * scale),
+                   (unsigned)GRoundToInt(srgb_to_linear(c.b) * scale),
+                   (unsigned)GRoundToInt(c.a * 255) };
+
+        const bool srcIsOpaque = fShader ? fShader->isOpaque() : fColor.a == 255;
+        if (srcIsOpaque && fMode == GBlendMode::kSrcOver) {
+            fMode = GBlendMode::kSrc;
+        }
+
+        GVisitBlendMode(fMode, [this](auto m) {
+            constexpr GBlendMode Mode = decltype(m)::value;
+            fRowProc = linear_row<Mode>;
+            fColorProc = linear_color_row<Mode>;
+            if (!fShader) {
+                // start with opaque, the most common dst
+                fTables.init<Mode>(fColor, 0xFF);
+            }
+        });
+        if (!fShader && fMode == GBlendMode::kSrc) {
+            fFill = blend_linear_pixel<GBlendMode::kSrc>(fColor, 0);
+        }
+    }
+
+    void blitRow(int x, int y, int count) override {
+        GPixel* dst = fDst.getAddr(x, y);
+        if (fMode == GBlendMode::kDst) {
+            return;
+        }
+        if (fShader) {
+            if (fMode == GBlendMode::kSrc) {
+                // decoding and encoding is a no-op, so the src is simply stored
+                fShader->shadeRow(x, y, count, dst);
+                return;
+            }
+            fSrc.resize(count);
+            fShader->shadeRow(x, y, count, fSrc.data());
+            fRowProc(dst, fSrc.data(), count);
+            return;
+        }
+
+        if (fMode == GBlendMode::kSrc || fMode == GBlendMode::kClear) {
+            // the result does not depend on the dst
+            std::fill(dst, dst + count, fFill);
+        } else {
+            fColorProc(dst, fColor, &fTables, count);
+        }
+    }
+
+private:
+    const GBitmap       fDst;
+    GShader*            fShader;
+    GBlendMode          fMode;
+    LinearColor         fColor;
+    LinearRowProc       fRowProc;
+    LinearColorProc     fColorProc;
+    GPixel              fFill = 0;
+    DstTables           fTables;
+    std::vector<GPixel> fSrc;
+};
+
+class LinearCanvas : public GRasterCanvas {
+public:
+    LinearCanvas(const GBitmap& bitmap)
+        : GRasterCanvas(bitmap.width(), bitmap.height()), fBitmap(bitmap)
+    {}
+
+protected:
+    std::unique_ptr<GBlitter> makeBlitter(const GPaint& paint) override {
+        return std::unique_ptr<GBlitter>(new LinearBlitter(fBitmap, paint));
+    }
+
+private:
+    const GBitmap fBitmap;
+};
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, const GCanvasOptions& options) {
+    if (!options.fLinearBlending) {
+        return GCreateCanvas(bitmap);
+    }
+    if (bitmap.width() <= 0 || bitmap.height() <= 0 || !bitmap.pixels()) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new LinearCanvas(bitmap));
+}
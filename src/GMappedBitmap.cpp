@@ -0,0 +1,123 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GMappedBitmap.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void init_header(GRawBitmapHeader* header, int w, int h, bool isOpaque) {
+    memset(header, 0, sizeof(GRawBitmapHeader));
+    memcpy(header->fMagic, "GRAW", 4);
+    header->fVersion = GRawBitmapHeader::kVersion;
+    header->fWidth = w;
+    header->fHeight = h;
+    header->fRowBytes = w * sizeof(GPixel);
+    header->fIsOpaque = isOpaque;
+    header->fPixelOffset = GRawBitmapHeader::kPixelOffset;
+}
+
+// The header comes from a file, so the pixels' size is checked by dividing (rather than
+// multiplying, which could overflow), and each row must fit the int math of GBitmap::getAddr.
+static bool valid_header(const GRawBitmapHeader& header, size_t fileSize) {
+    return memcmp(header.fMagic, "GRAW", 4) == 0 &&
+           header.fVersion == GRawBitmapHeader::kVersion &&
+           header.fWidth > 0 && header.fHeight > 0 &&
+           header.fRowBytes >= header.fWidth * sizeof(GPixel) &&
+           header.fRowBytes <= INT32_MAX &&
+           header.fRowBytes % sizeof(GPixel) == 0 &&
+           header.fPixelOffset >= sizeof(GRawBitmapHeader) &&
+           header.fPixelOffset % GRawBitmapHeader::kPixelOffset == 0 &&
+           header.fPixelOffset <= fileSize &&
+           header.fRowBytes <= (fileSize - header.fPixelOffset) / (uint64_t)header.fHeight;
+}
+
+GMappedBitmap::GMappedBitmap(int fd, void* addr, size_t size, const GBitmap& bm)
+    : fFD(fd), fAddr(addr), fSize(size), fBitmap(bm)
+{}
+
+GMappedBitmap::~GMappedBitmap() {
+    munmap(fAddr, fSize);
+    close(fFD);
+}
+
+std::unique_ptr<GMappedBitmap> GMappedBitmap::Create(const char path[], int w, int h) {
+    if (w <= 0 || h <= 0) {
+        return nullptr;
+    }
+    const size_t rb = w * sizeof(GPixel);
+    const size_t size = GRawBitmapHeader::kPixelOffset + h * rb;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    // ftruncate gives us a sparse, zero-filled file, so untouched pages cost no disk or RAM
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    init_header((GRawBitmapHeader*)addr, w, h, false);
+
+    GPixel* pixels = (GPixel*)((char*)addr + GRawBitmapHeader::kPixelOffset);
+    GBitmap bm(w, h, rb, pixels, false);
+    return std::unique_ptr<GMappedBitmap>(new GMappedBitmap(fd, addr, size, bm));
+}
+
+bool GMappedBitmap::flush() {
+    return msync(fAddr, fSize, MS_SYNC) == 0;
+}
+
+std::unique_ptr<GMappedBitmap> GMappedBitmap::Open(const char path[]) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    GRawBitmapHeader header;
+    if (fstat(fd, &st) || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        !valid_header(header, st.st_size)) {
+        close(fd);
+        return nullptr;
+    }
+    // Private + writable: a canvas may draw into the pixels, but those pages are copied first
+    const size_t size = st.st_size;
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    GPixel* pixels = (GPixel*)((char*)addr + header.fPixelOffset);
+    GBitmap bm(header.fWidth, header.fHeight, header.fRowBytes, pixels, header.fIsOpaque != 0);
+    return std::unique_ptr<GMappedBitmap>(new GMappedBitmap(fd, addr, size, bm));
+}
+
+bool GBitmap::writeToRawFile(const char path[]) const {
+    if (this->width() <= 0 || this->height() <= 0) {
+        return false;
+    }
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    GRawBitmapHeader header;
+    init_header(&header, this->width(), this->height(), this->isOpaque());
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fseek(file, header.fPixelOffset, SEEK_SET) == 0;
+    for (int y = 0; ok && y < this->height(); ++y) {
+        ok = fwrite(this->getAddr(0, y), header.fRowBytes, 1, file) == 1;
+    }
+    return fclose(file) == 0 && ok;
+}
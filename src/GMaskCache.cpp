@@ -0,0 +1,188 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GMaskCache.h"
+#include "GRasterizer.h"
+
+#include <algorithm>
+#include <string.h>
+
+// The fractional part of the translation is rounded to 1/kSubpixelSteps of a pixel
+constexpr int kSubpixelSteps = 4;
+
+// Split v * kSubpixelSteps (rounded) into whole pixels and the remaining steps
+static int split_translate(float v, int* sub) {
+    const int steps = GRoundToInt(v * kSubpixelSteps);
+    const int whole = GFloorToInt((float)steps / kSubpixelSteps);
+    *sub = steps - whole * kSubpixelSteps;
+    return whole;
+}
+
+namespace {
+
+// Writes full coverage into a mask whose top-left is at (left, top) in device space
+class MaskBlitter : public GBlitter {
+public:
+    MaskBlitter(const GAlphaBitmap& mask, int left, int top)
+        : fMask(mask), fLeft(left), fTop(top)
+    {}
+
+    void blitRow(int x, int y, int count) override {
+        memset(fMask.getAddr(x - fLeft, y - fTop), 0xFF, count);
+    }
+
+private:
+    const GAlphaBitmap& fMask;
+    const int           fLeft, fTop;
+};
+
+} // namespace
+
+bool GMaskCache::Key::operator==(const Key& other) const {
+    return fPath == other.fPath && memcmp(fMat, other.fMat, sizeof(fMat)) == 0 &&
+           fSubX == other.fSubX && fSubY == other.fSubY;
+}
+
+size_t GMaskCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<const void*>()(key.fPath);
+    for (float v : key.fMat) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        hash = hash * 31 + bits;
+    }
+    return hash * 31 + key.fSubX * kSubpixelSteps + key.fSubY;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GMaskCache::GMaskCache(size_t budgetBytes) : fBudget(budgetBytes) {}
+
+GMaskCache::~GMaskCache() {}
+
+std::shared_ptr<const GMaskCache::Mask> GMaskCache::get(const GPath& path, const GMatrix& ctm,
+                                                        int* x, int* y) {
+    if (path.isInverseFillType()) {
+        return nullptr;     // its mask would be unbounded
+    }
+    std::weak_ptr<const GPath> owner = path.weak_from_this();
+    if (owner.expired()) {
+        return nullptr;     // not owned by a shared_ptr, so we could not tell when it is deleted
+    }
+    Key key = { &path, { ctm[0], ctm[1], ctm[2], ctm[3] }, 0, 0 };
+    const int dx = split_translate(ctm[4], &key.fSubX);
+    const int dy = split_translate(ctm[5], &key.fSubY);
+
+    std::shared_ptr<const Mask> mask;
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto iter = fMap.find(key);
+        if (iter != fMap.end()) {
+            EntryList::iterator entry = iter->second;
+            if (entry->fOwner.lock().get() == &path) {
+                fLRU.splice(fLRU.begin(), fLRU, entry);
+                fStats.fHits += 1;
+                mask = entry->fMask;
+            } else {
+                this->remove(entry);   // stale: a new path at the address of a deleted one
+            }
+        }
+    }
+
+    if (!mask) {
+        // Render without holding the lock, as GImageCache decodes
+        mask = this->render(path, key);
+        if (!mask) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStats.fMisses += 1;
+        auto iter = fMap.find(key);
+        if (iter != fMap.end()) {
+            this->remove(iter->second);
+        }
+        const size_t bytes = mask->fBitmap.height() * mask->fBitmap.rowBytes();
+        fLRU.push_front({key, owner, mask, bytes});
+        fMap[key] = fLRU.begin();
+        fStats.fCount += 1;
+        fStats.fBytesUsed += bytes;
+        this->purgeToBudget();
+    }
+    *x = mask->fLeft + dx;
+    *y = mask->fTop + dy;
+    return mask;
+}
+
+std::shared_ptr<const GMaskCache::Mask> GMaskCache::render(const GPath& path,
+                                                           const Key& key) const {
+    const GMatrix m(key.fMat[0], key.fMat[2], (float)key.fSubX / kSubpixelSteps,
+                    key.fMat[1], key.fMat[3], (float)key.fSubY / kSubpixelSteps);
+    auto devPath = path.transform(m);
+
+    // The control points bound the path
+    float L = 0, T = 0, R = 0, B = 0;
+    bool empty = true;
+    GPoint pts[GPath::kMaxNextPoints];
+    GPath::Iter iter(*devPath);
+    while (auto v = iter.next(pts)) {
+        const int count = v.value() == kMove ? 1 : (int)v.value() + 1;
+        for (int i = 0; i < count; ++i) {
+            if (empty) {
+                L = R = pts[i].x;
+                T = B = pts[i].y;
+                empty = false;
+            }
+            L = std::min(L, pts[i].x);
+            T = std::min(T, pts[i].y);
+            R = std::max(R, pts[i].x);
+            B = std::max(B, pts[i].y);
+        }
+    }
+    // (written so that NaNs fail too)
+    if (empty || !((R - L) * (B - T) <= (float)fBudget)) {
+        return nullptr;
+    }
+    const GIRect bounds = GIRect::LTRB(GFloorToInt(L), GFloorToInt(T),
+                                       GCeilToInt(R), GCeilToInt(B));
+    if (bounds.isEmpty() || (size_t)bounds.width() * bounds.height() > fBudget) {
+        return nullptr;
+    }
+
+    auto mask = std::make_shared<Mask>();
+    mask->fBitmap.alloc(bounds.width(), bounds.height());
+    mask->fLeft = bounds.left;
+    mask->fTop = bounds.top;
+    if (!mask->fBitmap.pixels()) {
+        return nullptr;
+    }
+    MaskBlitter blitter(mask->fBitmap, bounds.left, bounds.top);
+    GFillPath(*devPath, bounds, &blitter);
+    return mask;
+}
+
+void GMaskCache::remove(EntryList::iterator entry) {
+    fStats.fCount -= 1;
+    fStats.fBytesUsed -= entry->fBytes;
+    fMap.erase(entry->fKey);
+    fLRU.erase(entry);
+}
+
+void GMaskCache::purgeToBudget() {
+    // The newest entry is allowed to remain (it is never larger than the budget)
+    while (fStats.fBytesUsed > fBudget && fLRU.size() > 1) {
+        this->remove(std::prev(fLRU.end()));
+        fStats.fEvictions += 1;
+    }
+}
+
+void GMaskCache::purge() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    while (!fLRU.empty()) {
+        this->remove(fLRU.begin());
+    }
+}
+
+GMaskCache::Stats GMaskCache::stats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+}
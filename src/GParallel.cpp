@@ -0,0 +1,39 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GParallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+void GParallelFor(int count, const std::function<void(int)>& proc, int maxThreads) {
+    if (maxThreads <= 0) {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const int threads = std::min(count, maxThreads);
+    if (threads <= 1) {
+        for (int i = 0; i < count; ++i) {
+            proc(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i; (i = next.fetch_add(1)) < count;) {
+            proc(i);
+        }
+    };
+
+    // the calling thread works too, so we only need to start threads-1 others
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < threads; ++t) {
+        helpers.emplace_back(worker);
+    }
+    worker();
+    for (auto& h : helpers) {
+        h.join();
+    }
+}
@@ -0,0 +1,18 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GParallel_DEFINED
+#define GParallel_DEFINED
+
+#include "../include/GTypes.h"
+#include <functional>
+
+/**
+ *  Call proc(i) for each i in [0, count), spread across up to maxThreads threads (0 means one
+ *  per core). Indices are handed out dynamically, so uneven amounts of work still balance.
+ *  Returns once every call has finished.
+ */
+void GParallelFor(int count, const std::function<void(int)>& proc, int maxThreads = 0);
+
+#endif
@@ -3,11 +3,16 @@
  */
 
 #include "../include/GPathBuilder.h"
+#include "../include/GMath.h"
 #include "../include/GMatrix.h"
 
+#include <algorithm>
+#include <cmath>
+
 void GPathBuilder::reset() {
     fPts.clear();
     fVbs.clear();
+    fFillType = GPathFillType::kWinding;
 }
 
 void GPathBuilder::moveTo(GPoint p) {
@@ -41,7 +46,7 @@ void GPathBuilder::transform(const GMatrix& m) {
 }
 
 std::shared_ptr<GPath> GPathBuilder::detach() {
-    auto path = std::make_shared<GPath>(std::move(fPts), std::move(fVbs));
+    auto path = std::make_shared<GPath>(std::move(fPts), std::move(fVbs), fFillType);
     this->reset();
     return path;
 }
@@ -59,7 +64,222 @@ std::shared_ptr<GPath> GPath::transform(const GMatrix& m) const {
     }
     std::vector<GPoint> dst(fPts.size());
     m.mapPoints(dst.data(), fPts.data(), fPts.size());
-    return std::make_shared<GPath>(std::move(dst), fVbs);
+    auto path = std::make_shared<GPath>(std::move(dst), fVbs, fFillType);
+    // a matrix maps a convex polygon to a convex (or flat) one, so the result need not analyze
+    // itself again, e.g. when the same path is drawn repeatedly
+    path->fConvexity.store(this->isConvex() ? kConvex_Convexity : kConcave_Convexity,
+                           std::memory_order_relaxed);
+    return path;
+}
+
+namespace {
+
+// Counts the reversals in a cyclic sequence of directions (the signs of the values added)
+struct FlipCounter {
+    int fFirst = 0, fLast = 0, fFlips = 0;
+
+    void add(float v) {
+        const int s = (v > 0) - (v < 0);
+        if (s != 0) {
+            fFlips += fLast != 0 && s != fLast;
+            fFirst = fFirst ? fFirst : s;
+            fLast = s;
+        }
+    }
+    int flips() const { return fFlips + (fFirst != fLast); }
+};
+
+} // namespace
+
+bool GPath::ComputeIsConvex(const std::vector<GPoint>& pts, const std::vector<GPathVerb>& vbs) {
+    if (vbs.empty() || vbs[0] != kMove) {
+        return false;
+    }
+    for (size_t i = 1; i < vbs.size(); ++i) {
+        if (vbs[i] != kLine) {
+            return false;
+        }
+    }
+    const size_t n = pts.size();
+    GVector prev = {0, 0};
+    for (size_t i = n; i-- > 0 && prev.x == 0 && prev.y == 0;) {
+        prev = pts[(i + 1) % n] - pts[i];   // the last edge that has a length
+    }
+    int turn = 0;   // the direction of every turn (+1 or -1)
+    FlipCounter xs, ys;
+    for (size_t i = 0; i < n; ++i) {
+        const GVector curr = pts[(i + 1) % n] - pts[i];
+        if (curr.x == 0 && curr.y == 0) {
+            continue;
+        }
+        const float cross = prev.x * curr.y - prev.y * curr.x;
+        if (!std::isfinite(cross)) {
+            return false;
+        }
+        const int t = (cross > 0) - (cross < 0);
+        if (t != 0) {
+            if (turn != 0 && t != turn) {
+                return false;
+            }
+            turn = t;
+        } else if (prev.x * curr.x + prev.y * curr.y < 0) {
+            return false;   // doubles back on itself
+        }
+        xs.add(curr.x);
+        ys.add(curr.y);
+        prev = curr;
+    }
+    // a contour that always turns the same way, but goes around more than once (e.g. a star),
+    // reverses direction more often than this
+    return turn != 0 && xs.flips() <= 2 && ys.flips() <= 2;
+}
+
+bool GPath::isConvex() const {
+    Convexity convexity = fConvexity.load(std::memory_order_relaxed);
+    if (convexity == kUnknown_Convexity) {
+        // (if several threads race here, they all compute the same answer)
+        convexity = ComputeIsConvex(fPts, fVbs) ? kConvex_Convexity : kConcave_Convexity;
+        fConvexity.store(convexity, std::memory_order_relaxed);
+    }
+    return convexity == kConvex_Convexity;
+}
+
+static bool is_rect(const std::vector<GPoint>& pts, const std::vector<GPathVerb>& vbs) {
+    if (vbs.empty() || vbs[0] != kMove) {
+        return false;
+    }
+    for (size_t i = 1; i < vbs.size(); ++i) {
+        if (vbs[i] != kLine) {
+            return false;
+        }
+    }
+    // the corners, without repeated points (nor a last point that closes the contour)
+    GPoint corners[4];
+    int count = 0;
+    for (GPoint p : pts) {
+        if (count > 0 && p == corners[count - 1]) {
+            continue;
+        }
+        if (count == 4) {
+            if (p != corners[0]) {
+                return false;
+            }
+            continue;
+        }
+        corners[count++] = p;
+    }
+    if (count != 4) {
+        return false;
+    }
+    // the edges alternate between horizontal and vertical (starting with either)
+    const bool firstIsHorizontal = corners[0].y == corners[1].y;
+    for (int i = 0; i < 4; ++i) {
+        const GPoint a = corners[i], b = corners[(i + 1) % 4];
+        const bool horizontal = (i & 1) ? !firstIsHorizontal : firstIsHorizontal;
+        if (horizontal ? a.y != b.y : a.x != b.x) {
+            return false;
+        }
+    }
+    // ... and have lengths, so that the corners are distinct
+    return corners[0].x != corners[2].x && corners[0].y != corners[2].y;
+}
+
+// The ellipses that curves trace: a quarter of the unit circle by a cubic whose control points
+// are kQuarterCubicK along the tangents, or an eighth by a quad whose control point is where the
+// tangents meet. Each strays from the circle by at most the error (at its middle).
+constexpr float kQuarterCubicK = 0.5522848f;      // 4/3 tan(pi/8)
+constexpr float kQuarterCubicError = 0.00028f;
+constexpr float kEighthQuadError = 0.0032f;       // (cos(pi/8) + 1/cos(pi/8)) / 2 - 1
+
+// A path that strays further than this (relative to its smaller radius) is not an oval
+constexpr float kMaxOvalError = 1.0f / 100;
+
+/**
+ *  If the path is a closed contour of 4 cubics or 8 quads that trace the ellipse inscribed in
+ *  bounds (starting at one of their ends on it, in either direction), returns how far from the
+ *  ellipse it may be: how far its control points are from those of the ideal curves, plus how far
+ *  those are from the ellipse. Otherwise returns infinity.
+ */
+static float oval_error(const std::vector<GPoint>& pts, const std::vector<GPathVerb>& vbs,
+                        const GRect& bounds) {
+    const size_t curves = vbs.size() - 1;
+    if (vbs.empty() || vbs[0] != kMove || (curves != 4 && curves != 8)) {
+        return INFINITY;
+    }
+    const GPathVerb verb = curves == 4 ? kCubic : kQuad;
+    for (size_t i = 1; i < vbs.size(); ++i) {
+        if (vbs[i] != verb) {
+            return INFINITY;
+        }
+    }
+    if (pts.back() != pts.front()) {
+        return INFINITY;    // not closed (filling it would add a line back to the start)
+    }
+    const float rx = bounds.width() * 0.5f, ry = bounds.height() * 0.5f;
+    if (!(rx > 0 && ry > 0)) {
+        return INFINITY;
+    }
+    const GPoint center = { bounds.left + rx, bounds.top + ry };
+    auto unit = [&](GPoint p) { return GPoint{ (p.x - center.x) / rx, (p.y - center.y) / ry }; };
+    auto fromUnit = [&](GPoint u) { return GPoint{ center.x + u.x * rx, center.y + u.y * ry }; };
+
+    // where the ideal curves start, and which way they go around
+    const float step = 2 * (float)M_PI / curves;
+    const GPoint u0 = unit(pts[0]), u1 = unit(pts[verb]);
+    const int first = GRoundToInt(std::atan2(u0.y, u0.x) / step);
+    const float turn = u0.x * u1.y - u0.y * u1.x;
+    if (!(turn != 0)) {
+        return INFINITY;
+    }
+    const float dir = turn > 0 ? step : -step;
+
+    float error = 0;
+    auto compare = [&](GPoint actual, GPoint ideal) {
+        const float d = (actual - fromUnit(ideal)).length();
+        if (!(d <= error)) {
+            error = d;      // (keeping NaNs)
+        }
+    };
+    for (size_t i = 0; i < curves; ++i) {
+        const GPoint* c = &pts[i * verb];
+        const float a0 = first * step + (float)i * dir, a1 = a0 + dir;
+        const GPoint e0 = { cosf(a0), sinf(a0) }, e1 = { cosf(a1), sinf(a1) };
+        compare(c[0], e0);
+        compare(c[verb], e1);
+        if (verb == kCubic) {
+            // along the tangents, in the direction of travel
+            const float k = dir > 0 ? kQuarterCubicK : -kQuarterCubicK;
+            compare(c[1], { e0.x - k * e0.y, e0.y + k * e0.x });
+            compare(c[2], { e1.x + k * e1.y, e1.y - k * e1.x });
+        } else {
+            const float am = (a0 + a1) * 0.5f, d = 1 / cosf(step * 0.5f);
+            compare(c[1], { d * cosf(am), d * sinf(am) });
+        }
+    }
+    if (!(error <= INFINITY)) {
+        return INFINITY;
+    }
+    return error + (verb == kCubic ? kQuarterCubicError : kEighthQuadError) * std::max(rx, ry);
+}
+
+const GPath::Shape& GPath::shape() const {
+    std::call_once(fShapeOnce, [this]() {
+        GRect r = {0, 0, 0, 0};
+        if (!fPts.empty()) {
+            r = GRect::LTRB(fPts[0].x, fPts[0].y, fPts[0].x, fPts[0].y);
+            for (GPoint p : fPts) {
+                r.left = std::min(r.left, p.x);
+                r.top = std::min(r.top, p.y);
+                r.right = std::max(r.right, p.x);
+                r.bottom = std::max(r.bottom, p.y);
+            }
+        }
+        fShape.fBounds = r;
+        fShape.fIsRect = is_rect(fPts, fVbs);
+        fShape.fOvalError = fShape.fIsRect ? INFINITY : oval_error(fPts, fVbs, r);
+        fShape.fIsOval = fShape.fOvalError <= kMaxOvalError * std::min(r.width(), r.height()) / 2;
+    });
+    return fShape;
 }
 
 GPath::Iter::Iter(const GPath& path) {
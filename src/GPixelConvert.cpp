@@ -0,0 +1,379 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GMath.h"
+#include "../include/GPixelConvert.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// On x86 with gcc/clang we can compile F16C code and select it at runtime
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define G_F16C_DISPATCH
+#endif
+
+static inline unsigned premul(unsigned c, unsigned a) {
+    return (c * a + 127) / 255;
+}
+
+static inline unsigned unpremul(unsigned c, unsigned a) {
+    return (0 != a && 255 != a) ? (c * 255 + a/2) / a : c;
+}
+
+static void rgba_to_pixels(const uint8_t src[], int count, GPixel dst[]) {
+    for (int i = 0; i < count; ++i) {
+        unsigned a = src[3];
+        dst[i] = GPixel_PackARGB(a, premul(src[0], a), premul(src[1], a), premul(src[2], a));
+        src += 4;
+    }
+}
+
+static void pixels_to_rgba(const GPixel src[], int count, uint8_t dst[]) {
+    for (int i = 0; i < count; ++i) {
+        GPixel c = src[i];
+        unsigned a = GPixel_GetA(c);
+        *dst++ = unpremul(GPixel_GetR(c), a);
+        *dst++ = unpremul(GPixel_GetG(c), a);
+        *dst++ = unpremul(GPixel_GetB(c), a);
+        *dst++ = a;
+    }
+}
+
+static void pixels_to_565(const GPixel src[], int count, GPixel565 dst[]) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GPixel565_PackRGB(GPixel_GetR(src[i]), GPixel_GetG(src[i]), GPixel_GetB(src[i]));
+    }
+}
+
+static void from_565_to_pixels(const GPixel565 src[], int count, GPixel dst[]) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GPixel_PackARGB(0xFF, GPixel565_GetR(src[i]), GPixel565_GetG(src[i]),
+                                 GPixel565_GetB(src[i]));
+    }
+}
+
+#if defined(__SSE2__)
+
+/**
+ *  Reciprocals for unpremul, each rounded *up* to the next float. Since c <= a, the quotient
+ *  (c*255 + a/2) / a is at most ~255.5, so the relative error of x * rcp[a] (< 2^-22) can never
+ *  push it across the next integer (at least 1/a away), and truncating gives the exact result.
+ *  rcp[0] is 0, which maps the (only legal) premul color for a == 0, i.e. 0, to 0.
+ */
+struct ReciprocalTable {
+    float fRcp[256];
+
+    ReciprocalTable() {
+        fRcp[0] = 0;
+        for (int a = 1; a < 256; ++a) {
+            fRcp[a] = nextafterf(1.0f / a, INFINITY);
+        }
+    }
+};
+static const ReciprocalTable gRcp;
+
+// Swap the bytes in positions 0 and 2 of each 32bit lane (i.e. BGRA <--> RGBA)
+static inline __m128i swap_rb(__m128i v) {
+    const __m128i ag = _mm_set1_epi32(0xFF00FF00);
+    const __m128i lo = _mm_set1_epi32(0xFF);
+    return _mm_or_si128(_mm_and_si128(v, ag),
+                        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), lo),
+                                     _mm_slli_epi32(_mm_and_si128(v, lo), 16)));
+}
+
+// x holds 2 pixels as 16bit r,g,b,a lanes. Return them as premultiplied b,g,r,a lanes.
+static inline __m128i premul_2_pixels(__m128i x) {
+    const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)),
+                                    _MM_SHUFFLE(3, 3, 3, 3));
+    // scale alpha by 255, which (with the rounding below) leaves it unchanged
+    a = _mm_or_si128(_mm_andnot_si128(alphaLanes, a),
+                     _mm_and_si128(alphaLanes, _mm_set1_epi16(255)));
+    x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 0, 1, 2)),
+                            _MM_SHUFFLE(3, 0, 1, 2));
+
+    // (x*a + 127) / 255 == (t + (t >> 8)) >> 8, where t = x*a + 128 (all fits in 16 bits)
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// p holds 1 pixel as 32bit b,g,r,a lanes. Returns the unpremultiplied (32bit) lanes.
+static inline __m128i unpremul_1_pixel(__m128i p, unsigned a) {
+    __m128i x = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(p, 8), p), _mm_set1_epi32(a >> 1));
+    return _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(gRcp.fRcp[a])));
+}
+
+// (x + 127) / 255 for each 32bit lane, for 0 <= x <= 255*255 (same as GDiv255)
+static inline __m128i div255_epi32(__m128i x) {
+    __m128i t = _mm_add_epi32(x, _mm_set1_epi32(128));
+    return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+}
+
+// 4 GPixels --> 4 565 values, in the low 16 bits of each 32bit lane
+static inline __m128i pack_565(__m128i v) {
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(v,  8), mask);
+    __m128i b = _mm_and_si128(v, mask);
+    r = div255_epi32(_mm_sub_epi32(_mm_slli_epi32(r, 5), r));   // r * 31
+    g = div255_epi32(_mm_sub_epi32(_mm_slli_epi32(g, 6), g));   // g * 63
+    b = div255_epi32(_mm_sub_epi32(_mm_slli_epi32(b, 5), b));   // b * 31
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11), _mm_slli_epi32(g, 5)), b);
+}
+
+// 4 565 values (in the low 16 bits of each 32bit lane) --> 4 opaque GPixels
+static inline __m128i unpack_565(__m128i p) {
+    __m128i r = _mm_srli_epi32(p, 11);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(63));
+    __m128i b = _mm_and_si128(p, _mm_set1_epi32(31));
+    r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+    g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+    b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+    return _mm_or_si128(_mm_or_si128(_mm_set1_epi32(0xFF000000), _mm_slli_epi32(r, 16)),
+                        _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+// sign-extend the low 16 bits of each lane, so that packs_epi32 keeps them unchanged
+static inline __m128i low16_for_packs(__m128i v) {
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+#endif
+
+void GConvertRGBAToPixels(const uint8_t src[], int count, GPixel dst[]) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; count >= 4; count -= 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)src);
+        __m128i lo = premul_2_pixels(_mm_unpacklo_epi8(v, zero));
+        __m128i hi = premul_2_pixels(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+        src += 16;
+        dst += 4;
+    }
+#endif
+    rgba_to_pixels(src, count, dst);
+}
+
+void GConvertPixelsToRGBA(const GPixel src[], int count, uint8_t dst[]) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+    for (; count >= 4; count -= 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)src);
+        __m128i opaque = _mm_cmpeq_epi32(_mm_and_si128(v, alphaMask), alphaMask);
+        if (_mm_movemask_epi8(opaque) != 0xFFFF) {
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i p0 = unpremul_1_pixel(_mm_unpacklo_epi16(lo, zero), src[0] >> 24);
+            __m128i p1 = unpremul_1_pixel(_mm_unpackhi_epi16(lo, zero), src[1] >> 24);
+            __m128i p2 = unpremul_1_pixel(_mm_unpacklo_epi16(hi, zero), src[2] >> 24);
+            __m128i p3 = unpremul_1_pixel(_mm_unpackhi_epi16(hi, zero), src[3] >> 24);
+            __m128i colors = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+            // alpha itself passes through unchanged
+            v = _mm_or_si128(_mm_andnot_si128(alphaMask, colors), _mm_and_si128(alphaMask, v));
+        }
+        _mm_storeu_si128((__m128i*)dst, swap_rb(v));
+        src += 4;
+        dst += 16;
+    }
+#endif
+    pixels_to_rgba(src, count, dst);
+}
+
+void GConvertPixelsTo565(const GPixel src[], int count, GPixel565 dst[]) {
+#if defined(__SSE2__)
+    for (; count >= 8; count -= 8) {
+        __m128i lo = pack_565(_mm_loadu_si128((const __m128i*)(src + 0)));
+        __m128i hi = pack_565(_mm_loadu_si128((const __m128i*)(src + 4)));
+        _mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(low16_for_packs(lo),
+                                                        low16_for_packs(hi)));
+        src += 8;
+        dst += 8;
+    }
+#endif
+    pixels_to_565(src, count, dst);
+}
+
+void GConvert565ToPixels(const GPixel565 src[], int count, GPixel dst[]) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; count >= 8; count -= 8) {
+        __m128i p = _mm_loadu_si128((const __m128i*)src);
+        _mm_storeu_si128((__m128i*)(dst + 0), unpack_565(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128((__m128i*)(dst + 4), unpack_565(_mm_unpackhi_epi16(p, zero)));
+        src += 8;
+        dst += 8;
+    }
+#endif
+    from_565_to_pixels(src, count, dst);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t float_bits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    return bits;
+}
+
+static inline float bits_float(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+float GHalfToFloat(GHalf h) {
+    // Shifting the exponent and mantissa into place and scaling by 2^(127 - 15) rebiases the
+    // exponent, and also normalizes denormals. Infinity and NaN keep the maximum exponent.
+    const uint32_t bits = (h & 0x7FFF) << 13;
+    float f = (h & 0x7C00) == 0x7C00 ? bits_float(bits | 0x7F800000) : bits_float(bits) * 0x1p112f;
+    return (h & 0x8000) ? -f : f;
+}
+
+GHalf GFloatToHalf(float x) {
+    uint32_t f = float_bits(x);
+    const uint32_t sign = f & 0x80000000;
+    f ^= sign;
+
+    GHalf h;
+    if (f >= (127 + 16) << 23) {
+        // too large for a half: infinity, or a (quiet) NaN
+        h = f > 0x7F800000 ? 0x7E00 : 0x7C00;
+    } else if (f < (127 - 14) << 23) {
+        // a half denormal (or zero): adding 0.5 aligns the mantissa so that the FPU does the
+        // rounding for us
+        const uint32_t magic = (127 - 1) << 23;
+        h = float_bits(bits_float(f) + bits_float(magic)) - magic;
+    } else {
+        // rebias the exponent, then round to nearest even in the 13 bits we drop
+        const uint32_t odd = (f >> 13) & 1;
+        f += ((15u - 127u) << 23) + 0xFFF + odd;
+        h = f >> 13;
+    }
+    return h | (sign >> 16);
+}
+
+#ifdef G_F16C_DISPATCH
+
+__attribute__((target("avx,f16c")))
+static void half_to_float_f16c(const GHalf src[], int count, float dst[]) {
+    for (; count >= 8; count -= 8) {
+        _mm256_storeu_ps(dst, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)src)));
+        src += 8;
+        dst += 8;
+    }
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GHalfToFloat(src[i]);
+    }
+}
+
+__attribute__((target("avx,f16c")))
+static void float_to_half_f16c(const float src[], int count, GHalf dst[]) {
+    for (; count >= 8; count -= 8) {
+        _mm_storeu_si128((__m128i*)dst,
+                         _mm256_cvtps_ph(_mm256_loadu_ps(src), _MM_FROUND_TO_NEAREST_INT));
+        src += 8;
+        dst += 8;
+    }
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GFloatToHalf(src[i]);
+    }
+}
+
+static const bool gHasF16C = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+
+#endif
+
+void GConvertHalfToFloat(const GHalf src[], int count, float dst[]) {
+#ifdef G_F16C_DISPATCH
+    if (gHasF16C) {
+        half_to_float_f16c(src, count, dst);
+        return;
+    }
+#endif
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GHalfToFloat(src[i]);
+    }
+}
+
+void GConvertFloatToHalf(const float src[], int count, GHalf dst[]) {
+#ifdef G_F16C_DISPATCH
+    if (gHasF16C) {
+        float_to_half_f16c(src, count, dst);
+        return;
+    }
+#endif
+    for (int i = 0; i < count; ++i) {
+        dst[i] = GFloatToHalf(src[i]);
+    }
+}
+
+// Pixels are converted through a small float buffer, so the half conversions can run on rows
+enum { kF16Batch = 64 };
+
+static inline unsigned unit_to_byte(float x) {
+    return (unsigned)(x * 255 + 0.5f);
+}
+
+void GConvertF16ToPixels(const GPixelF16 src[], int count, GPixel dst[]) {
+    float buffer[kF16Batch * 4];
+    while (count > 0) {
+        const int n = std::min<int>(count, kF16Batch);
+        GConvertHalfToFloat(&src->r, n * 4, buffer);
+        const float* f = buffer;
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+        auto pin = [&](const float rgba[]) {
+            __m128 v = _mm_max_ps(_mm_loadu_ps(rgba), zero);
+            __m128 a = _mm_min_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), one);
+            // reorder to GPixel's b, g, r, a (in memory), pin each color to alpha, and round
+            v = _mm_min_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2)), a);
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255)),
+                                               _mm_set1_ps(0.5f)));
+        };
+        for (; i + 4 <= n; i += 4) {
+            __m128i lo = _mm_packs_epi32(pin(f + 0), pin(f + 4));
+            __m128i hi = _mm_packs_epi32(pin(f + 8), pin(f + 12));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+            f += 16;
+        }
+#endif
+        for (; i < n; ++i) {
+            // NaNs pin to 0, as maxps does above (written so that they fail the comparisons)
+            const float a = f[3] > 0 ? std::min(f[3], 1.0f) : 0;
+            auto color = [a](float c) { return unit_to_byte(c > 0 ? std::min(c, a) : 0); };
+            dst[i] = GPixel_PackARGB(unit_to_byte(a), color(f[0]), color(f[1]), color(f[2]));
+            f += 4;
+        }
+        src += n;
+        dst += n;
+        count -= n;
+    }
+}
+
+void GConvertPixelsToF16(const GPixel src[], int count, GPixelF16 dst[]) {
+    float buffer[kF16Batch * 4];
+    while (count > 0) {
+        const int n = std::min<int>(count, kF16Batch);
+        float* f = buffer;
+        for (int i = 0; i < n; ++i) {
+            const GPixel p = src[i];
+            *f++ = GPixel_GetR(p) * (1 / 255.0f);
+            *f++ = GPixel_GetG(p) * (1 / 255.0f);
+            *f++ = GPixel_GetB(p) * (1 / 255.0f);
+            *f++ = GPixel_GetA(p) * (1 / 255.0f);
+        }
+        GConvertFloatToHalf(buffer, n * 4, &dst->r);
+        src += n;
+        dst += n;
+        count -= n;
+    }
+}
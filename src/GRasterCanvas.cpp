@@ -0,0 +1,1100 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GRasterCanvas.h"
+#include "GBlend.h"
+#include "../include/GBlur.h"
+#include "../include/GColorFilter.h"
+#include "../include/GMaskCache.h"
+#include "../include/GShader.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+// Interpolates the 3 colors across the triangle
+class TriColorShader : public GShader {
+public:
+    TriColorShader(const GPoint pts[3], const GColor colors[3])
+        : fBasis(pts[1] - pts[0], pts[2] - pts[0], pts[0])
+        , fC0(colors[0]), fDC1(colors[1] - colors[0]), fDC2(colors[2] - colors[0])
+        , fInverse(GMatrix())
+    {
+        fIsOpaque = colors[0].a >= 1 && colors[1].a >= 1 && colors[2].a >= 1;
+    }
+
+    bool isOpaque() override { return fIsOpaque; }
+
+    bool setContext(const GMatrix& ctm) override {
+        if (auto inv = (ctm * fBasis).invert()) {
+            fInverse = *inv;
+            return true;
+        }
+        return false;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        const GPoint p = fInverse * GPoint{x + 0.5f, y + 0.5f};
+        GColor c = fC0 + fDC1 * p.x + fDC2 * p.y;
+        const GColor dc = fDC1 * fInverse[0] + fDC2 * fInverse[1];
+        for (int i = 0; i < count; ++i) {
+            row[i] = GColorToPixel(c);
+            c += dc;
+        }
+    }
+
+private:
+    const GMatrix fBasis;
+    const GColor  fC0, fDC1, fDC2;
+    GMatrix       fInverse;
+    bool          fIsOpaque;
+};
+
+// Draws another shader with an additional matrix (e.g. mapping texture coordinates to the verts)
+class ProxyShader : public GShader {
+public:
+    ProxyShader(GShader* shader, const GMatrix& extra) : fShader(shader), fExtra(extra) {}
+
+    bool isOpaque() override { return fShader->isOpaque(); }
+    bool setContext(const GMatrix& ctm) override { return fShader->setContext(ctm * fExtra); }
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        fShader->shadeRow(x, y, count, row);
+    }
+
+private:
+    GShader*      fShader;
+    const GMatrix fExtra;
+};
+
+// Multiplies the output of two shaders, component by component
+class ModulateShader : public GShader {
+public:
+    ModulateShader(GShader* a, GShader* b) : fA(a), fB(b) {}
+
+    bool isOpaque() override { return fA->isOpaque() && fB->isOpaque(); }
+    bool setContext(const GMatrix& ctm) override {
+        return fA->setContext(ctm) && fB->setContext(ctm);
+    }
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        fStorage.resize(count);
+        fA->shadeRow(x, y, count, row);
+        fB->shadeRow(x, y, count, fStorage.data());
+        for (int i = 0; i < count; ++i) {
+            const GPixel a = row[i], b = fStorage[i];
+            row[i] = GPixel_PackARGB(GMul255(GPixel_GetA(a), GPixel_GetA(b)),
+                                     GMul255(GPixel_GetR(a), GPixel_GetR(b)),
+                                     GMul255(GPixel_GetG(a), GPixel_GetG(b)),
+                                     GMul255(GPixel_GetB(a), GPixel_GetB(b)));
+        }
+    }
+
+private:
+    GShader*            fA;
+    GShader*            fB;
+    std::vector<GPixel> fStorage;
+};
+
+// Wraps a shader we don't own, so it can be placed in a GPaint for the duration of a draw
+class UnownedShader : public ProxyShader {
+public:
+    UnownedShader(GShader* shader) : ProxyShader(shader, GMatrix()) {}
+};
+
+/**
+ *  Recycles layer pixels: a nested or repeated saveLayer usually needs no more memory than an
+ *  earlier one, so it can reuse that allocation instead of calling calloc every time.
+ */
+class LayerPool {
+public:
+    // Return (uninitialized) memory for at least size bytes, and its actual size in capacity
+    void* acquire(size_t size, size_t* capacity) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        // use the smallest block that is large enough
+        auto best = fBlocks.end();
+        for (auto iter = fBlocks.begin(); iter != fBlocks.end(); ++iter) {
+            if (iter->fSize >= size && (best == fBlocks.end() || iter->fSize < best->fSize)) {
+                best = iter;
+            }
+        }
+        if (best != fBlocks.end()) {
+            Block block = *best;
+            fBlocks.erase(best);
+            *capacity = block.fSize;
+            return block.fMemory;
+        }
+        *capacity = size;
+        return malloc(size);
+    }
+
+    void release(void* memory, size_t capacity) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fBlocks.push_back({memory, capacity});
+        if (fBlocks.size() > kMaxBlocks) {
+            // drop the smallest, which is the least likely to be reusable
+            auto smallest = std::min_element(fBlocks.begin(), fBlocks.end(),
+                                             [](const Block& a, const Block& b) {
+                return a.fSize < b.fSize;
+            });
+            free(smallest->fMemory);
+            fBlocks.erase(smallest);
+        }
+    }
+
+private:
+    enum { kMaxBlocks = 8 };
+
+    struct Block {
+        void*  fMemory;
+        size_t fSize;
+    };
+    std::mutex         fMutex;
+    std::vector<Block> fBlocks;
+};
+static LayerPool gLayerPool;
+
+/**
+ *  Blends into a layer (a GBitmap), whose top-left is at (x, y) in device space.
+ */
+class LayerBlitter : public GBlitter {
+public:
+    LayerBlitter(const GBitmap& layer, int x, int y, const GPaint& paint)
+        : fLayer(layer), fX(x), fY(y), fShader(paint.peekShader())
+        , fColor(GColorToPixel(paint.getColor())), fMode(paint.getBlendMode())
+    {
+        const bool srcIsOpaque = fShader ? fShader->isOpaque() : GPixel_GetA(fColor) == 0xFF;
+        if (srcIsOpaque && fMode == GBlendMode::kSrcOver) {
+            fMode = GBlendMode::kSrc;
+        }
+        if (fMode == GBlendMode::kClear) {
+            fShader = nullptr;
+            fColor = 0;
+            fMode = GBlendMode::kSrc;
+        }
+        GVisitBlendMode(fMode, [this](auto m) {
+            constexpr GBlendMode Mode = decltype(m)::value;
+            fRowProc = GBlendRow<Mode>;
+            fColorProc = GBlendColorRow<Mode>;
+        });
+    }
+
+    void blitRow(int x, int y, int count) override {
+        GPixel* dst = fLayer.getAddr(x - fX, y - fY);
+        if (fMode == GBlendMode::kDst) {
+            return;
+        }
+        if (fShader) {
+            if (fMode == GBlendMode::kSrc) {
+                fShader->shadeRow(x, y, count, dst);
+                return;
+            }
+            fSrc.resize(count);
+            fShader->shadeRow(x, y, count, fSrc.data());
+            fRowProc(dst, fSrc.data(), count);
+        } else if (fMode == GBlendMode::kSrc) {
+            std::fill(dst, dst + count, fColor);
+        } else {
+            fColorProc(dst, fColor, count);
+        }
+    }
+
+private:
+    using RowProc   = void (*)(GPixel dst[], const GPixel src[], int count);
+    using ColorProc = void (*)(GPixel dst[], GPixel src, int count);
+
+    const GBitmap       fLayer;
+    const int           fX, fY;
+    GShader*            fShader;
+    GPixel              fColor;
+    GBlendMode          fMode;
+    RowProc             fRowProc;
+    ColorProc           fColorProc;
+    std::vector<GPixel> fSrc;
+};
+
+/**
+ *  Returns the layer's pixels (in device space), scaled by alpha.
+ */
+class LayerShader : public GShader {
+public:
+    LayerShader(const GBitmap& layer, int x, int y, unsigned alpha)
+        : fLayer(layer), fX(x), fY(y), fAlpha(alpha)
+    {}
+
+    bool isOpaque() override { return false; }
+    bool setContext(const GMatrix&) override { return true; }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        const GPixel* src = fLayer.getAddr(x - fX, y - fY);
+        if (fAlpha == 0xFF) {
+            memcpy(row, src, count * sizeof(GPixel));
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            const GPixel p = src[i];
+            row[i] = GPixel_PackARGB(GMul255(GPixel_GetA(p), fAlpha),
+                                     GMul255(GPixel_GetR(p), fAlpha),
+                                     GMul255(GPixel_GetG(p), fAlpha),
+                                     GMul255(GPixel_GetB(p), fAlpha));
+        }
+    }
+
+private:
+    const GBitmap  fLayer;
+    const int      fX, fY;
+    const unsigned fAlpha;
+};
+
+/**
+ *  Samples (nearest neighbor) count pixels, starting at device x, of a src span [lo, hi) of a
+ *  bitmap's row, which is scaled by sx (src pixels per device pixel) to start at device dstLeft.
+ *  Instead of mapping every pixel back through a matrix, this finds how many pixels fall left of
+ *  the span, then steps through it in 32.32 fixed point (so that neither large coordinates nor
+ *  tiny scales lose the position), clamping only at its ends; an unscaled span at an integer
+ *  position is copied.
+ */
+static void sample_span(const GPixel src[], int lo, int hi, float dstLeft, float sx, int x,
+                        int count, GPixel row[]) {
+    if (sx == 1 && dstLeft == floorf(dstLeft)) {
+        const int start = lo + x - (int)dstLeft;
+        if (start >= lo && start + count <= hi) {
+            memcpy(row, src + start, count * sizeof(GPixel));
+            return;
+        }
+    }
+
+    constexpr double kOne = 4294967296.0;   // 1 in 32.32
+    const double start = lo + (x + 0.5 - dstLeft) * sx;
+    int i = 0;
+    if (start < lo) {
+        // (written so that a zero scale, or a NaN, leaves every pixel clamped)
+        i = (int)std::min<double>(count, sx > 0 ? std::ceil((lo - start) / sx) : count);
+    }
+    for (int j = 0; j < i; ++j) {
+        row[j] = src[lo];
+    }
+    // a step of more than the span's width leaves at most one pixel in it
+    const int64_t dx = (int64_t)(std::min<double>(sx, hi - lo) * kOne);
+    // (clamped, as rounding may leave the first pixel just outside the span)
+    int64_t fx = (int64_t)(std::max<double>(lo, std::min<double>(hi, start + i * sx)) * kOne);
+    const int64_t end = ((int64_t)hi << 32) - fx;
+    const int n = end <= 0 ? i
+                : dx == 0 ? count
+                : (int)std::min<int64_t>(count, i + (end + dx - 1) / dx);
+    for (; i < n; ++i) {
+        row[i] = src[fx >> 32];
+        fx += dx;
+    }
+    for (; i < count; ++i) {
+        row[i] = src[hi - 1];
+    }
+}
+
+// The src row [top, bottom) for device row y, when scaled by sy to start at device dstTop
+static int sample_row(int top, int bottom, float dstTop, float sy, int y) {
+    return std::max(top, std::min(bottom - 1, GFloorToInt(top + (y + 0.5f - dstTop) * sy)));
+}
+
+// Multiply each pixel by the (premultiplied) color
+static void modulate_row(GPixel row[], int count, GPixel color) {
+    if (color == 0xFFFFFFFF) {
+        return;
+    }
+    const unsigned a = GPixel_GetA(color), r = GPixel_GetR(color), g = GPixel_GetG(color),
+                   b = GPixel_GetB(color);
+    for (int i = 0; i < count; ++i) {
+        const GPixel p = row[i];
+        row[i] = GPixel_PackARGB(GMul255(GPixel_GetA(p), a), GMul255(GPixel_GetR(p), r),
+                                 GMul255(GPixel_GetG(p), g), GMul255(GPixel_GetB(p), b));
+    }
+}
+
+/**
+ *  Samples the src rect of a bitmap, scaled to fill a device-space rect, and multiplied by a
+ *  (premultiplied) color.
+ *
+ *  The rects and color can be changed between draws with the same blitter (e.g. for each sprite
+ *  in drawAtlas), so whether the shader is opaque is decided up front.
+ */
+class BitmapRectShader : public GShader {
+public:
+    BitmapRectShader(const GBitmap& bitmap, bool isOpaque)
+        : fBitmap(bitmap), fIsOpaque(isOpaque)
+    {}
+
+    void set(const GIRect& src, const GRect& dst, GPixel color) {
+        fSrc = src;
+        fDst = dst;
+        fColor = color;
+        fSX = src.width() / dst.width();
+        fSY = src.height() / dst.height();
+    }
+
+    bool isOpaque() override { return fIsOpaque; }
+    bool setContext(const GMatrix&) override { return true; }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        const int sy = sample_row(fSrc.top, fSrc.bottom, fDst.top, fSY, y);
+        sample_span(fBitmap.getAddr(0, sy), fSrc.left, fSrc.right, fDst.left, fSX, x, count,
+                    row);
+        modulate_row(row, count, fColor);
+    }
+
+private:
+    const GBitmap fBitmap;
+    const bool    fIsOpaque;
+    GIRect        fSrc;
+    GRect         fDst;
+    GPixel        fColor;
+    float         fSX, fSY;     // src pixels per dst pixel
+};
+
+/**
+ *  A bitmap split into a 3x3 grid, each column and row of which is scaled to fill the matching
+ *  column and row of a device-space grid (see drawBitmapNine). Every row finds its src row once,
+ *  then samples the (up to) three spans that it crosses.
+ */
+class NineShader : public GShader {
+public:
+    // xs and ys are the edges of the columns and rows: 4 in src, and 4 in device space
+    NineShader(const GBitmap& bitmap, const int srcX[4], const int srcY[4], const float dstX[4],
+               const float dstY[4], GPixel color)
+        : fBitmap(bitmap), fColor(color)
+    {
+        for (int i = 0; i < 4; ++i) {
+            fSrcX[i] = srcX[i];
+            fSrcY[i] = srcY[i];
+            fDstX[i] = dstX[i];
+            fDstY[i] = dstY[i];
+        }
+        for (int i = 0; i < 3; ++i) {
+            fScaleX[i] = dstX[i + 1] > dstX[i] ? (srcX[i + 1] - srcX[i]) / (dstX[i + 1] - dstX[i])
+                                               : 0;
+            fScaleY[i] = dstY[i + 1] > dstY[i] ? (srcY[i + 1] - srcY[i]) / (dstY[i + 1] - dstY[i])
+                                               : 0;
+        }
+    }
+
+    bool isOpaque() override { return fBitmap.isOpaque() && GPixel_GetA(fColor) == 0xFF; }
+    bool setContext(const GMatrix&) override { return true; }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        // rows and columns cover the same pixels as GFillRect would for each region
+        const int j = y < GRoundToInt(fDstY[1]) ? 0 : (y < GRoundToInt(fDstY[2]) ? 1 : 2);
+        const GPixel* src = fBitmap.getAddr(0, sample_row(fSrcY[j], fSrcY[j + 1], fDstY[j],
+                                                          fScaleY[j], y));
+        const int stop = x + count;
+        int start = x;
+        for (int i = 0; i < 3 && start < stop; ++i) {
+            // the last column takes any pixels that remain
+            const int end = i == 2 ? stop : std::min(stop, GRoundToInt(fDstX[i + 1]));
+            if (end > start && fSrcX[i + 1] > fSrcX[i]) {
+                sample_span(src, fSrcX[i], fSrcX[i + 1], fDstX[i], fScaleX[i], start,
+                            end - start, row + (start - x));
+                start = end;
+            }
+        }
+        modulate_row(row, count, fColor);
+    }
+
+private:
+    const GBitmap fBitmap;
+    const GPixel  fColor;
+    int           fSrcX[4], fSrcY[4];
+    float         fDstX[4], fDstY[4];
+    float         fScaleX[3], fScaleY[3];
+};
+
+static GIRect clamp_to_bitmap(const GIRect& r, const GBitmap& bitmap) {
+    return GIRect::LTRB(std::max(r.left, 0), std::max(r.top, 0),
+                        std::min(r.right, bitmap.width()), std::min(r.bottom, bitmap.height()));
+}
+
+/**
+ *  Keeps a shader alive for as long as the blitter that uses it (blitters just peek at their
+ *  paint's shader).
+ */
+class ShaderOwningBlitter : public GBlitter {
+public:
+    ShaderOwningBlitter(std::shared_ptr<GShader> shader, std::unique_ptr<GBlitter> blitter)
+        : fShader(std::move(shader)), fBlitter(std::move(blitter))
+    {}
+
+    void blitRow(int x, int y, int count) override { fBlitter->blitRow(x, y, count); }
+    void blitRect(const GIRect& r) override { fBlitter->blitRect(r); }
+
+private:
+    std::shared_ptr<GShader>  fShader;
+    std::unique_ptr<GBlitter> fBlitter;
+};
+
+/**
+ *  The paint's shader (or color), scaled by a coverage that can change between blits. This lets
+ *  any blitter draw partially covered pixels (see CoverageBlitter), for the modes where that is
+ *  the same as blending the src and then mixing the result with the dst by the coverage.
+ */
+class CoverageShader : public GShader {
+public:
+    CoverageShader(std::shared_ptr<GShader> shader, GPixel color)
+        : fShader(std::move(shader)), fColor(color)
+    {}
+
+    void setCoverage(unsigned coverage) { fCoverage = coverage; }
+
+    bool isOpaque() override { return false; }
+    bool setContext(const GMatrix& ctm) override {
+        return !fShader || fShader->setContext(ctm);
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        if (fShader) {
+            fShader->shadeRow(x, y, count, row);
+        } else {
+            std::fill(row, row + count, fColor);
+        }
+        modulate_row(row, count, GPixel_PackARGB(fCoverage, fCoverage, fCoverage, fCoverage));
+    }
+
+private:
+    std::shared_ptr<GShader> fShader;
+    const GPixel             fColor;
+    unsigned                 fCoverage = 0xFF;
+};
+
+/**
+ *  Whether blending a src scaled by coverage is the same as mixing the dst with the blended src
+ *  by coverage: the mode must leave the dst unchanged under a transparent src, and be linear in
+ *  the src (darken, lighten and difference are, as scaling the src scales both sides of their
+ *  min/max).
+ */
+static bool coverage_scales_src(GBlendMode mode) {
+    switch (mode) {
+        case GBlendMode::kDst:
+        case GBlendMode::kSrcOver:
+        case GBlendMode::kDstOver:
+        case GBlendMode::kDstOut:
+        case GBlendMode::kSrcATop:
+        case GBlendMode::kXor:
+        case GBlendMode::kMultiply:
+        case GBlendMode::kScreen:
+        case GBlendMode::kDarken:
+        case GBlendMode::kLighten:
+        case GBlendMode::kDifference:
+        case GBlendMode::kExclusion:
+            return true;
+        default:
+            return false;
+    }
+}
+
+class CoverageBlitter : public GAABlitter {
+public:
+    CoverageBlitter(CoverageShader* shader, GBlitter* blitter)
+        : fShader(shader), fBlitter(blitter)
+    {}
+
+    void blitRow(int x, int y, int count) override {
+        fShader->setCoverage(0xFF);
+        fBlitter->blitRow(x, y, count);
+    }
+
+    void blitPixel(int x, int y, unsigned coverage) override {
+        fShader->setCoverage(coverage);
+        fBlitter->blitRow(x, y, 1);
+    }
+
+private:
+    CoverageShader* fShader;
+    GBlitter*       fBlitter;
+};
+
+/**
+ *  Blit the runs of (non-zero) coverage in the mask, whose top-left is at (x, y), that are
+ *  inside the clip. Cached masks are all-or-nothing (see GMaskCache::Mask), so each run is
+ *  drawn fully.
+ */
+void blit_mask(const GAlphaBitmap& mask, int x, int y, const GIRect& clip, GBlitter* blitter) {
+    const int left = std::max(clip.left - x, 0);
+    const int right = std::min(clip.right - x, mask.width());
+    const int top = std::max(clip.top - y, 0);
+    const int bottom = std::min(clip.bottom - y, mask.height());
+    for (int j = top; j < bottom; ++j) {
+        const GAlpha* row = mask.getAddr(0, j);
+        int i = left;
+        while (i < right) {
+            // skip empty space 8 pixels at a time
+            for (; i + 8 <= right; i += 8) {
+                uint64_t eight;
+                memcpy(&eight, row + i, 8);
+                if (eight != 0) {
+                    break;
+                }
+            }
+            while (i < right && row[i] == 0) {
+                i += 1;
+            }
+            const int start = i;
+            while (i < right && row[i] != 0) {
+                i += 1;
+            }
+            if (i > start) {
+                blitter->blitRow(x + start, y + j, i - start);
+            }
+        }
+    }
+}
+
+} // namespace
+
+GRasterCanvas::GRasterCanvas(int width, int height)
+    : fBounds(GIRect::WH(width, height))
+{}
+
+GRasterCanvas::~GRasterCanvas() {
+    // layers that were never restored are discarded
+    for (const Layer& layer : fLayers) {
+        if (layer.fBitmap.pixels()) {
+            gLayerPool.release(layer.fBitmap.pixels(), layer.fCapacity);
+        }
+    }
+}
+
+void GRasterCanvas::save() {
+    fSaveStack.push_back(fCTM);
+}
+
+void GRasterCanvas::restore() {
+    assert(!fSaveStack.empty());
+    fCTM = fSaveStack.back();
+    fSaveStack.pop_back();
+
+    if (!fLayers.empty() && fLayers.back().fDepth > fSaveStack.size()) {
+        const Layer layer = std::move(fLayers.back());
+        fLayers.pop_back();
+        this->drawLayer(layer);
+    }
+}
+
+void GRasterCanvas::saveLayer(const GRect* bounds, const GPaint& paint, float blurSigma) {
+    this->save();
+
+    GIRect r = this->clip();
+    if (bounds) {
+        GPoint pts[4] = {
+            { bounds->left, bounds->top }, { bounds->right, bounds->top },
+            { bounds->right, bounds->bottom }, { bounds->left, bounds->bottom },
+        };
+        fCTM.mapPoints(pts, 4);
+        GRect dev = GRect::LTRB(pts[0].x, pts[0].y, pts[0].x, pts[0].y);
+        for (const GPoint& p : pts) {
+            dev = GRect::LTRB(std::min(dev.left, p.x), std::min(dev.top, p.y),
+                              std::max(dev.right, p.x), std::max(dev.bottom, p.y));
+        }
+        // leave room for the blur to spread
+        const int outset = blurSigma > 0 ? (int)ceilf(3 * blurSigma) : 0;
+        const GIRect ir = dev.roundOut();
+        r = GIRect::LTRB(std::max(r.left, ir.left - outset), std::max(r.top, ir.top - outset),
+                         std::min(r.right, ir.right + outset),
+                         std::min(r.bottom, ir.bottom + outset));
+    }
+
+    Layer layer;
+    layer.fCapacity = 0;
+    layer.fBounds = r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r;
+    layer.fPaint = paint;
+    layer.fBlurSigma = blurSigma;
+    layer.fDepth = fSaveStack.size();
+    if (!r.isEmpty()) {
+        const size_t rowBytes = r.width() * sizeof(GPixel);
+        const size_t size = rowBytes * r.height();
+        size_t capacity;
+        auto pixels = (GPixel*)gLayerPool.acquire(size, &capacity);
+        // layers start out transparent
+        memset(pixels, 0, size);
+        layer.fBitmap.reset(r.width(), r.height(), rowBytes, pixels, GBitmap::kNo_IsOpaque);
+        layer.fCapacity = capacity;
+    }
+    fLayers.push_back(layer);
+}
+
+void GRasterCanvas::drawLayer(const Layer& layer) {
+    if (!layer.fBitmap.pixels()) {
+        return;
+    }
+    if (layer.fBlurSigma > 0) {
+        GGaussianBlur(layer.fBitmap, layer.fBitmap, layer.fBlurSigma);
+    }
+    const GIRect& r = layer.fBounds;
+    const unsigned alpha = GRoundToInt(GPinToUnit(layer.fPaint.getAlpha()) * 255);
+    GPaint paint(std::make_shared<LayerShader>(layer.fBitmap, r.left, r.top, alpha));
+    paint.setBlendMode(layer.fPaint.getBlendMode());
+    this->targetBlitter(paint)->blitRect(r);
+    gLayerPool.release(layer.fBitmap.pixels(), layer.fCapacity);
+}
+
+std::unique_ptr<GBlitter> GRasterCanvas::targetBlitter(const GPaint& paint) {
+    if (fLayers.empty()) {
+        return this->makeBlitter(paint);
+    }
+    const Layer& layer = fLayers.back();
+    return std::unique_ptr<GBlitter>(new LayerBlitter(layer.fBitmap, layer.fBounds.left,
+                                                      layer.fBounds.top, paint));
+}
+
+void GRasterCanvas::concat(const GMatrix& matrix) {
+    fCTM = fCTM * matrix;
+}
+
+std::unique_ptr<GBlitter> GRasterCanvas::prepare(const GPaint& paint) {
+    if (this->clip().isEmpty()) {
+        return nullptr;
+    }
+    if (GColorFilter* filter = paint.peekColorFilter()) {
+        GPaint filtered(paint);
+        filtered.setColorFilter(nullptr);
+        if (!paint.peekShader()) {
+            // a solid color is filtered once, up front
+            filtered.setColor(filter->filterColor(paint.getColor().pinToUnit()));
+            return this->prepare(filtered);
+        }
+        auto shader = GCreateColorFilterShader(paint.shareShader(), paint.shareColorFilter());
+        filtered.setShader(shader);
+        if (auto blitter = this->prepare(filtered)) {
+            return std::unique_ptr<GBlitter>(new ShaderOwningBlitter(shader, std::move(blitter)));
+        }
+        return nullptr;
+    }
+    if (GShader* shader = paint.peekShader()) {
+        if (!shader->setContext(fCTM)) {
+            return nullptr;
+        }
+    }
+    return this->targetBlitter(paint);
+}
+
+void GRasterCanvas::clear(const GColor& color) {
+    if (this->clip().isEmpty()) {
+        return;
+    }
+    GPaint paint(color);
+    paint.setBlendMode(GBlendMode::kSrc);
+    this->targetBlitter(paint)->blitRect(this->clip());
+}
+
+void GRasterCanvas::drawBitmapRect(const GBitmap& bitmap, const GIRect& src, const GRect& dst,
+                                   const GPaint& paint) {
+    if (fCTM[1] != 0 || fCTM[2] != 0 || fCTM[0] <= 0 || fCTM[3] <= 0) {
+        // rotated, skewed or flipped: sample through a bitmap shader
+        GCanvas::drawBitmapRect(bitmap, src, dst, paint);
+        return;
+    }
+    const GIRect r = clamp_to_bitmap(src, bitmap);
+    if (r.isEmpty() || dst.isEmpty() || !bitmap.pixels()) {
+        return;
+    }
+
+    // just scale and translate, so dst is still a rect in device space
+    const GRect device = GRect::LTRB(fCTM[0] * dst.left + fCTM[4], fCTM[3] * dst.top + fCTM[5],
+                                     fCTM[0] * dst.right + fCTM[4],
+                                     fCTM[3] * dst.bottom + fCTM[5]);
+    const GPixel color = GColorToPixel({1, 1, 1, paint.getAlpha()});
+    auto shader = std::make_shared<BitmapRectShader>(
+            bitmap, bitmap.isOpaque() && GPixel_GetA(color) == 0xFF);
+    shader->set(r, device, color);
+    GPaint p(paint);
+    p.setShader(shader);
+    if (auto blitter = this->prepare(p)) {
+        GFillRect(device, this->clip(), blitter.get());
+    }
+}
+
+void GRasterCanvas::drawAtlas(const GBitmap& atlas, const GIRect src[], const GMatrix xforms[],
+                              const GColor colors[], int count, const GPaint& paint) {
+    if (count <= 0 || !atlas.pixels()) {
+        return;
+    }
+    struct Sprite {
+        GIRect fSrc;
+        GRect  fDevice;
+        GPixel fColor;
+    };
+    std::vector<Sprite> sprites;
+    sprites.reserve(count);
+
+    const float alpha = GPinToUnit(paint.getAlpha());
+    bool isOpaque = atlas.isOpaque();
+    for (int i = 0; i < count; ++i) {
+        const GMatrix& m = xforms[i];
+        if (fCTM[1] != 0 || fCTM[2] != 0 || m[1] != 0 || m[2] != 0 ||
+            fCTM[0] * m[0] <= 0 || fCTM[3] * m[3] <= 0) {
+            // some sprite is rotated, skewed or flipped: draw them each through a shader
+            GCanvas::drawAtlas(atlas, src, xforms, colors, count, paint);
+            return;
+        }
+        const GIRect r = clamp_to_bitmap(src[i], atlas);
+        if (r.isEmpty()) {
+            continue;
+        }
+        // the sprite's rect, mapped by the CTM and its xform (both just scale and translate)
+        const float sx = fCTM[0] * m[0], sy = fCTM[3] * m[3];
+        const float tx = fCTM[0] * m[4] + fCTM[4], ty = fCTM[3] * m[5] + fCTM[5];
+        GColor c = colors ? colors[i].pinToUnit() : GColor{1, 1, 1, 1};
+        c.a *= alpha;
+        const GPixel color = GColorToPixel(c);
+        isOpaque &= GPixel_GetA(color) == 0xFF;
+        sprites.push_back({ r, GRect::LTRB(tx, ty, tx + sx * src[i].width(),
+                                           ty + sy * src[i].height()), color });
+    }
+
+    // Visit the sprites top to bottom (and left to right), so that the dst is written in order,
+    // rather than jumping around it. That is only safe if no two sprites overlap.
+    std::vector<Sprite> sorted(sprites);
+    std::sort(sorted.begin(), sorted.end(), [](const Sprite& a, const Sprite& b) {
+        return a.fDevice.top < b.fDevice.top ||
+               (a.fDevice.top == b.fDevice.top && a.fDevice.left < b.fDevice.left);
+    });
+    bool overlaps = false;
+    std::vector<const Sprite*> active;      // the sprites still spanning the current top
+    for (const Sprite& s : sorted) {
+        const GRect& d = s.fDevice;
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const Sprite* a) {
+            return a->fDevice.bottom <= d.top;
+        }), active.end());
+        for (const Sprite* a : active) {
+            overlaps |= a->fDevice.left < d.right && d.left < a->fDevice.right;
+        }
+        if (overlaps) {
+            break;
+        }
+        active.push_back(&s);
+    }
+    if (!overlaps) {
+        sprites.swap(sorted);
+    }
+
+    // one shader and blitter for all of the sprites
+    auto shader = std::make_shared<BitmapRectShader>(atlas, isOpaque);
+    GPaint p(paint);
+    p.setShader(shader);
+    auto blitter = this->prepare(p);
+    if (!blitter) {
+        return;
+    }
+    for (const Sprite& s : sprites) {
+        shader->set(s.fSrc, s.fDevice, s.fColor);
+        GFillRect(s.fDevice, this->clip(), blitter.get());
+    }
+}
+
+void GRasterCanvas::drawBitmapNine(const GBitmap& bitmap, const GIRect& center, const GRect& dst,
+                                   const GPaint& paint) {
+    if (fCTM[1] != 0 || fCTM[2] != 0 || fCTM[0] <= 0 || fCTM[3] <= 0) {
+        GCanvas::drawBitmapNine(bitmap, center, dst, paint);
+        return;
+    }
+    int srcX[4], srcY[4];
+    float dstX[4], dstY[4];
+    if (!ComputeNineGrid(bitmap, center, dst, srcX, srcY, dstX, dstY)) {
+        return;
+    }
+    // just scale and translate, so the grid's edges map independently into device space
+    for (int i = 0; i < 4; ++i) {
+        dstX[i] = fCTM[0] * dstX[i] + fCTM[4];
+        dstY[i] = fCTM[3] * dstY[i] + fCTM[5];
+    }
+
+    // one shader for all nine regions, so each row is set up once
+    GPaint p(paint);
+    p.setShader(std::make_shared<NineShader>(bitmap, srcX, srcY, dstX, dstY,
+                                             GColorToPixel({1, 1, 1, paint.getAlpha()})));
+    if (auto blitter = this->prepare(p)) {
+        GFillRect(GRect::LTRB(dstX[0], dstY[0], dstX[3], dstY[3]), this->clip(), blitter.get());
+    }
+}
+
+void GRasterCanvas::drawRect(const GRect& rect, const GPaint& paint) {
+    GPoint pts[4] = {
+        { rect.left, rect.top }, { rect.right, rect.top },
+        { rect.right, rect.bottom }, { rect.left, rect.bottom },
+    };
+    fCTM.mapPoints(pts, 4);
+
+    if (fCTM[1] == 0 && fCTM[2] == 0) {
+        // still a rectangle in device space, just possibly flipped
+        if (auto blitter = this->prepare(paint)) {
+            GFillRect(GRect::LTRB(std::min(pts[0].x, pts[2].x), std::min(pts[0].y, pts[2].y),
+                                  std::max(pts[0].x, pts[2].x), std::max(pts[0].y, pts[2].y)),
+                      this->clip(), blitter.get());
+        }
+        return;
+    }
+    if (auto blitter = this->prepare(paint)) {
+        GFillConvexPolygon(pts, 4, this->clip(), blitter.get());
+    }
+}
+
+void GRasterCanvas::drawConvexPolygon(const GPoint src[], int count, const GPaint& paint) {
+    if (count < 3) {
+        return;
+    }
+    std::vector<GPoint> pts(count);
+    fCTM.mapPoints(pts.data(), src, count);
+    if (auto blitter = this->prepare(paint)) {
+        GFillConvexPolygon(pts.data(), count, this->clip(), blitter.get());
+    }
+}
+
+// How far (in pixels) a path may be from the ellipse that is drawn in its place
+static constexpr float kMaxOvalDeviceError = 1.0f / 8;
+
+void GRasterCanvas::drawPath(const GPath& path, const GPaint& paint) {
+    if (paint.getStyle() == GPaintStyle::kStroke) {
+        GPaint fill(paint);
+        fill.setStyle(GPaintStyle::kFill);
+        if (paint.getStrokeWidth() > 0) {
+            if (auto stroke = GStrokePath(path, paint.getStrokeWidth(), paint.getStrokeJoin(),
+                                          paint.getStrokeCap(), paint.getMiterLimit())) {
+                // a new path each time, so it is not worth caching its mask
+                this->fillPath(*stroke, fill);
+            }
+        } else if (auto blitter = this->prepare(fill)) {
+            GFillHairlinePath(*path.transform(fCTM), this->clip(), blitter.get());
+        }
+        return;
+    }
+    if (!path.isInverseFillType()) {
+        // the path's cached properties let us skip it, or fill it as a simpler shape
+        const GRect& b = path.cachedBounds();
+        GPoint corners[] = {{b.left, b.top}, {b.right, b.top}, {b.right, b.bottom},
+                            {b.left, b.bottom}};
+        fCTM.mapPoints(corners, 4);
+        GRect device = GRect::LTRB(corners[0].x, corners[0].y, corners[0].x, corners[0].y);
+        for (GPoint p : corners) {
+            device.left = std::min(device.left, p.x);
+            device.top = std::min(device.top, p.y);
+            device.right = std::max(device.right, p.x);
+            device.bottom = std::max(device.bottom, p.y);
+        }
+        const GIRect clip = this->clip();
+        // (written so that NaNs are not rejected)
+        if (device.right <= clip.left || device.left >= clip.right ||
+            device.bottom <= clip.top || device.top >= clip.bottom) {
+            return;
+        }
+        if (fCTM[1] == 0 && fCTM[2] == 0) {
+            // a scale and translate keep rects and ovals axis-aligned
+            if (path.isRect()) {
+                if (auto blitter = this->prepare(paint)) {
+                    GFillRect(device, clip, blitter.get());
+                }
+                return;
+            }
+            // only if drawing the ellipse instead moves its edges by a fraction of a pixel
+            float error;
+            if (path.isOval(nullptr, &error) &&
+                    error * std::max(std::abs(fCTM[0]), std::abs(fCTM[3])) <= kMaxOvalDeviceError) {
+                if (auto blitter = this->prepare(paint)) {
+                    GFillRRect(device, device.width() * 0.5f, device.height() * 0.5f, clip,
+                               blitter.get());
+                }
+                return;
+            }
+        }
+    }
+    if (fMaskCache) {
+        int x, y;
+        if (auto mask = fMaskCache->get(path, fCTM, &x, &y)) {
+            if (auto blitter = this->prepare(paint)) {
+                blit_mask(mask->fBitmap, x, y, this->clip(), blitter.get());
+            }
+            return;
+        }
+    }
+    this->fillPath(path, paint);
+}
+
+void GRasterCanvas::fillPath(const GPath& path, const GPaint& paint) {
+    auto devPath = path.transform(fCTM);
+    if (auto blitter = this->prepare(paint)) {
+        GFillPath(*devPath, this->clip(), blitter.get(), fFillEngine);
+    }
+}
+
+void GRasterCanvas::drawLines(const GPoint src[], int count, const GPaint& paint) {
+    count &= ~1;
+    if (count <= 0) {
+        return;
+    }
+    const float width = paint.getStrokeWidth();
+    if (width > 0) {
+        auto blitter = this->prepare(paint);
+        if (!blitter) {
+            return;
+        }
+        const bool rectStaysRect = fCTM[1] == 0 && fCTM[2] == 0;
+        const float radius = width * 0.5f;
+        for (int i = 0; i < count; i += 2) {
+            const GPoint a = src[i], b = src[i + 1];
+            const GPoint v = b - a;
+            const float length = v.length();
+            if (length == 0) {
+                continue;
+            }
+            const GPoint n = { -v.y * radius / length, v.x * radius / length };
+            GPoint quad[] = { a + n, b + n, b - n, a - n };
+            fCTM.mapPoints(quad, 4);
+            if (rectStaysRect && (a.x == b.x || a.y == b.y)) {
+                // an axis-aligned line is still a rect in device space
+                GFillRect(GRect::LTRB(std::min(quad[0].x, quad[2].x),
+                                      std::min(quad[0].y, quad[2].y),
+                                      std::max(quad[0].x, quad[2].x),
+                                      std::max(quad[0].y, quad[2].y)),
+                          this->clip(), blitter.get());
+            } else {
+                GFillConvexPolygon(quad, 4, this->clip(), blitter.get());
+            }
+        }
+        return;
+    }
+
+    // hairlines are one pixel wide in device space
+    std::vector<GPoint> pts(count);
+    fCTM.mapPoints(pts.data(), src, count);
+    if (!paint.isAntiAlias() || !coverage_scales_src(paint.getBlendMode())) {
+        if (auto blitter = this->prepare(paint)) {
+            for (int i = 0; i < count; i += 2) {
+                GFillHairline(pts[i], pts[i + 1], this->clip(), blitter.get());
+            }
+        }
+        return;
+    }
+
+    // Partially covered pixels are drawn with the paint's shader (or color) scaled by their
+    // coverage, so its color filter is applied first.
+    std::shared_ptr<GShader> inner = paint.shareShader();
+    GColor color = paint.getColor().pinToUnit();
+    if (GColorFilter* filter = paint.peekColorFilter()) {
+        if (inner) {
+            inner = GCreateColorFilterShader(inner, paint.shareColorFilter());
+        } else {
+            color = filter->filterColor(color);
+        }
+    }
+    auto shader = std::make_shared<CoverageShader>(inner, GColorToPixel(color));
+    GPaint p(paint);
+    p.setShader(shader);
+    p.setColorFilter(nullptr);
+    if (auto blitter = this->prepare(p)) {
+        CoverageBlitter aa(shader.get(), blitter.get());
+        for (int i = 0; i < count; i += 2) {
+            GFillHairlineAA(pts[i], pts[i + 1], this->clip(), &aa);
+        }
+    }
+}
+
+void GRasterCanvas::drawRRect(const GRect& rect, float rx, float ry, const GPaint& paint) {
+    if (fCTM[1] != 0 || fCTM[2] != 0) {
+        // rotated or skewed: the corners are no longer axis-aligned ellipses
+        GCanvas::drawRRect(rect, rx, ry, paint);
+        return;
+    }
+    rx = std::min(std::max(rx, 0.0f), rect.width() * 0.5f);
+    ry = std::min(std::max(ry, 0.0f), rect.height() * 0.5f);
+    const float x0 = fCTM[0] * rect.left + fCTM[4], x1 = fCTM[0] * rect.right + fCTM[4];
+    const float y0 = fCTM[3] * rect.top + fCTM[5], y1 = fCTM[3] * rect.bottom + fCTM[5];
+    if (auto blitter = this->prepare(paint)) {
+        GFillRRect(GRect::LTRB(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1),
+                               std::max(y0, y1)),
+                   rx * std::abs(fCTM[0]), ry * std::abs(fCTM[3]), this->clip(), blitter.get());
+    }
+}
+
+static GMatrix basis(const GPoint pts[3]) {
+    return GMatrix(pts[1] - pts[0], pts[2] - pts[0], pts[0]);
+}
+
+void GRasterCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                             int count, const int indices[], const GPaint& paint) {
+    GShader* shader = paint.peekShader();
+    if (!shader) {
+        texs = nullptr;     // nothing to sample
+    }
+
+    int n = 0;
+    for (int i = 0; i < count; ++i, n += 3) {
+        const GPoint pts[3] = {
+            verts[indices[n + 0]], verts[indices[n + 1]], verts[indices[n + 2]],
+        };
+
+        std::unique_ptr<GShader> colorShader, texShader, modulate;
+        GShader* triShader = nullptr;
+        if (colors) {
+            const GColor c[3] = {
+                colors[indices[n + 0]], colors[indices[n + 1]], colors[indices[n + 2]],
+            };
+            colorShader.reset(new TriColorShader(pts, c));
+            triShader = colorShader.get();
+        }
+        if (texs) {
+            const GPoint t[3] = {
+                texs[indices[n + 0]], texs[indices[n + 1]], texs[indices[n + 2]],
+            };
+            auto inv = basis(t).invert();
+            if (!inv) {
+                continue;   // degenerate texture coordinates
+            }
+            texShader.reset(new ProxyShader(shader, basis(pts) * *inv));
+            triShader = texShader.get();
+        }
+        if (colorShader && texShader) {
+            modulate.reset(new ModulateShader(colorShader.get(), texShader.get()));
+            triShader = modulate.get();
+        }
+
+        if (triShader) {
+            GPaint p(paint);
+            p.setShader(std::make_shared<UnownedShader>(triShader));
+            this->drawConvexPolygon(pts, 3, p);
+        } else {
+            this->drawConvexPolygon(pts, 3, paint);
+        }
+    }
+}
+
+template <typename T> T bilerp(const T corners[4], float u, float v) {
+    return corners[0] * ((1 - u) * (1 - v)) + corners[1] * (u * (1 - v)) +
+           corners[2] * (u * v) + corners[3] * ((1 - u) * v);
+}
+
+void GRasterCanvas::drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                             int level, const GPaint& paint) {
+    const int n = level + 1;            // quads per side
+    const int stride = n + 1;           // grid points per side
+
+    std::vector<GPoint> pts, tex;
+    std::vector<GColor> clr;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            const float u = (float)i / n, v = (float)j / n;
+            pts.push_back(bilerp(verts, u, v));
+            if (colors) {
+                clr.push_back(bilerp(colors, u, v));
+            }
+            if (texs) {
+                tex.push_back(bilerp(texs, u, v));
+            }
+        }
+    }
+
+    std::vector<int> indices;
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            const int tl = j * stride + i, tr = tl + 1;
+            const int bl = tl + stride,    br = bl + 1;
+            indices.insert(indices.end(), { tl, tr, bl,  tr, br, bl });
+        }
+    }
+    this->drawMesh(pts.data(), colors ? clr.data() : nullptr, texs ? tex.data() : nullptr,
+                   2 * n * n, indices.data(), paint);
+}
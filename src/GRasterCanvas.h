@@ -0,0 +1,93 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GRasterCanvas_DEFINED
+#define GRasterCanvas_DEFINED
+
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "GRasterizer.h"
+
+/**
+ *  The format-independent part of a canvas: it tracks the CTM, turns each draw into device-space
+ *  geometry for the scan converter, and leaves it to the subclass to produce a blitter that
+ *  writes the paint into its pixels.
+ *
+ *  Layers (saveLayer) are always GBitmaps, whatever the canvas's format: drawing inside a layer
+ *  blends 8-bit premultiplied pixels, and restore() composites the layer into the canvas (or the
+ *  enclosing layer) through the subclass's blitter.
+ */
+class GRasterCanvas : public GCanvas {
+public:
+    ~GRasterCanvas() override;
+
+    void save() override;
+    void restore() override;
+    void saveLayer(const GRect* bounds, const GPaint&, float blurSigma = 0) override;
+    void concat(const GMatrix&) override;
+
+    void clear(const GColor&) override;
+    void drawRect(const GRect&, const GPaint&) override;
+    void drawConvexPolygon(const GPoint[], int count, const GPaint&) override;
+    void drawPath(const GPath&, const GPaint&) override;
+    void setMaskCache(GMaskCache* cache) override { fMaskCache = cache; }
+    void setFillEngine(GFillEngine engine) override { fFillEngine = engine; }
+    void drawLines(const GPoint[], int count, const GPaint&) override;
+    void drawRRect(const GRect&, float rx, float ry, const GPaint&) override;
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint&) override;
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint&) override;
+    void drawBitmapRect(const GBitmap&, const GIRect& src, const GRect& dst,
+                        const GPaint&) override;
+    void drawAtlas(const GBitmap& atlas, const GIRect src[], const GMatrix xforms[],
+                   const GColor colors[], int count, const GPaint&) override;
+    void drawBitmapNine(const GBitmap&, const GIRect& center, const GRect& dst,
+                        const GPaint&) override;
+
+protected:
+    GRasterCanvas(int width, int height);
+
+    /**
+     *  Return a blitter that blends the paint into the pixels, using the paint's blendmode.
+     *  If the paint has a shader, its context has already been set to the CTM.
+     */
+    virtual std::unique_ptr<GBlitter> makeBlitter(const GPaint&) = 0;
+
+    const GMatrix& ctm() const { return fCTM; }
+    const GIRect& deviceBounds() const { return fBounds; }
+
+private:
+    struct Layer {
+        GBitmap fBitmap;        // pixels come from a shared pool
+        size_t  fCapacity;      // the size of that allocation
+        GIRect  fBounds;        // where the layer's pixels go, in device space
+        GPaint  fPaint;
+        float   fBlurSigma;
+        size_t  fDepth;         // the size of fSaveStack while this layer is active
+    };
+
+    const GIRect         fBounds;
+    GMatrix              fCTM;
+    std::vector<GMatrix> fSaveStack;
+    std::vector<Layer>   fLayers;
+    GMaskCache*          fMaskCache = nullptr;
+    GFillEngine          fFillEngine = GFillEngine::kAuto;
+
+    // Everything is drawn inside this: the top layer's bounds, or the device
+    const GIRect& clip() const { return fLayers.empty() ? fBounds : fLayers.back().fBounds; }
+
+    // The blitter for the top layer, or for the canvas's pixels
+    std::unique_ptr<GBlitter> targetBlitter(const GPaint&);
+
+    // returns null if there is nothing to draw (e.g. the shader's context could not be set)
+    std::unique_ptr<GBlitter> prepare(const GPaint&);
+
+    void drawLayer(const Layer&);
+
+    // Fill the path (without consulting the mask cache)
+    void fillPath(const GPath&, const GPaint&);
+};
+
+#endif
@@ -0,0 +1,852 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "GRasterizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <math.h>
+
+void GFillRect(const GRect& rect, const GIRect& clip, GBlitter* blitter) {
+    GIRect r = rect.round();
+    r.left   = std::max(r.left,   clip.left);
+    r.top    = std::max(r.top,    clip.top);
+    r.right  = std::min(r.right,  clip.right);
+    r.bottom = std::min(r.bottom, clip.bottom);
+    if (!r.isEmpty()) {
+        blitter->blitRect(r);
+    }
+}
+
+void GFillRRect(const GRect& rect, float rx, float ry, const GIRect& clip, GBlitter* blitter) {
+    if (rx <= 0 || ry <= 0) {
+        GFillRect(rect, clip, blitter);
+        return;
+    }
+    const GIRect bounds = rect.round();
+    const int top = std::max(bounds.top, clip.top);
+    const int bottom = std::min(bounds.bottom, clip.bottom);
+    // the rows whose centers are between the corners' ellipses' centers are full width
+    const float upper = rect.top + ry, lower = rect.bottom - ry;
+    const int midTop = std::max(top, GCeilToInt(upper - 0.5f));
+    const int midBottom = std::min(bottom, GFloorToInt(lower - 0.5f) + 1);
+
+    auto span = [&](int y, float dy) {
+        const float t = dy / ry;
+        const float inset = rx * (1 - sqrtf(std::max(0.0f, 1 - t * t)));
+        const int L = std::max(GRoundToInt(rect.left + inset), clip.left);
+        const int R = std::min(GRoundToInt(rect.right - inset), clip.right);
+        if (L < R) {
+            blitter->blitRow(L, y, R - L);
+        }
+    };
+    int y = top;
+    for (; y < std::min(midTop, bottom); ++y) {
+        span(y, upper - (y + 0.5f));
+    }
+    if (midTop < midBottom) {
+        GFillRect(GRect::LTRB(rect.left, midTop, rect.right, midBottom), clip, blitter);
+        y = midBottom;
+    }
+    for (; y < bottom; ++y) {
+        span(y, std::max(0.0f, y + 0.5f - lower));
+    }
+}
+
+// Curves are approximated with lines that are within this distance (in pixels) of the curve
+constexpr float kTolerance = 0.25f;
+
+// The number of lines that approximate the quad
+static int quad_segments(const GPoint pts[3]) {
+    const GPoint a = pts[0] - 2 * pts[1] + pts[2];
+    return std::max(1, GCeilToInt(sqrtf(a.length() / (4 * kTolerance))));
+}
+
+// The number of lines that approximate the cubic
+static int cubic_segments(const GPoint pts[4]) {
+    const GPoint d0 = pts[0] - 2 * pts[1] + pts[2];
+    const GPoint d1 = pts[1] - 2 * pts[2] + pts[3];
+    const float d = std::max(d0.length(), d1.length());
+    return std::max(1, GCeilToInt(sqrtf(3 * d / (4 * kTolerance))));
+}
+
+// Call proc(p0, p1) for each of the lines that approximate the quad
+template <typename Proc> static void flatten_quad(const GPoint pts[3], Proc proc) {
+    const GPoint a = pts[0] - 2 * pts[1] + pts[2];
+    const int n = quad_segments(pts);
+    const GPoint b = 2 * (pts[1] - pts[0]);
+    GPoint prev = pts[0];
+    for (int i = 1; i < n; ++i) {
+        const float t = (float)i / n;
+        const GPoint curr = (a * t + b) * t + pts[0];
+        proc(prev, curr);
+        prev = curr;
+    }
+    proc(prev, pts[2]);
+}
+
+// Call proc(p0, p1) for each of the lines that approximate the cubic
+template <typename Proc> static void flatten_cubic(const GPoint pts[4], Proc proc) {
+    const int n = cubic_segments(pts);
+
+    const GPoint a = pts[3] + 3 * (pts[1] - pts[2]) - pts[0];
+    const GPoint b = 3 * (pts[2] - 2 * pts[1] + pts[0]);
+    const GPoint c = 3 * (pts[1] - pts[0]);
+    GPoint prev = pts[0];
+    for (int i = 1; i < n; ++i) {
+        const float t = (float)i / n;
+        const GPoint curr = ((a * t + b) * t + c) * t + pts[0];
+        proc(prev, curr);
+        prev = curr;
+    }
+    proc(prev, pts[3]);
+}
+
+/**
+ *  Visit the columns whose centers are in [a.x, b.x) (a line that is more vertical is visited
+ *  by rows, by swapping x and y), calling proc(major, minor) with the line's (fractional) minor
+ *  coordinate at the center of each column. Only columns inside the clip are visited.
+ */
+template <typename Proc> static void walk_hairline(GPoint a, GPoint b, const GIRect& clip,
+                                                  Proc proc) {
+    const bool xMajor = std::abs(b.x - a.x) >= std::abs(b.y - a.y);
+    if (!xMajor) {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+    }
+    if (a.x > b.x) {
+        std::swap(a, b);
+    }
+    if (a.x == b.x) {
+        return;     // no length
+    }
+    const float slope = (b.y - a.y) / (b.x - a.x);
+    const int start = std::max(GRoundToInt(a.x), xMajor ? clip.left : clip.top);
+    const int stop = std::min(GRoundToInt(b.x), xMajor ? clip.right : clip.bottom);
+    float minor = a.y + (start + 0.5f - a.x) * slope;
+    for (int i = start; i < stop; ++i) {
+        proc(i, minor, xMajor);
+        minor += slope;
+    }
+}
+
+void GFillHairline(GPoint a, GPoint b, const GIRect& clip, GBlitter* blitter) {
+    // runs of pixels in the same row are blitted together
+    int runX = 0, runY = 0, runCount = 0;
+    auto flush = [&]() {
+        if (runCount > 0) {
+            blitter->blitRow(runX, runY, runCount);
+            runCount = 0;
+        }
+    };
+    walk_hairline(a, b, clip, [&](int i, float minor, bool xMajor) {
+        const int j = GFloorToInt(minor);
+        const int x = xMajor ? i : j, y = xMajor ? j : i;
+        if (x < clip.left || x >= clip.right || y < clip.top || y >= clip.bottom) {
+            return;
+        }
+        if (runCount > 0 && y == runY && x == runX + runCount) {
+            runCount += 1;
+        } else {
+            flush();
+            runX = x;
+            runY = y;
+            runCount = 1;
+        }
+    });
+    flush();
+}
+
+void GFillHairlineAA(GPoint a, GPoint b, const GIRect& clip, GAABlitter* blitter) {
+    auto blit = [&](int i, int j, bool xMajor, unsigned coverage) {
+        const int x = xMajor ? i : j, y = xMajor ? j : i;
+        if (coverage && x >= clip.left && x < clip.right && y >= clip.top && y < clip.bottom) {
+            blitter->blitPixel(x, y, coverage);
+        }
+    };
+    walk_hairline(a, b, clip, [&](int i, float minor, bool xMajor) {
+        // split the coverage between the pixels whose centers are on either side of the line
+        const float m = minor - 0.5f;
+        const int j = GFloorToInt(m);
+        const unsigned far = GRoundToInt((m - j) * 255);
+        blit(i, j, xMajor, 255 - far);
+        blit(i, j + 1, xMajor, far);
+    });
+}
+
+void GFillHairlinePath(const GPath& path, const GIRect& clip, GBlitter* blitter) {
+    auto line = [&](GPoint p0, GPoint p1) { GFillHairline(p0, p1, clip, blitter); };
+    GPoint start = {0, 0}, last = {0, 0};
+    auto close = [&]() {
+        if (last != start) {
+            line(last, start);
+        }
+    };
+    GPoint pts[GPath::kMaxNextPoints];
+    GPath::Iter iter(path);
+    while (auto v = iter.next(pts)) {
+        switch (v.value()) {
+            case kMove:
+                close();
+                start = last = pts[0];
+                continue;
+            case kLine:  line(pts[0], pts[1]);    break;
+            case kQuad:  flatten_quad(pts, line);  break;
+            case kCubic: flatten_cubic(pts, line); break;
+        }
+        last = pts[(int)v.value()];
+    }
+    close();
+}
+
+// Split the quad (or cubic, if count is 4) at t, into pts[0..count-1] and pts[count-1..2*count-2]
+static void chop_at(const GPoint src[], int count, float t, GPoint dst[]) {
+    GPoint tmp[4];
+    std::copy(src, src + count, tmp);
+    // de Casteljau: each pass leaves one more point of each half
+    for (int i = 0; i < count; ++i) {
+        dst[i] = tmp[0];
+        dst[2 * count - 2 - i] = tmp[count - 1 - i];
+        for (int j = 0; j < count - 1 - i; ++j) {
+            tmp[j] = tmp[j] + t * (tmp[j + 1] - tmp[j]);
+        }
+    }
+}
+
+/**
+ *  Split the quad or cubic at the values of t (in (0, 1)) where its y is at an extremum, so that
+ *  each piece goes only down (or only up). Calls proc(pts) for each piece.
+ */
+template <typename Proc> static void chop_monotonic_y(const GPoint pts[], int count, Proc proc) {
+    // the roots of dy/dt = a t^2 + b t + c
+    float a, b, c;
+    if (count == 3) {
+        a = 0;
+        b = 2 * (pts[0].y - 2 * pts[1].y + pts[2].y);
+        c = 2 * (pts[1].y - pts[0].y);
+    } else {
+        a = 3 * (pts[3].y - 3 * pts[2].y + 3 * pts[1].y - pts[0].y);
+        b = 6 * (pts[2].y - 2 * pts[1].y + pts[0].y);
+        c = 3 * (pts[1].y - pts[0].y);
+    }
+    float roots[2];
+    int n = 0;
+    auto add = [&](float t) {
+        if (t > 0 && t < 1 && (n == 0 || t > roots[0])) {
+            roots[n++] = t;
+        }
+    };
+    if (a == 0) {
+        if (b != 0) {
+            add(-c / b);
+        }
+    } else {
+        const float disc = b * b - 4 * a * c;
+        if (disc >= 0) {
+            // (the numerically stable form)
+            const float q = -0.5f * (b + std::copysign(sqrtf(disc), b));
+            float t0 = q / a, t1 = q != 0 ? c / q : t0;
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            add(t0);
+            add(t1);
+        }
+    }
+
+    GPoint piece[7];
+    const GPoint* src = pts;
+    GPoint rest[4];
+    float prev = 0;
+    for (int i = 0; i < n; ++i) {
+        chop_at(src, count, (roots[i] - prev) / (1 - prev), piece);
+        proc(piece);
+        std::copy(piece + count - 1, piece + 2 * count - 1, rest);
+        src = rest;
+        prev = roots[i];
+    }
+    proc(src);
+}
+
+// Curves that are larger than this, or that need more lines than kMaxCurveSteps (which would let
+// the rounding of the differences add up to a visible error) are flattened into line edges, as
+// are curves that need only a few lines (which are then smaller, and faster to walk)
+constexpr float kMaxCurveCoordinate = 1 << 20;
+constexpr int kMinCurveSteps = 4;
+constexpr int kMaxCurveSteps = 256;
+
+namespace {
+
+/**
+ *  Steps along a quad or cubic that only goes down, one of the lines that approximate it at a
+ *  time, by forward differencing: each step only adds the differences, which are kept in fixed
+ *  point (32 fractional bits) so that they do not drift over the steps.
+ */
+class CurveStepper {
+public:
+    CurveStepper(const GPoint pts[], int count, int steps) : fRemaining(steps) {
+        fPrev = pts[0];
+        fLast = pts[count - 1];
+        fX.init(pts[0].x, pts[1].x, pts[2].x, count == 4 ? pts[3].x : 0, count, steps);
+        fY.init(pts[0].y, pts[1].y, pts[2].y, count == 4 ? pts[3].y : 0, count, steps);
+    }
+
+    // The next line, from p0 to p1. Returns false if there are no more.
+    bool next(GPoint* p0, GPoint* p1) {
+        if (fRemaining == 0) {
+            return false;
+        }
+        *p0 = fPrev;
+        if (--fRemaining == 0) {
+            *p1 = fLast;    // exactly
+        } else {
+            *p1 = { fX.step(), fY.step() };
+        }
+        fPrev = *p1;
+        return true;
+    }
+
+private:
+    // One coordinate of the curve: v(t) = A t^3 + B t^2 + C t + D, at t = i / steps
+    struct Differences {
+        int64_t fV, fD1, fD2, fD3;
+
+        void init(double p0, double p1, double p2, double p3, int count, int steps) {
+            double A = 0, B, C;
+            if (count == 3) {
+                B = p0 - 2 * p1 + p2;
+                C = 2 * (p1 - p0);
+            } else {
+                A = p3 + 3 * (p1 - p2) - p0;
+                B = 3 * (p2 - 2 * p1 + p0);
+                C = 3 * (p1 - p0);
+            }
+            const double h = 1.0 / steps, h2 = h * h, h3 = h2 * h;
+            fV  = to_fixed(p0);
+            fD1 = to_fixed(A * h3 + B * h2 + C * h);
+            fD2 = to_fixed(6 * A * h3 + 2 * B * h2);
+            fD3 = to_fixed(6 * A * h3);
+        }
+
+        float step() {
+            fV += fD1;
+            fD1 += fD2;
+            fD2 += fD3;
+            return (float)(fV * (1.0 / kOne));
+        }
+
+        static constexpr double kOne = 4294967296.0;   // 1 << 32
+        static int64_t to_fixed(double v) { return llround(v * kOne); }
+    };
+
+    Differences fX, fY;
+    GPoint      fPrev, fLast;
+    int         fRemaining;
+};
+
+struct Edge {
+    float   fX;         // x where the edge crosses the center of the current row
+    float   fDX;        // change in x per row
+    int     fTop;       // first row
+    int     fBottom;    // last row + 1
+    int     fWinding;   // +1 going down, -1 going up
+    int     fCurve;     // for the lines of a curve, the index of its CurveStepper, or -1
+};
+
+class EdgeList {
+public:
+    /**
+     *  A pixel is inside if its winding has any bit of windingMask set: ~0 for the non-zero
+     *  winding rule, 1 for even-odd.
+     */
+    EdgeList(const GIRect& clip, int windingMask = ~0) : fClip(clip), fWindingMask(windingMask) {}
+
+    // The number of lines that the edges are made of (counting each line of a curve)
+    int count() const { return fLineCount; }
+
+    void addLine(GPoint p0, GPoint p1) {
+        int winding = 1;
+        if (p0.y > p1.y) {
+            std::swap(p0, p1);
+            winding = -1;
+        }
+        int top = GRoundToInt(p0.y);
+        int bottom = GRoundToInt(p1.y);
+        if (top == bottom) {
+            return;     // does not cross the center of any row
+        }
+        const float dx = (p1.x - p0.x) / (p1.y - p0.y);
+
+        top = std::max(top, fClip.top);
+        bottom = std::min(bottom, fClip.bottom);
+        if (top >= bottom) {
+            return;
+        }
+        fEdges.push_back({ p0.x + dx * (top + 0.5f - p0.y), dx, top, bottom, winding, -1 });
+        fLineCount += 1;
+        fTop = std::min(fTop, top);
+        fBottom = std::max(fBottom, bottom);
+        fLeft = std::min(fLeft, std::min(p0.x, p1.x));
+        fRight = std::max(fRight, std::max(p0.x, p1.x));
+    }
+
+    // Curves are kept as one edge for each piece that goes only down or up (see addCurve)
+    void addQuad(const GPoint pts[3]) {
+        chop_monotonic_y(pts, 3, [this](const GPoint piece[]) { this->addCurve(piece, 3); });
+    }
+
+    void addCubic(const GPoint pts[4]) {
+        chop_monotonic_y(pts, 4, [this](const GPoint piece[]) { this->addCurve(piece, 4); });
+    }
+
+    /**
+     *  The columns that the accumulation buffer needs (see fillAccumulated), or an empty rect if
+     *  there are no edges.
+     */
+    GIRect bounds() const {
+        if (fEdges.empty()) {
+            return GIRect::LTRB(0, 0, 0, 0);
+        }
+        // (clamped in float, since the edges may be far outside of the clip)
+        const float L = std::max(fLeft, (float)fClip.left);
+        const float R = std::min(fRight, (float)fClip.right);
+        return GIRect::LTRB(GRoundToInt(std::min(L, R)), fTop, GRoundToInt(R), fBottom);
+    }
+
+    // Fill by sorting the edges that cross each row by x, and walking them in order
+    void fillSorted(GBlitter* blitter) {
+        if (fEdges.empty()) {
+            return;
+        }
+        std::sort(fEdges.begin(), fEdges.end(), [](const Edge& a, const Edge& b) {
+            return a.fTop < b.fTop;
+        });
+
+        std::vector<Edge*> active;
+        size_t next = 0;
+        int y = fEdges[0].fTop;
+        while (next < fEdges.size() || !active.empty()) {
+            if (active.empty()) {
+                y = fEdges[next].fTop;     // skip any empty rows
+            }
+            while (next < fEdges.size() && fEdges[next].fTop == y) {
+                active.push_back(&fEdges[next++]);
+            }
+
+            // Edges move only a little from row to row, so insertion sort is nearly linear here
+            for (size_t i = 1; i < active.size(); ++i) {
+                Edge* e = active[i];
+                size_t j = i;
+                for (; j > 0 && active[j - 1]->fX > e->fX; --j) {
+                    active[j] = active[j - 1];
+                }
+                active[j] = e;
+            }
+
+            int winding = 0;
+            float left = 0;
+            for (Edge* e : active) {
+                const bool wasInside = (winding & fWindingMask) != 0;
+                winding += e->fWinding;
+                const bool inside = (winding & fWindingMask) != 0;
+                if (!wasInside && inside) {
+                    left = e->fX;
+                } else if (wasInside && !inside) {
+                    this->blitSpan(left, e->fX, y, blitter);
+                }
+            }
+
+            y += 1;
+            size_t count = 0;
+            for (Edge* e : active) {
+                if (e->fBottom > y) {
+                    e->fX += e->fDX;
+                    active[count++] = e;
+                } else if (e->fCurve >= 0 && this->nextCurveLine(e, y)) {
+                    active[count++] = e;
+                }
+            }
+            active.resize(count);
+        }
+    }
+
+    /**
+     *  Fill without sorting: each edge adds its winding to the cell where it enters each row (or
+     *  to the clip's left edge), and a running sum along the row is then the winding of each
+     *  pixel. This draws exactly the same pixels as fillSorted (as long as the contours are
+     *  closed, so that the windings in each row sum to 0), but its cost does not grow with the
+     *  number of edges that cross each row, only with their lengths and the area.
+     */
+    void fillAccumulated(GBlitter* blitter) {
+        const GIRect bounds = this->bounds();
+        if (bounds.isEmpty()) {
+            return;
+        }
+        // One more column, for edges that enter a row at (or past) its right edge. The buffer is
+        // reused, and left zeroed by the pass that reads it.
+        const int left = bounds.left, right = bounds.right;
+        const int stride = bounds.width() + 1;
+        static thread_local std::vector<int> gCells;
+        if (gCells.size() < (size_t)stride * bounds.height()) {
+            gCells.assign((size_t)stride * bounds.height(), 0);
+        }
+
+        // the range of cells that were written to in each row
+        std::vector<int> first(bounds.height(), stride), last(bounds.height(), -1);
+
+        for (Edge& e : fEdges) {
+            int y = e.fTop;
+            do {
+                float x = e.fX;
+                for (; y < e.fBottom; ++y) {
+                    const int i = std::min(std::max(GRoundToInt(x), left), right) - left;
+                    const int row = y - bounds.top;
+                    gCells[row * stride + i] += e.fWinding;
+                    first[row] = std::min(first[row], i);
+                    last[row] = std::max(last[row], i);
+                    x += e.fDX;
+                }
+            } while (e.fCurve >= 0 && this->nextCurveLine(&e, y));
+        }
+
+        for (int row = 0; row < bounds.height(); ++row) {
+            int* cells = gCells.data() + row * stride;
+            int winding = 0;
+            int start = 0;
+            for (int i = first[row]; i <= last[row]; ++i) {
+                // most cells are empty: skip them 4 at a time
+                while (i + 4 <= last[row] && (cells[i] | cells[i + 1] | cells[i + 2] |
+                                              cells[i + 3]) == 0) {
+                    i += 4;
+                }
+                if (cells[i] == 0) {
+                    continue;
+                }
+                const bool wasInside = (winding & fWindingMask) != 0;
+                winding += cells[i];
+                cells[i] = 0;
+                const bool inside = (winding & fWindingMask) != 0;
+                if (!wasInside && inside) {
+                    start = i;
+                } else if (wasInside && !inside) {
+                    blitter->blitRow(left + start, bounds.top + row, i - start);
+                }
+            }
+        }
+    }
+
+private:
+    const GIRect              fClip;
+    const int                 fWindingMask;
+    std::vector<Edge>         fEdges;
+    std::vector<CurveStepper> fCurves;
+    int                       fLineCount = 0;
+    int                       fTop = INT_MAX, fBottom = INT_MIN;
+    float                     fLeft = INFINITY, fRight = -INFINITY;
+
+    /**
+     *  Add a quad or cubic (count is 3 or 4) that only goes down or up. Its edge starts as the
+     *  first of its lines that crosses a row inside the clip, and moves on to the next one as
+     *  the rows reach its end (see nextCurveLine), so that the lines are not all stored at once.
+     */
+    void addCurve(const GPoint src[], int count) {
+        const int steps = count == 3 ? quad_segments(src) : cubic_segments(src);
+        float L = src[0].x, R = src[0].x;
+        bool fits = steps > kMinCurveSteps && steps <= kMaxCurveSteps;
+        for (int i = 0; i < count; ++i) {
+            L = std::min(L, src[i].x);
+            R = std::max(R, src[i].x);
+            // (written so that NaNs fail too)
+            fits &= std::abs(src[i].x) <= kMaxCurveCoordinate &&
+                    std::abs(src[i].y) <= kMaxCurveCoordinate;
+        }
+        if (!fits) {
+            auto line = [this](GPoint p0, GPoint p1) { this->addLine(p0, p1); };
+            count == 3 ? flatten_quad(src, line) : flatten_cubic(src, line);
+            return;
+        }
+
+        GPoint pts[4];
+        std::copy(src, src + count, pts);
+        int winding = 1;
+        if (pts[0].y > pts[count - 1].y) {
+            std::reverse(pts, pts + count);
+            winding = -1;
+        }
+        const int bottom = std::min(GRoundToInt(pts[count - 1].y), fClip.bottom);
+        if (std::max(GRoundToInt(pts[0].y), fClip.top) >= bottom) {
+            return;
+        }
+
+        fCurves.emplace_back(pts, count, steps);
+        Edge e = { 0, 0, 0, 0, winding, (int)fCurves.size() - 1 };
+        if (!this->nextCurveLine(&e, fClip.top)) {
+            fCurves.pop_back();
+            return;
+        }
+        fEdges.push_back(e);
+        fLineCount += steps;
+        fTop = std::min(fTop, e.fTop);
+        fBottom = std::max(fBottom, bottom);
+        fLeft = std::min(fLeft, L);
+        fRight = std::max(fRight, R);
+    }
+
+    /**
+     *  Move the curve's edge to its next line that crosses the center of a row, starting at row
+     *  y (or below, before the edge's first row). Returns false if there are no more (inside the
+     *  clip). A line that goes up a little (where rounding makes the curve wobble) crosses no new
+     *  row, and is skipped.
+     */
+    bool nextCurveLine(Edge* e, int y) {
+        CurveStepper& curve = fCurves[e->fCurve];
+        GPoint p0, p1;
+        while (curve.next(&p0, &p1)) {
+            if (GRoundToInt(p0.y) >= fClip.bottom) {
+                return false;
+            }
+            const int top = std::max(GRoundToInt(p0.y), y);
+            const int bottom = std::min(GRoundToInt(p1.y), fClip.bottom);
+            if (top >= bottom) {
+                continue;   // does not cross the center of a row (that we have not reached)
+            }
+            const float dx = (p1.x - p0.x) / (p1.y - p0.y);
+            e->fX = p0.x + dx * (top + 0.5f - p0.y);
+            e->fDX = dx;
+            e->fTop = top;
+            e->fBottom = bottom;
+            return true;
+        }
+        return false;
+    }
+
+    void blitSpan(float left, float right, int y, GBlitter* blitter) {
+        const int L = std::max(GRoundToInt(left), fClip.left);
+        const int R = std::min(GRoundToInt(right), fClip.right);
+        if (L < R) {
+            blitter->blitRow(L, y, R - L);
+        }
+    }
+};
+
+} // namespace
+
+namespace {
+
+/**
+ *  One side of a convex polygon: its edges from the top vertex down to the bottom one, walked in
+ *  one direction (step is +1 or -1). x is kept in 32.32 fixed point, and computed for each row
+ *  from where its edge starts (rather than stepped), so rounding dx never accumulates down a tall
+ *  edge.
+ */
+class ConvexChain {
+public:
+    ConvexChain(const GPoint pts[], int count, int top, int step)
+        : fPts(pts), fCount(count), fIndex(top), fStep(step), fRemaining(count)
+    {}
+
+    // Move to the edge that crosses row y (which never decreases). Returns false if there is none.
+    bool seek(int y) {
+        while (y >= fBottom) {
+            if (fRemaining-- <= 0) {
+                return false;
+            }
+            const GPoint p0 = fPts[fIndex];
+            fIndex = (fIndex + fStep + fCount) % fCount;
+            const GPoint p1 = fPts[fIndex];
+            const int top = GRoundToInt(p0.y);
+            fBottom = GRoundToInt(p1.y);
+            if (fBottom <= top) {
+                continue;   // does not cross the center of any row
+            }
+            // (as EdgeList::addLine computes them)
+            const float dx = (p1.x - p0.x) / (p1.y - p0.y);
+            fY0 = std::max(y, top);
+            fX0 = llround((double)(p0.x + dx * (fY0 + 0.5f - p0.y)) * kOne);
+            fDX = llround((double)dx * kOne);
+        }
+        fY = y;
+        return true;
+    }
+
+    // x at the center of the current row, rounded
+    int x() const {
+        const int64_t x = fX0 + fDX * (fY - fY0);
+        return (int)((x + kOne / 2) >> 32);
+    }
+
+private:
+    const GPoint* fPts;
+    const int     fCount;
+    int           fIndex;
+    const int     fStep;
+    int           fRemaining;   // edges that have not been visited
+    int           fBottom = INT_MIN;
+    int           fY = 0;
+    int           fY0 = 0;                  // the first row of the current edge
+    int64_t       fX0 = 0, fDX = 0;         // x at the center of that row, and per row
+
+    static constexpr int64_t kOne = (int64_t)1 << 32;
+};
+
+} // namespace
+
+// Beyond this, fixed point loses too much precision, and GFillPolygon is used instead
+constexpr float kMaxConvexCoordinate = 1 << 14;
+
+void GFillConvexPolygon(const GPoint pts[], int count, const GIRect& clip, GBlitter* blitter) {
+    if (count < 3 || clip.isEmpty()) {
+        return;
+    }
+    int topIndex = 0;
+    float minY = pts[0].y, maxY = pts[0].y;
+    for (int i = 0; i < count; ++i) {
+        const GPoint p = pts[i];
+        // (written so that NaNs fail too)
+        if (!(std::abs(p.x) <= kMaxConvexCoordinate && std::abs(p.y) <= kMaxConvexCoordinate)) {
+            GFillPolygon(pts, count, clip, blitter);
+            return;
+        }
+        if (p.y < minY) {
+            minY = p.y;
+            topIndex = i;
+        }
+        maxY = std::max(maxY, p.y);
+    }
+
+    const int top = std::max(GRoundToInt(minY), clip.top);
+    const int bottom = std::min(GRoundToInt(maxY), clip.bottom);
+    ConvexChain a(pts, count, topIndex, 1), b(pts, count, topIndex, -1);
+    for (int y = top; y < bottom; ++y) {
+        if (!a.seek(y) || !b.seek(y)) {
+            break;
+        }
+        // either chain may be on the left, depending on the polygon's direction
+        const int xa = a.x(), xb = b.x();
+        const int L = std::max(std::min(xa, xb), clip.left);
+        const int R = std::min(std::max(xa, xb), clip.right);
+        if (L < R) {
+            blitter->blitRow(L, y, R - L);
+        }
+    }
+}
+
+void GFillPolygon(const GPoint pts[], int count, const GIRect& clip, GBlitter* blitter) {
+    if (count < 3 || clip.isEmpty()) {
+        return;
+    }
+    EdgeList edges(clip);
+    for (int i = 0; i < count; ++i) {
+        edges.addLine(pts[i], pts[(i + 1) % count]);
+    }
+    edges.fillSorted(blitter);
+}
+
+namespace {
+
+/**
+ *  Blits the parts of the clip that the spans it receives leave out, for inverse fill types.
+ *  The spans must arrive in order: top to bottom, and left to right within each row (as the
+ *  scan converters produce them). Call finish() after the last one.
+ */
+class InverseBlitter : public GBlitter {
+public:
+    InverseBlitter(const GIRect& clip, GBlitter* blitter)
+        : fClip(clip), fBlitter(blitter), fY(clip.top), fX(clip.left)
+    {}
+
+    void blitRow(int x, int y, int count) override {
+        this->advanceTo(y);
+        if (x > fX) {
+            fBlitter->blitRow(fX, y, x - fX);
+        }
+        fX = x + count;
+    }
+
+    void finish() { this->advanceTo(fClip.bottom); }
+
+private:
+    const GIRect fClip;
+    GBlitter*    fBlitter;
+    int          fY, fX;    // what has not been blitted yet starts at (fX, fY)
+
+    // Blit the rest of the current row, and all of the rows before y
+    void advanceTo(int y) {
+        if (y == fY) {
+            return;
+        }
+        if (fX < fClip.right) {
+            fBlitter->blitRow(fX, fY, fClip.right - fX);
+        }
+        if (fY + 1 < y) {
+            fBlitter->blitRect(GIRect::LTRB(fClip.left, fY + 1, fClip.right, y));
+        }
+        fY = y;
+        fX = fClip.left;
+    }
+};
+
+} // namespace
+
+// Accumulating wins when many edges cross each row (e.g. a long, self-intersecting path), since
+// sorting them is then the bottleneck. Its cost grows with the area instead, and its writes are
+// scattered across the buffer, so it loses to sorting when the edges are sparse.
+constexpr int kAccumulateMinEdges = 128;
+constexpr int kAccumulateMaxCellsPerEdge = 32;
+
+static void fill_path(const GPath&, const GIRect& clip, GBlitter*, GFillEngine);
+
+void GFillPath(const GPath& path, const GIRect& clip, GBlitter* blitter, GFillEngine engine) {
+    if (clip.isEmpty()) {
+        return;
+    }
+    if (path.isInverseFillType()) {
+        InverseBlitter inverse(clip, blitter);
+        fill_path(path, clip, &inverse, engine);
+        inverse.finish();
+    } else {
+        fill_path(path, clip, blitter, engine);
+    }
+}
+
+static void fill_path(const GPath& path, const GIRect& clip, GBlitter* blitter,
+                      GFillEngine engine) {
+    if (engine == GFillEngine::kAuto && path.isConvex()) {
+        // a single contour of lines
+        std::vector<GPoint> poly;
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Iter iter(path);
+        while (auto v = iter.next(pts)) {
+            poly.push_back(v.value() == kMove ? pts[0] : pts[1]);
+        }
+        GFillConvexPolygon(poly.data(), (int)poly.size(), clip, blitter);
+        return;
+    }
+
+    const bool evenOdd = path.fillType() == GPathFillType::kEvenOdd ||
+                         path.fillType() == GPathFillType::kInverseEvenOdd;
+    EdgeList edges(clip, evenOdd ? 1 : ~0);
+    GPoint pts[GPath::kMaxNextPoints];
+    GPath::Edger edger(path);
+    while (auto v = edger.next(pts)) {
+        switch (v.value()) {
+            case kLine:  edges.addLine(pts[0], pts[1]); break;
+            case kQuad:  edges.addQuad(pts);            break;
+            case kCubic: edges.addCubic(pts);           break;
+            default: break;
+        }
+    }
+    if (engine == GFillEngine::kAuto) {
+        const GIRect bounds = edges.bounds();
+        const size_t cells = (size_t)(bounds.width() + 1) * bounds.height();
+        engine = edges.count() >= kAccumulateMinEdges &&
+                 cells <= (size_t)edges.count() * kAccumulateMaxCellsPerEdge
+                 ? GFillEngine::kAccumulate : GFillEngine::kEdgeList;
+    }
+    if (engine == GFillEngine::kAccumulate) {
+        edges.fillAccumulated(blitter);
+    } else {
+        edges.fillSorted(blitter);
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#ifndef GRasterizer_DEFINED
+#define GRasterizer_DEFINED
+
+#include "../include/GCanvas.h"
+#include "../include/GPath.h"
+#include "../include/GPoint.h"
+#include "../include/GRect.h"
+
+/**
+ *  Receives the output of the scan converter: horizontal runs of pixels, always inside the
+ *  clip that was passed to the fill functions below.
+ */
+class GBlitter {
+public:
+    virtual ~GBlitter() {}
+
+    virtual void blitRow(int x, int y, int count) = 0;
+
+    /**
+     *  Fill the rectangle. Subclasses may override this if they have a faster way than blitting
+     *  each row individually.
+     */
+    virtual void blitRect(const GIRect& r) {
+        for (int y = r.top; y < r.bottom; ++y) {
+            this->blitRow(r.left, y, r.width());
+        }
+    }
+};
+
+/**
+ *  A blitter that can also draw a pixel partially, with coverage 0...255.
+ */
+class GAABlitter : public GBlitter {
+public:
+    virtual void blitPixel(int x, int y, unsigned coverage) = 0;
+};
+
+/**
+ *  The scan converters draw a pixel if its center is inside the geometry, i.e.
+ *      left <= center.x < right   and   top <= center.y < bottom
+ *  so that abutting shapes never draw the same pixel twice, nor leave a gap between them.
+ *
+ *  The points (already transformed into device space) are clipped to clip.
+ */
+
+/**
+ *  Fill the (non-empty) intersection of rect and clip.
+ */
+void GFillRect(const GRect& rect, const GIRect& clip, GBlitter*);
+
+/**
+ *  Fill the rect with its corners rounded by quarter-ellipses with radii rx and ry (each at most
+ *  half of the rect's size). Each row's span is computed directly from the ellipse (one sqrt per
+ *  row), rather than by walking edges.
+ */
+void GFillRRect(const GRect& rect, float rx, float ry, const GIRect& clip, GBlitter*);
+
+/**
+ *  Draw a hairline from a to b: in each column (or row, if the line is more vertical than
+ *  horizontal) whose center is between them, the pixel that the line crosses at that center.
+ */
+void GFillHairline(GPoint a, GPoint b, const GIRect& clip, GBlitter*);
+
+/**
+ *  Draw an antialiased hairline (Wu's algorithm): in each column (or row) between a and b, the
+ *  two pixels nearest to the line, each covered in proportion to how close it is.
+ */
+void GFillHairlineAA(GPoint a, GPoint b, const GIRect& clip, GAABlitter*);
+
+/**
+ *  Draw each segment of the path as a hairline (curves are approximated by lines). As when
+ *  filling, each contour is closed: a hairline is drawn back to its first point, if it does not
+ *  end there.
+ */
+void GFillHairlinePath(const GPath&, const GIRect& clip, GBlitter*);
+
+/**
+ *  Fill the closed polygon, using the non-zero winding rule.
+ */
+void GFillPolygon(const GPoint pts[], int count, const GIRect& clip, GBlitter*);
+
+/**
+ *  Fill the closed polygon, which must be convex: each row then crosses exactly two of its edges,
+ *  so this just walks the two chains of edges down from its top vertex (in fixed point), with no
+ *  sorting or winding. Draws the same pixels as GFillPolygon, except where an edge passes within
+ *  a rounding error of a pixel's center (GFillPolygon steps x down each edge in float, so on a
+ *  tall edge it can drift by a small fraction of a pixel; this computes x for each row from the
+ *  edge's start).
+ */
+void GFillConvexPolygon(const GPoint pts[], int count, const GIRect& clip, GBlitter*);
+
+/**
+ *  Fill the path, using its fill type (an inverse fill type fills the rest of the clip). Curves
+ *  are approximated by line segments, which each edge steps through (by forward differencing)
+ *  as the rows reach them, rather than storing them all. Either engine draws the same pixels
+ *  (see GFillEngine); kAuto chooses by the number of edges and the size of their bounds,
+ *  preferring the accumulation buffer when the edges are dense. kAuto fills a convex path (see
+ *  GPath::isConvex) with GFillConvexPolygon.
+ */
+void GFillPath(const GPath&, const GIRect& clip, GBlitter*,
+               GFillEngine = GFillEngine::kAuto);
+
+#endif
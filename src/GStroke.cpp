@@ -0,0 +1,364 @@
+/**
+ *  Copyright 2024 Mike Reed
+ */
+
+#include "../include/GStroke.h"
+#include "../include/GPathBuilder.h"
+
+#include <cmath>
+
+namespace {
+
+// Offset curves are approximated by quads that are within this distance of them
+constexpr float kTolerance = 0.25f;
+// Each curve is split into at most 2^kMaxDepth quads (on each side)
+constexpr int kMaxDepth = 6;
+
+float dot(GVector a, GVector b) { return a.x * b.x + a.y * b.y; }
+float cross(GVector a, GVector b) { return a.x * b.y - a.y * b.x; }
+GVector normalize(GVector v) { return v * (1 / v.length()); }
+
+// The unit normal to the left of the (unit) tangent
+GVector normal(GVector t) { return { -t.y, t.x }; }
+
+// One line or curve of a contour
+struct Segment {
+    GPathVerb fVerb;
+    GPoint    fPts[4];
+
+    int degree() const { return fVerb == kLine ? 1 : (fVerb == kQuad ? 2 : 3); }
+    GPoint start() const { return fPts[0]; }
+    GPoint end() const { return fPts[this->degree()]; }
+
+    bool isDegenerate() const {
+        for (int i = 1; i <= this->degree(); ++i) {
+            if (fPts[i] != fPts[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    GPoint eval(float t) const {
+        const GPoint* p = fPts;
+        const float s = 1 - t;
+        switch (fVerb) {
+            case kLine:  return s * p[0] + t * p[1];
+            case kQuad:  return s * s * p[0] + 2 * s * t * p[1] + t * t * p[2];
+            default:
+                return s * s * s * p[0] + 3 * s * s * t * p[1] + 3 * s * t * t * p[2] +
+                       t * t * t * p[3];
+        }
+    }
+
+    // The unit tangent at t (falling back to a nearby direction where the derivative is 0)
+    GVector tangent(float t) const {
+        const GPoint* p = fPts;
+        const float s = 1 - t;
+        GVector d;
+        switch (fVerb) {
+            case kLine:  d = p[1] - p[0]; break;
+            case kQuad:  d = s * (p[1] - p[0]) + t * (p[2] - p[1]); break;
+            default:     d = s * s * (p[1] - p[0]) + 2 * s * t * (p[2] - p[1]) +
+                             t * t * (p[3] - p[2]); break;
+        }
+        if (d.length() > 1e-6f) {
+            return normalize(d);
+        }
+        const int n = this->degree();
+        if (t <= 0) {
+            for (int i = 1; i <= n; ++i) {
+                if (p[i] != p[0]) {
+                    return normalize(p[i] - p[0]);
+                }
+            }
+        } else if (t >= 1) {
+            for (int i = n - 1; i >= 0; --i) {
+                if (p[i] != p[n]) {
+                    return normalize(p[n] - p[i]);
+                }
+            }
+        }
+        // a cusp: the direction it leaves in
+        return normalize(this->eval(std::min(1.0f, t + 1e-3f)) -
+                         this->eval(std::max(0.0f, t - 1e-3f)));
+    }
+};
+
+/**
+ *  Calls proc(control, end) for the quads that approximate the arc around center (of radius r)
+ *  from center + r*u0 to center + r*u1, turning in the direction that heads towards via.
+ */
+template <typename Proc> void arc(GPoint center, float r, GVector u0, GVector u1, GVector via,
+                                  Proc proc) {
+    float sweep = atan2f(cross(u0, u1), dot(u0, u1));
+    if (cross(u0, via) >= 0) {
+        if (sweep <= 0) {
+            sweep += 2 * gFloatPI;
+        }
+    } else if (sweep >= 0) {
+        sweep -= 2 * gFloatPI;
+    }
+    // at most 45 degrees per quad
+    const int n = std::max(1, GCeilToInt(std::abs(sweep) / (gFloatPI / 4)));
+    const float step = sweep / n;
+    const float c = cosf(step), s = sinf(step);
+    const float hc = cosf(step / 2), hs = sinf(step / 2);
+    auto rotate = [](GVector v, float c, float s) {
+        return GVector{ v.x * c - v.y * s, v.x * s + v.y * c };
+    };
+    GVector u = u0;
+    for (int i = 0; i < n; ++i) {
+        const GVector next = i == n - 1 ? u1 : rotate(u, c, s);
+        proc(center + rotate(u, hc, hs) * (r / hc), center + r * next);
+        u = next;
+    }
+}
+
+// One side of a contour's stroke: its edges, in the order that the contour is traced
+class Side {
+public:
+    void start(GPoint p) {
+        fPts = { p };
+        fVerbs.clear();
+    }
+    GPoint first() const { return fPts.front(); }
+    GPoint last() const { return fPts.back(); }
+
+    void lineTo(GPoint p) {
+        if (p != fPts.back()) {
+            fPts.push_back(p);
+            fVerbs.push_back(kLine);
+        }
+    }
+    void quadTo(GPoint c, GPoint p) {
+        fPts.push_back(c);
+        fPts.push_back(p);
+        fVerbs.push_back(kQuad);
+    }
+
+    // Append the edges, from first() to last(), to the builder (whose last point is first())
+    void appendForwards(GPathBuilder* bu) const {
+        size_t i = 1;
+        for (GPathVerb v : fVerbs) {
+            if (v == kLine) {
+                bu->lineTo(fPts[i]);
+                i += 1;
+            } else {
+                bu->quadTo(fPts[i], fPts[i + 1]);
+                i += 2;
+            }
+        }
+    }
+
+    // Append the edges, from last() back to first(), to the builder (whose last point is last())
+    void appendBackwards(GPathBuilder* bu) const {
+        size_t i = fPts.size() - 1;
+        for (auto v = fVerbs.rbegin(); v != fVerbs.rend(); ++v) {
+            if (*v == kLine) {
+                bu->lineTo(fPts[i - 1]);
+                i -= 1;
+            } else {
+                bu->quadTo(fPts[i - 1], fPts[i - 2]);
+                i -= 2;
+            }
+        }
+    }
+
+private:
+    std::vector<GPoint>    fPts;
+    std::vector<GPathVerb> fVerbs;
+};
+
+class Stroker {
+public:
+    Stroker(float width, GStrokeJoin join, GStrokeCap cap, float miterLimit)
+        : fRadius(width * 0.5f), fJoin(join), fCap(cap), fMiterLimit(miterLimit)
+    {}
+
+    std::shared_ptr<GPath> stroke(const GPath& src) {
+        std::vector<Segment> segments;
+        GPoint start = {0, 0};
+        bool inContour = false;
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Iter iter(src);
+        while (auto v = iter.next(pts)) {
+            if (v.value() == kMove) {
+                if (inContour) {
+                    this->strokeContour(&segments, start);
+                }
+                segments.clear();
+                start = pts[0];
+                inContour = true;
+                continue;
+            }
+            Segment seg = { v.value(), {} };
+            std::copy(pts, pts + seg.degree() + 1, seg.fPts);
+            if (!seg.isDegenerate()) {
+                segments.push_back(seg);
+            }
+        }
+        if (inContour) {
+            this->strokeContour(&segments, start);
+        }
+        return fBuilder.detach();
+    }
+
+private:
+    const float       fRadius;
+    const GStrokeJoin fJoin;
+    const GStrokeCap  fCap;
+    const float       fMiterLimit;
+    GPathBuilder      fBuilder;
+    Side              fLeft, fRight;
+
+    // Stroke the contour, closing it first (as filling it would) if it does not end at start
+    void strokeContour(std::vector<Segment>* contour, GPoint start) {
+        if (!contour->empty() && contour->back().end() != start) {
+            contour->push_back({ kLine, { contour->back().end(), start } });
+        }
+        const std::vector<Segment>& segments = *contour;
+        if (segments.empty()) {
+            // a contour with no length only shows its caps, around its point
+            if (fCap != GStrokeCap::kButt) {
+                fBuilder.moveTo(start + GVector{0, fRadius});
+                this->addCap(start, {1, 0}, {0, 1});
+                this->addCap(start, {-1, 0}, {0, -1}, true);
+            }
+            return;
+        }
+        const float r = fRadius;
+        const GVector firstT = segments.front().tangent(0);
+        fLeft.start(start + r * normal(firstT));
+        fRight.start(start - r * normal(firstT));
+
+        GVector prevT = firstT;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const Segment& seg = segments[i];
+            if (i > 0) {
+                this->addJoins(seg.start(), prevT, seg.tangent(0));
+            }
+            this->addOffsets(seg);
+            prevT = seg.tangent(1);
+        }
+
+        // each side becomes its own contour, in opposite directions
+        this->addJoins(start, prevT, firstT);
+        fBuilder.moveTo(fLeft.first());
+        fLeft.appendForwards(&fBuilder);
+        fBuilder.moveTo(fRight.last());
+        fRight.appendBackwards(&fBuilder);
+    }
+
+    // Continue from p + r*u around to p - r*u, out in the direction t. If this closes the
+    // contour, its last line is left implicit.
+    void addCap(GPoint p, GVector t, GVector u, bool closes = false) {
+        const float r = fRadius;
+        switch (fCap) {
+            case GStrokeCap::kButt:
+                break;
+            case GStrokeCap::kSquare:
+                fBuilder.lineTo(p + r * (u + t));
+                fBuilder.lineTo(p + r * (t - u));
+                break;
+            case GStrokeCap::kRound:
+                arc(p, r, u, u * -1, t, [&](GPoint c, GPoint e) { fBuilder.quadTo(c, e); });
+                return;
+        }
+        if (!closes) {
+            fBuilder.lineTo(p - r * u);
+        }
+    }
+
+    void addJoins(GPoint pivot, GVector t0, GVector t1) {
+        if (dot(t0, t1) > 0 && std::abs(cross(t0, t1)) < 1e-4f) {
+            // (nearly) straight on
+            fLeft.lineTo(pivot + fRadius * normal(t1));
+            fRight.lineTo(pivot - fRadius * normal(t1));
+            return;
+        }
+        this->addJoin(&fLeft, pivot, t0, t1, normal(t0), normal(t1));
+        this->addJoin(&fRight, pivot, t0, t1, normal(t0) * -1, normal(t1) * -1);
+    }
+
+    // Join the side's offset at pivot + r*u0 (the end of one segment) to pivot + r*u1 (the start
+    // of the next)
+    void addJoin(Side* side, GPoint pivot, GVector t0, GVector t1, GVector u0, GVector u1) {
+        const float r = fRadius;
+        if (dot(t1, u0) > 0) {
+            // the inside of the turn: the edges overlap, so connect them through the pivot
+            side->lineTo(pivot);
+            side->lineTo(pivot + r * u1);
+            return;
+        }
+        switch (fJoin) {
+            case GStrokeJoin::kMiter: {
+                const float d = dot(u0, u1);
+                // the miter is 1/cos(half of the angle between the normals) times the width
+                if (d > -1 + 1e-6f && 2 <= fMiterLimit * fMiterLimit * (1 + d)) {
+                    side->lineTo(pivot + (u0 + u1) * (r / (1 + d)));
+                }
+                break;
+            }
+            case GStrokeJoin::kRound:
+                arc(pivot, r, u0, u1, t0, [side](GPoint c, GPoint e) { side->quadTo(c, e); });
+                return;
+            case GStrokeJoin::kBevel:
+                break;
+        }
+        side->lineTo(pivot + r * u1);
+    }
+
+    // Add the offsets of the segment to both sides
+    void addOffsets(const Segment& seg) {
+        if (seg.fVerb == kLine) {
+            const GVector n = fRadius * normal(seg.tangent(0));
+            fLeft.lineTo(seg.end() + n);
+            fRight.lineTo(seg.end() - n);
+            return;
+        }
+        this->addCurveOffset(seg, &fLeft, fRadius, 0, 1, 0);
+        this->addCurveOffset(seg, &fRight, -fRadius, 0, 1, 0);
+    }
+
+    /**
+     *  Add quads that approximate the curve's offset by r (to the left, or right if negative),
+     *  from t0 to t1. Each quad's control point is where the tangents at its ends meet; if that
+     *  is not close enough to the offset at its middle, the span is split.
+     */
+    void addCurveOffset(const Segment& seg, Side* side, float r, float t0, float t1, int depth) {
+        const GVector d0 = seg.tangent(t0), d1 = seg.tangent(t1);
+        const GPoint p0 = seg.eval(t0) + r * normal(d0);
+        const GPoint p1 = seg.eval(t1) + r * normal(d1);
+        const float tm = (t0 + t1) * 0.5f;
+
+        const float denom = cross(d0, d1);
+        bool ok = dot(d0, d1) > 0.5f;     // turns less than 60 degrees
+        GPoint c = (p0 + p1) * 0.5f;
+        if (ok && std::abs(denom) > 1e-6f) {
+            const float a = cross(p1 - p0, d1) / denom;
+            c = p0 + a * d0;
+        }
+        if (ok) {
+            const GPoint mid = seg.eval(tm) + r * normal(seg.tangent(tm));
+            const GPoint quadMid = (p0 + 2 * c + p1) * 0.25f;
+            ok = (quadMid - mid).length() <= kTolerance;
+        }
+        if (ok || depth == kMaxDepth) {
+            side->quadTo(c, p1);
+            return;
+        }
+        this->addCurveOffset(seg, side, r, t0, tm, depth + 1);
+        this->addCurveOffset(seg, side, r, tm, t1, depth + 1);
+    }
+};
+
+} // namespace
+
+std::shared_ptr<GPath> GStrokePath(const GPath& src, float width, GStrokeJoin join,
+                                   GStrokeCap cap, float miterLimit) {
+    if (!(width > 0)) {
+        return nullptr;
+    }
+    return Stroker(width, join, cap, miterLimit).stroke(src);
+}